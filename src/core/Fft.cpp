@@ -0,0 +1,63 @@
+#include "Fft.h"
+#include "SimdKernels.h"
+#include <cmath>
+
+bool Fft::isValidSize(size_t size) {
+    return size >= 64 && size <= 65536 && (size & (size - 1)) == 0;
+}
+
+Fft::Fft(size_t size)
+    : m_size(size), m_window(size), m_bitReverse(size), m_windowed(size), m_re(size), m_im(size) {
+    const double pi = 3.14159265358979323846;
+
+    // Hann window; its coherent gain is 0.5, which the scale compensates
+    for (size_t i = 0; i < size; ++i) {
+        m_window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * pi * i / size));
+    }
+    m_scale = 4.0f / static_cast<float>(size);
+
+    unsigned bits = 0;
+    while ((size_t(1) << bits) < size) ++bits;
+    for (size_t i = 0; i < size; ++i) {
+        unsigned r = 0;
+        for (unsigned b = 0; b < bits; ++b) {
+            if (i & (size_t(1) << b)) r |= 1u << (bits - 1 - b);
+        }
+        m_bitReverse[i] = r;
+    }
+
+    // Stage with butterfly span `half` uses twiddles [half - 1, 2 * half - 1)
+    m_twiddleRe.reserve(size);
+    m_twiddleIm.reserve(size);
+    for (size_t half = 1; half < size; half <<= 1) {
+        for (size_t k = 0; k < half; ++k) {
+            const double angle = -pi * k / half;
+            m_twiddleRe.push_back(static_cast<float>(std::cos(angle)));
+            m_twiddleIm.push_back(static_cast<float>(std::sin(angle)));
+        }
+    }
+}
+
+void Fft::transform(const float* input, float* magnitudes) {
+    const SimdKernels& simd = SimdKernels::get();
+
+    simd.multiply(input, m_window.data(), m_windowed.data(), m_size);
+    for (size_t i = 0; i < m_size; ++i) {
+        m_re[m_bitReverse[i]] = m_windowed[i];
+        m_im[i] = 0.0f;
+    }
+
+    for (size_t half = 1; half < m_size; half <<= 1) {
+        const float* wr = m_twiddleRe.data() + half - 1;
+        const float* wi = m_twiddleIm.data() + half - 1;
+        for (size_t start = 0; start < m_size; start += 2 * half) {
+            simd.butterfly(m_re.data() + start, m_im.data() + start,
+                           m_re.data() + start + half, m_im.data() + start + half,
+                           wr, wi, half);
+        }
+    }
+
+    const size_t bins = binCount();
+    simd.magnitude(m_re.data(), m_im.data(), magnitudes, bins);
+    for (size_t i = 0; i < bins; ++i) magnitudes[i] *= m_scale;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Radix-2 FFT of a real, windowed input block.
+//
+// Everything (twiddles, bit-reversal table, window, work buffers) is
+// allocated in the constructor, so transform() is allocation-free and can
+// run on real-time threads. The butterflies and window/magnitude passes go
+// through SimdKernels.
+class Fft {
+public:
+    explicit Fft(size_t size);
+
+    size_t size() const { return m_size; }
+    size_t binCount() const { return m_size / 2 + 1; }
+
+    static bool isValidSize(size_t size);
+
+    // Applies a Hann window to input[0..size) and writes the magnitude of
+    // bins 0..size/2 into magnitudes (binCount() floats), normalised so a
+    // full-scale sine peaks at ~1.0.
+    void transform(const float* input, float* magnitudes);
+
+private:
+    size_t m_size;
+    std::vector<float> m_window;
+    std::vector<float> m_twiddleRe; // Per-stage twiddles, stored contiguously
+    std::vector<float> m_twiddleIm;
+    std::vector<unsigned> m_bitReverse;
+    std::vector<float> m_windowed;
+    std::vector<float> m_re;
+    std::vector<float> m_im;
+    float m_scale = 1.0f;
+};
@@ -26,4 +26,8 @@ public:
     static QString getDataPath() {
         return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
     }
+
+    static QString getCachePath() {
+        return QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    }
 };
\ No newline at end of file
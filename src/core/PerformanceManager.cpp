@@ -108,6 +108,17 @@ void PerformanceMonitor::recordPresetMetrics(const QString& presetPath, int load
     }
 }
 
+void PerformanceMonitor::recordShaderCacheMetrics(quint64 hits, quint64 misses, qint64 sizeBytes) {
+    QMutexLocker locker(&m_mutex);
+    
+    m_currentSnapshot.shaderCacheHits = hits;
+    m_currentSnapshot.shaderCacheMisses = misses;
+    m_currentSnapshot.shaderCacheBytes = sizeBytes;
+    m_stats.shaderCacheHits = hits;
+    m_stats.shaderCacheMisses = misses;
+    m_stats.shaderCacheBytes = sizeBytes;
+}
+
 void PerformanceMonitor::setAlertThresholds(double highCpuPercent, size_t highMemoryMB, int lowFrameRate) {
     QMutexLocker locker(&m_mutex);
     
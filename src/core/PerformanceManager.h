@@ -18,6 +18,9 @@ struct PerformanceSnapshot {
     int audioBufferSize = 0;
     int videoFrameRate = 0;
     int presetLoadTimeMs = 0;
+    quint64 shaderCacheHits = 0;
+    quint64 shaderCacheMisses = 0;
+    qint64 shaderCacheBytes = 0;
     QDateTime timestamp;
 };
 
@@ -47,6 +50,7 @@ public:
     void recordAudioMetrics(int bufferSize, int sampleRate, int channels);
     void recordVideoMetrics(int frameRate, int resolution, double renderTimeMs);
     void recordPresetMetrics(const QString& presetPath, int loadTimeMs);
+    void recordShaderCacheMetrics(quint64 hits, quint64 misses, qint64 sizeBytes);
     
     // Alert system
     void setAlertThresholds(double highCpuPercent = 80.0, size_t highMemoryMB = 512, 
@@ -76,6 +80,9 @@ public:
         int frameRate = 0;
         double audioLatencyMs = 0.0;
         int activeComponents = 0;
+        quint64 shaderCacheHits = 0;
+        quint64 shaderCacheMisses = 0;
+        qint64 shaderCacheBytes = 0;
     };
     
     PerformanceStats getStatistics() const;
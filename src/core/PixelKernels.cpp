@@ -0,0 +1,320 @@
+#include "PixelKernels.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__)
+#define VIBESYNC_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// BT.709 limited range in Q20: Y = 16 + 219/255 * (Kr R + Kg G + Kb B),
+// Cb/Cr = 128 + 224/255 * (B - Y') / 1.8556 and (R - Y') / 1.5748.
+// Chroma is computed from the sum of a 2x2 block, hence two more bits of shift.
+constexpr int kShift = 20;
+constexpr int kChromaShift = kShift + 2;
+constexpr int32_t kYR = 191455, kYG = 644067, kYB = 65019;
+constexpr int32_t kCbR = -105533, kCbG = -355018, kCbB = 460551;
+constexpr int32_t kCrR = 460551, kCrG = -418321, kCrB = -42230;
+constexpr int32_t kYOffset = (16 << kShift) + (1 << (kShift - 1));
+constexpr int32_t kChromaOffset = (128 << kChromaShift) + (1 << (kChromaShift - 1));
+
+// Downscaling weights
+constexpr int kBlendShift = 14;
+constexpr int32_t kBlendRound = 1 << (kBlendShift - 1);
+
+// ==================== Scalar ====================
+
+inline uint8_t luma(const uint8_t* p) {
+    return uint8_t((kYR * p[2] + kYG * p[1] + kYB * p[0] + kYOffset) >> kShift);
+}
+
+void bgraToYuv420Scalar(const uint8_t* bgra0, const uint8_t* bgra1, int width,
+                        uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int chromaStep) {
+    for (int x = 0; x < width; x += 2) {
+        // An odd last column pairs with itself
+        const int x1 = std::min(x + 1, width - 1);
+        const uint8_t* a = bgra0 + 4 * x;
+        const uint8_t* b = bgra0 + 4 * x1;
+        const uint8_t* c = bgra1 + 4 * x;
+        const uint8_t* d = bgra1 + 4 * x1;
+        y0[x] = luma(a);
+        y1[x] = luma(c);
+        if (x1 != x) {
+            y0[x1] = luma(b);
+            y1[x1] = luma(d);
+        }
+
+        const int32_t sb = a[0] + b[0] + c[0] + d[0];
+        const int32_t sg = a[1] + b[1] + c[1] + d[1];
+        const int32_t sr = a[2] + b[2] + c[2] + d[2];
+        const int i = (x / 2) * chromaStep;
+        u[i] = uint8_t((kCbR * sr + kCbG * sg + kCbB * sb + kChromaOffset) >> kChromaShift);
+        v[i] = uint8_t((kCrR * sr + kCrG * sg + kCrB * sb + kChromaOffset) >> kChromaShift);
+    }
+}
+
+void blendRowsScalar(const uint8_t* const* rows, const uint16_t* weights, int count, int bytes, uint8_t* out) {
+    for (int i = 0; i < bytes; ++i) {
+        int32_t sum = kBlendRound;
+        for (int r = 0; r < count; ++r) sum += rows[r][i] * int32_t(weights[r]);
+        out[i] = uint8_t(sum >> kBlendShift);
+    }
+}
+
+void blendPixelsScalar(const uint8_t* bgra, const int32_t* first, const uint16_t* weights, int taps, int width,
+                       uint8_t* out) {
+    for (int x = 0; x < width; ++x) {
+        const uint8_t* source = bgra + 4 * size_t(first[x]);
+        const uint16_t* w = weights + size_t(x) * taps;
+        for (int c = 0; c < 4; ++c) {
+            int32_t sum = kBlendRound;
+            for (int t = 0; t < taps; ++t) sum += source[4 * t + c] * int32_t(w[t]);
+            out[4 * x + c] = uint8_t(sum >> kBlendShift);
+        }
+    }
+}
+
+const PixelKernels kScalar = { "scalar", bgraToYuv420Scalar, blendRowsScalar, blendPixelsScalar };
+
+#ifdef VIBESYNC_SIMD_X86
+
+// ==================== SSE4.1 ====================
+// Per-function target attributes, as in SimdKernels: only reached after
+// the CPUID check.
+
+#define VIBESYNC_SSE41 __attribute__((target("sse4.1")))
+#define VIBESYNC_AVX2 __attribute__((target("avx2")))
+
+VIBESYNC_SSE41 void bgraToYuv420Sse41(const uint8_t* bgra0, const uint8_t* bgra1, int width,
+                                      uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int chromaStep) {
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    const __m128i yr = _mm_set1_epi32(kYR), yg = _mm_set1_epi32(kYG), yb = _mm_set1_epi32(kYB);
+    const __m128i cbr = _mm_set1_epi32(kCbR), cbg = _mm_set1_epi32(kCbG), cbb = _mm_set1_epi32(kCbB);
+    const __m128i crr = _mm_set1_epi32(kCrR), crg = _mm_set1_epi32(kCrG), crb = _mm_set1_epi32(kCrB);
+    const __m128i yOffset = _mm_set1_epi32(kYOffset), chromaOffset = _mm_set1_epi32(kChromaOffset);
+    const __m128i interleave = _mm_setr_epi8(0, 2, 1, 3, 4, 6, 5, 7, 8, 10, 9, 11, 12, 14, 13, 15);
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        const __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgra0 + 4 * x));
+        const __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgra1 + 4 * x));
+        const __m128i b0 = _mm_and_si128(p0, mask), b1 = _mm_and_si128(p1, mask);
+        const __m128i g0 = _mm_and_si128(_mm_srli_epi32(p0, 8), mask), g1 = _mm_and_si128(_mm_srli_epi32(p1, 8), mask);
+        const __m128i r0 = _mm_and_si128(_mm_srli_epi32(p0, 16), mask), r1 = _mm_and_si128(_mm_srli_epi32(p1, 16), mask);
+
+        const __m128i l0 = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(r0, yr), _mm_mullo_epi32(g0, yg)),
+                                                        _mm_add_epi32(_mm_mullo_epi32(b0, yb), yOffset)), kShift);
+        const __m128i l1 = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(r1, yr), _mm_mullo_epi32(g1, yg)),
+                                                        _mm_add_epi32(_mm_mullo_epi32(b1, yb), yOffset)), kShift);
+        const __m128i luma8 = _mm_packus_epi16(_mm_packus_epi32(l0, l1), _mm_setzero_si128());
+        const int32_t luma0 = _mm_cvtsi128_si32(luma8), luma1 = _mm_extract_epi32(luma8, 1);
+        std::memcpy(y0 + x, &luma0, 4);
+        std::memcpy(y1 + x, &luma1, 4);
+
+        // Sums of each 2x2 block, twice over: [s01, s23, s01, s23]
+        __m128i sb = _mm_add_epi32(b0, b1), sg = _mm_add_epi32(g0, g1), sr = _mm_add_epi32(r0, r1);
+        sb = _mm_hadd_epi32(sb, sb);
+        sg = _mm_hadd_epi32(sg, sg);
+        sr = _mm_hadd_epi32(sr, sr);
+        const __m128i cb = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(sr, cbr), _mm_mullo_epi32(sg, cbg)),
+                                                        _mm_add_epi32(_mm_mullo_epi32(sb, cbb), chromaOffset)), kChromaShift);
+        const __m128i cr = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(sr, crr), _mm_mullo_epi32(sg, crg)),
+                                                        _mm_add_epi32(_mm_mullo_epi32(sb, crb), chromaOffset)), kChromaShift);
+        // [cb0, cb1, cr0, cr1] as bytes
+        const __m128i chroma = _mm_blend_epi16(cb, cr, 0xF0);
+        const __m128i chroma8 = _mm_packus_epi16(_mm_packus_epi32(chroma, chroma), _mm_setzero_si128());
+        const int i = (x / 2) * chromaStep;
+        if (chromaStep == 2) {
+            const int32_t uv = _mm_cvtsi128_si32(_mm_shuffle_epi8(chroma8, interleave));
+            std::memcpy(u + i, &uv, 4);
+        } else {
+            const uint16_t cb2 = uint16_t(_mm_extract_epi16(chroma8, 0)), cr2 = uint16_t(_mm_extract_epi16(chroma8, 1));
+            std::memcpy(u + i, &cb2, 2);
+            std::memcpy(v + i, &cr2, 2);
+        }
+    }
+    if (x < width) {
+        const int i = (x / 2) * chromaStep;
+        bgraToYuv420Scalar(bgra0 + 4 * x, bgra1 + 4 * x, width - x, y0 + x, y1 + x, u + i, v + i, chromaStep);
+    }
+}
+
+// Rows two at a time: bytes of both, interleaved as 16 bits, against
+// their weight pair in one madd
+VIBESYNC_SSE41 void blendRowsSse41(const uint8_t* const* rows, const uint16_t* weights, int count, int bytes,
+                                   uint8_t* out) {
+    const __m128i round = _mm_set1_epi32(kBlendRound);
+    int i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        __m128i lo = round, hi = round;
+        for (int r = 0; r < count; r += 2) {
+            // An odd last row pairs with itself at weight 0
+            const int r1 = std::min(r + 1, count - 1);
+            const int32_t pair = weights[r] | (r1 != r ? int32_t(weights[r1]) << 16 : 0);
+            const __m128i w = _mm_set1_epi32(pair);
+            const __m128i a = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(rows[r] + i)));
+            const __m128i b = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(rows[r1] + i)));
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+        }
+        const __m128i words = _mm_packus_epi32(_mm_srli_epi32(lo, kBlendShift), _mm_srli_epi32(hi, kBlendShift));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(words, words));
+    }
+    if (i < bytes) {
+        std::vector<const uint8_t*> tail(rows, rows + count);
+        for (const uint8_t*& row : tail) row += i;
+        blendRowsScalar(tail.data(), weights, count, bytes - i, out + i);
+    }
+}
+
+// One output pixel per step, its four channels in one register
+VIBESYNC_SSE41 void blendPixelsSse41(const uint8_t* bgra, const int32_t* first, const uint16_t* weights, int taps,
+                                     int width, uint8_t* out) {
+    const __m128i round = _mm_set1_epi32(kBlendRound);
+    for (int x = 0; x < width; ++x) {
+        const uint8_t* source = bgra + 4 * size_t(first[x]);
+        const uint16_t* w = weights + size_t(x) * taps;
+        __m128i sum = round;
+        for (int t = 0; t < taps; ++t) {
+            int32_t pixel;
+            std::memcpy(&pixel, source + 4 * t, 4);
+            sum = _mm_add_epi32(sum, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(pixel)), _mm_set1_epi32(w[t])));
+        }
+        const __m128i words = _mm_packus_epi32(_mm_srli_epi32(sum, kBlendShift), sum);
+        const int32_t result = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+        std::memcpy(out + 4 * x, &result, 4);
+    }
+}
+
+const PixelKernels kSse41 = { "sse4.1", bgraToYuv420Sse41, blendRowsSse41, blendPixelsSse41 };
+
+// ==================== AVX2 ====================
+
+VIBESYNC_AVX2 void bgraToYuv420Avx2(const uint8_t* bgra0, const uint8_t* bgra1, int width,
+                                    uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int chromaStep) {
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+    const __m256i yr = _mm256_set1_epi32(kYR), yg = _mm256_set1_epi32(kYG), yb = _mm256_set1_epi32(kYB);
+    const __m256i cbr = _mm256_set1_epi32(kCbR), cbg = _mm256_set1_epi32(kCbG), cbb = _mm256_set1_epi32(kCbB);
+    const __m256i crr = _mm256_set1_epi32(kCrR), crg = _mm256_set1_epi32(kCrG), crb = _mm256_set1_epi32(kCrB);
+    const __m256i yOffset = _mm256_set1_epi32(kYOffset), chromaOffset = _mm256_set1_epi32(kChromaOffset);
+    const __m256i chromaOrder = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m256i p0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bgra0 + 4 * x));
+        const __m256i p1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bgra1 + 4 * x));
+        const __m256i b0 = _mm256_and_si256(p0, mask), b1 = _mm256_and_si256(p1, mask);
+        const __m256i g0 = _mm256_and_si256(_mm256_srli_epi32(p0, 8), mask);
+        const __m256i g1 = _mm256_and_si256(_mm256_srli_epi32(p1, 8), mask);
+        const __m256i r0 = _mm256_and_si256(_mm256_srli_epi32(p0, 16), mask);
+        const __m256i r1 = _mm256_and_si256(_mm256_srli_epi32(p1, 16), mask);
+
+        const __m256i l0 = _mm256_srai_epi32(
+            _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r0, yr), _mm256_mullo_epi32(g0, yg)),
+                             _mm256_add_epi32(_mm256_mullo_epi32(b0, yb), yOffset)), kShift);
+        const __m256i l1 = _mm256_srai_epi32(
+            _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r1, yr), _mm256_mullo_epi32(g1, yg)),
+                             _mm256_add_epi32(_mm256_mullo_epi32(b1, yb), yOffset)), kShift);
+        // Packs work within 128-bit lanes; put the row halves back in order
+        const __m256i luma16 = _mm256_permute4x64_epi64(_mm256_packus_epi32(l0, l1), 0xD8);
+        const __m128i luma8 = _mm_packus_epi16(_mm256_castsi256_si128(luma16), _mm256_extracti128_si256(luma16, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(y0 + x), luma8);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(y1 + x), _mm_unpackhi_epi64(luma8, luma8));
+
+        // Per lane: [s01, s23, s01, s23 | s45, s67, s45, s67]
+        __m256i sb = _mm256_add_epi32(b0, b1), sg = _mm256_add_epi32(g0, g1), sr = _mm256_add_epi32(r0, r1);
+        sb = _mm256_hadd_epi32(sb, sb);
+        sg = _mm256_hadd_epi32(sg, sg);
+        sr = _mm256_hadd_epi32(sr, sr);
+        const __m256i cb = _mm256_srai_epi32(
+            _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(sr, cbr), _mm256_mullo_epi32(sg, cbg)),
+                             _mm256_add_epi32(_mm256_mullo_epi32(sb, cbb), chromaOffset)), kChromaShift);
+        const __m256i cr = _mm256_srai_epi32(
+            _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(sr, crr), _mm256_mullo_epi32(sg, crg)),
+                             _mm256_add_epi32(_mm256_mullo_epi32(sb, crb), chromaOffset)), kChromaShift);
+        // [cb0..cb3, cr0..cr3] as bytes
+        const __m256i chroma = _mm256_permutevar8x32_epi32(_mm256_blend_epi32(cb, cr, 0xCC), chromaOrder);
+        const __m128i chroma16 = _mm_packus_epi32(_mm256_castsi256_si128(chroma), _mm256_extracti128_si256(chroma, 1));
+        const __m128i chroma8 = _mm_packus_epi16(chroma16, chroma16);
+        const int i = (x / 2) * chromaStep;
+        if (chromaStep == 2) {
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(u + i), _mm_unpacklo_epi8(chroma8, _mm_srli_si128(chroma8, 4)));
+        } else {
+            const int32_t cb4 = _mm_cvtsi128_si32(chroma8), cr4 = _mm_extract_epi32(chroma8, 1);
+            std::memcpy(u + i, &cb4, 4);
+            std::memcpy(v + i, &cr4, 4);
+        }
+    }
+    if (x < width) {
+        const int i = (x / 2) * chromaStep;
+        bgraToYuv420Sse41(bgra0 + 4 * x, bgra1 + 4 * x, width - x, y0 + x, y1 + x, u + i, v + i, chromaStep);
+    }
+}
+
+VIBESYNC_AVX2 void blendRowsAvx2(const uint8_t* const* rows, const uint16_t* weights, int count, int bytes,
+                                 uint8_t* out) {
+    const __m256i round = _mm256_set1_epi32(kBlendRound);
+    int i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        __m256i lo = round, hi = round;
+        for (int r = 0; r < count; r += 2) {
+            const int r1 = std::min(r + 1, count - 1);
+            const int32_t pair = weights[r] | (r1 != r ? int32_t(weights[r1]) << 16 : 0);
+            const __m256i w = _mm256_set1_epi32(pair);
+            const __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + i)));
+            const __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r1] + i)));
+            lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+            hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+        }
+        // The unpacks and packs both work per 128-bit lane, so the words come
+        // out in order; the bytes then sit in quadwords 0 and 2
+        const __m256i words = _mm256_packus_epi32(_mm256_srli_epi32(lo, kBlendShift), _mm256_srli_epi32(hi, kBlendShift));
+        const __m256i bytes8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_castsi256_si128(bytes8));
+    }
+    if (i < bytes) {
+        std::vector<const uint8_t*> tail(rows, rows + count);
+        for (const uint8_t*& row : tail) row += i;
+        blendRowsSse41(tail.data(), weights, count, bytes - i, out + i);
+    }
+}
+
+// The horizontal pass has a handful of taps per pixel and gains nothing
+// from wider registers
+const PixelKernels kAvx2 = { "avx2", bgraToYuv420Avx2, blendRowsAvx2, blendPixelsSse41 };
+
+#endif // VIBESYNC_SIMD_X86
+
+const PixelKernels& detect() {
+#if defined(VIBESYNC_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return kAvx2;
+    if (__builtin_cpu_supports("sse4.1")) return kSse41;
+#endif
+    return kScalar;
+}
+
+} // namespace
+
+const PixelKernels& PixelKernels::get() {
+    static const PixelKernels& kernels = detect();
+    return kernels;
+}
+
+const PixelKernels& PixelKernels::scalar() {
+    return kScalar;
+}
+
+std::vector<const PixelKernels*> PixelKernels::available() {
+    std::vector<const PixelKernels*> kernels;
+#if defined(VIBESYNC_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) kernels.push_back(&kAvx2);
+    if (__builtin_cpu_supports("sse4.1")) kernels.push_back(&kSse41);
+#endif
+    kernels.push_back(&kScalar);
+    return kernels;
+}
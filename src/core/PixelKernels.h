@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Runtime-dispatched pixel kernels for the recording path.
+//
+// BGRA to 4:2:0 YUV with BT.709 coefficients in limited range (Y 16-235,
+// Cb/Cr 16-240), chroma from the average of each 2x2 block. The arithmetic
+// is Q20 fixed point, identical in every implementation (AVX2, SSE4.1,
+// scalar), so all of them produce the same bytes; against the real-valued
+// formula they only differ by one where it lands within 1e-5 of a rounding tie.
+struct PixelKernels {
+    const char* name;
+
+    // Converts two BGRA rows into two luma rows and one row of chroma; an
+    // odd last column pairs with itself. chromaStep 1 writes planar U and V (I420), chromaStep 2
+    // interleaves them with v == u + 1 (NV12).
+    void (*bgraToYuv420)(const uint8_t* bgra0, const uint8_t* bgra1, int width,
+                         uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int chromaStep);
+
+    // Area downscaling, as two separable passes whose Q14 weights sum to
+    // 1 << 14 for every output sample (also identical everywhere).
+    // blendRows writes the weighted sum of count rows, byte by byte, so it
+    // serves any layout. blendPixels resamples a BGRA row: output pixel i
+    // sums taps source pixels from first[i], weighted by weights[i * taps ...].
+    void (*blendRows)(const uint8_t* const* rows, const uint16_t* weights, int count, int bytes, uint8_t* out);
+    void (*blendPixels)(const uint8_t* bgra, const int32_t* first, const uint16_t* weights, int taps, int width,
+                        uint8_t* out);
+
+    static const PixelKernels& get();
+    static const PixelKernels& scalar();
+    // Every implementation this CPU can run, get() first, for tests
+    static std::vector<const PixelKernels*> available();
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer, multi-reader sequence lock for small trivially copyable
+// state. The writer never waits; readers retry only if they raced with a
+// write, so any thread can poll the value without taking a mutex.
+template<typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock needs trivially copyable state");
+
+public:
+    SeqLock() { store(T{}); }
+    explicit SeqLock(const T& initial) { store(initial); }
+
+    // Writer side (one thread only)
+    void store(const T& value) {
+        std::array<uint64_t, kWords> words{};
+        std::memcpy(words.data(), static_cast<const void*>(&value), sizeof(T));
+
+        const uint64_t seq = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; ++i) {
+            m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+        m_sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // Reader side (any thread)
+    T load() const {
+        std::array<uint64_t, kWords> words{};
+        uint64_t before, after;
+        do {
+            before = m_sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < kWords; ++i) {
+                words[i] = m_words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = m_sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+
+        T value;
+        std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> m_sequence{0};
+    std::array<std::atomic<uint64_t>, kWords> m_words{};
+};
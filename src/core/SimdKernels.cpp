@@ -0,0 +1,280 @@
+#include "SimdKernels.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__)
+#define VIBESYNC_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define VIBESYNC_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// ==================== Scalar ====================
+
+void multiplyScalar(const float* a, const float* b, float* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) dst[i] = a[i] * b[i];
+}
+
+void butterflyScalar(float* re0, float* im0, float* re1, float* im1,
+                     const float* wr, const float* wi, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        const float tr = re1[i] * wr[i] - im1[i] * wi[i];
+        const float ti = re1[i] * wi[i] + im1[i] * wr[i];
+        re1[i] = re0[i] - tr;
+        im1[i] = im0[i] - ti;
+        re0[i] += tr;
+        im0[i] += ti;
+    }
+}
+
+void magnitudeScalar(const float* re, const float* im, float* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) dst[i] = std::sqrt(re[i] * re[i] + im[i] * im[i]);
+}
+
+float sumSquaresScalar(const float* x, size_t n) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i) sum += x[i] * x[i];
+    return sum;
+}
+
+float peakAbsScalar(const float* x, size_t n) {
+    float peak = 0.0f;
+    for (size_t i = 0; i < n; ++i) peak = std::max(peak, std::fabs(x[i]));
+    return peak;
+}
+
+const SimdKernels kScalar = {
+    "scalar", multiplyScalar, butterflyScalar, magnitudeScalar, sumSquaresScalar, peakAbsScalar
+};
+
+#ifdef VIBESYNC_SIMD_X86
+
+// ==================== SSE2 ====================
+
+void multiplySse(const float* a, const float* b, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    multiplyScalar(a + i, b + i, dst + i, n - i);
+}
+
+void butterflySse(float* re0, float* im0, float* re1, float* im1,
+                  const float* wr, const float* wi, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 r1 = _mm_loadu_ps(re1 + i), i1 = _mm_loadu_ps(im1 + i);
+        const __m128 c = _mm_loadu_ps(wr + i), s = _mm_loadu_ps(wi + i);
+        const __m128 tr = _mm_sub_ps(_mm_mul_ps(r1, c), _mm_mul_ps(i1, s));
+        const __m128 ti = _mm_add_ps(_mm_mul_ps(r1, s), _mm_mul_ps(i1, c));
+        const __m128 r0 = _mm_loadu_ps(re0 + i), i0 = _mm_loadu_ps(im0 + i);
+        _mm_storeu_ps(re1 + i, _mm_sub_ps(r0, tr));
+        _mm_storeu_ps(im1 + i, _mm_sub_ps(i0, ti));
+        _mm_storeu_ps(re0 + i, _mm_add_ps(r0, tr));
+        _mm_storeu_ps(im0 + i, _mm_add_ps(i0, ti));
+    }
+    butterflyScalar(re0 + i, im0 + i, re1 + i, im1 + i, wr + i, wi + i, n - i);
+}
+
+void magnitudeSse(const float* re, const float* im, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 r = _mm_loadu_ps(re + i), m = _mm_loadu_ps(im + i);
+        _mm_storeu_ps(dst + i, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(m, m))));
+    }
+    magnitudeScalar(re + i, im + i, dst + i, n - i);
+}
+
+float horizontalSum(__m128 v) {
+    __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+}
+
+float horizontalMax(__m128 v) {
+    __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 maxs = _mm_max_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, maxs);
+    return _mm_cvtss_f32(_mm_max_ss(maxs, shuf));
+}
+
+float sumSquaresSse(const float* x, size_t n) {
+    __m128 acc = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 v = _mm_loadu_ps(x + i);
+        acc = _mm_add_ps(acc, _mm_mul_ps(v, v));
+    }
+    return horizontalSum(acc) + sumSquaresScalar(x + i, n - i);
+}
+
+float peakAbsSse(const float* x, size_t n) {
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 acc = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm_max_ps(acc, _mm_andnot_ps(signMask, _mm_loadu_ps(x + i)));
+    }
+    return std::max(horizontalMax(acc), peakAbsScalar(x + i, n - i));
+}
+
+const SimdKernels kSse = {
+    "sse2", multiplySse, butterflySse, magnitudeSse, sumSquaresSse, peakAbsSse
+};
+
+// ==================== AVX2 + FMA ====================
+// Compiled with per-function target attributes so the rest of the binary
+// keeps the baseline ISA and these only run after the CPUID check.
+
+#define VIBESYNC_AVX2 __attribute__((target("avx2,fma")))
+
+VIBESYNC_AVX2 void multiplyAvx2(const float* a, const float* b, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    multiplySse(a + i, b + i, dst + i, n - i);
+}
+
+VIBESYNC_AVX2 void butterflyAvx2(float* re0, float* im0, float* re1, float* im1,
+                                 const float* wr, const float* wi, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 r1 = _mm256_loadu_ps(re1 + i), i1 = _mm256_loadu_ps(im1 + i);
+        const __m256 c = _mm256_loadu_ps(wr + i), s = _mm256_loadu_ps(wi + i);
+        const __m256 tr = _mm256_fmsub_ps(r1, c, _mm256_mul_ps(i1, s));
+        const __m256 ti = _mm256_fmadd_ps(r1, s, _mm256_mul_ps(i1, c));
+        const __m256 r0 = _mm256_loadu_ps(re0 + i), i0 = _mm256_loadu_ps(im0 + i);
+        _mm256_storeu_ps(re1 + i, _mm256_sub_ps(r0, tr));
+        _mm256_storeu_ps(im1 + i, _mm256_sub_ps(i0, ti));
+        _mm256_storeu_ps(re0 + i, _mm256_add_ps(r0, tr));
+        _mm256_storeu_ps(im0 + i, _mm256_add_ps(i0, ti));
+    }
+    butterflySse(re0 + i, im0 + i, re1 + i, im1 + i, wr + i, wi + i, n - i);
+}
+
+VIBESYNC_AVX2 void magnitudeAvx2(const float* re, const float* im, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 r = _mm256_loadu_ps(re + i), m = _mm256_loadu_ps(im + i);
+        _mm256_storeu_ps(dst + i, _mm256_sqrt_ps(_mm256_fmadd_ps(r, r, _mm256_mul_ps(m, m))));
+    }
+    magnitudeSse(re + i, im + i, dst + i, n - i);
+}
+
+VIBESYNC_AVX2 float sumSquaresAvx2(const float* x, size_t n) {
+    __m256 acc = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 v = _mm256_loadu_ps(x + i);
+        acc = _mm256_fmadd_ps(v, v, acc);
+    }
+    const __m128 folded = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    return horizontalSum(folded) + sumSquaresScalar(x + i, n - i);
+}
+
+VIBESYNC_AVX2 float peakAbsAvx2(const float* x, size_t n) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    __m256 acc = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_max_ps(acc, _mm256_andnot_ps(signMask, _mm256_loadu_ps(x + i)));
+    }
+    const __m128 folded = _mm_max_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    return std::max(horizontalMax(folded), peakAbsScalar(x + i, n - i));
+}
+
+const SimdKernels kAvx2 = {
+    "avx2", multiplyAvx2, butterflyAvx2, magnitudeAvx2, sumSquaresAvx2, peakAbsAvx2
+};
+
+#endif // VIBESYNC_SIMD_X86
+
+#ifdef VIBESYNC_SIMD_NEON
+
+// ==================== NEON ====================
+
+void multiplyNeon(const float* a, const float* b, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(dst + i, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+    }
+    multiplyScalar(a + i, b + i, dst + i, n - i);
+}
+
+void butterflyNeon(float* re0, float* im0, float* re1, float* im1,
+                   const float* wr, const float* wi, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const float32x4_t r1 = vld1q_f32(re1 + i), i1 = vld1q_f32(im1 + i);
+        const float32x4_t c = vld1q_f32(wr + i), s = vld1q_f32(wi + i);
+        const float32x4_t tr = vmlsq_f32(vmulq_f32(r1, c), i1, s);
+        const float32x4_t ti = vmlaq_f32(vmulq_f32(r1, s), i1, c);
+        const float32x4_t r0 = vld1q_f32(re0 + i), i0 = vld1q_f32(im0 + i);
+        vst1q_f32(re1 + i, vsubq_f32(r0, tr));
+        vst1q_f32(im1 + i, vsubq_f32(i0, ti));
+        vst1q_f32(re0 + i, vaddq_f32(r0, tr));
+        vst1q_f32(im0 + i, vaddq_f32(i0, ti));
+    }
+    butterflyScalar(re0 + i, im0 + i, re1 + i, im1 + i, wr + i, wi + i, n - i);
+}
+
+void magnitudeNeon(const float* re, const float* im, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const float32x4_t r = vld1q_f32(re + i), m = vld1q_f32(im + i);
+        vst1q_f32(dst + i, vsqrtq_f32(vmlaq_f32(vmulq_f32(r, r), m, m)));
+    }
+    magnitudeScalar(re + i, im + i, dst + i, n - i);
+}
+
+float sumSquaresNeon(const float* x, size_t n) {
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const float32x4_t v = vld1q_f32(x + i);
+        acc = vmlaq_f32(acc, v, v);
+    }
+    return vaddvq_f32(acc) + sumSquaresScalar(x + i, n - i);
+}
+
+float peakAbsNeon(const float* x, size_t n) {
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc = vmaxq_f32(acc, vabsq_f32(vld1q_f32(x + i)));
+    }
+    return std::max(vmaxvq_f32(acc), peakAbsScalar(x + i, n - i));
+}
+
+const SimdKernels kNeon = {
+    "neon", multiplyNeon, butterflyNeon, magnitudeNeon, sumSquaresNeon, peakAbsNeon
+};
+
+#endif // VIBESYNC_SIMD_NEON
+
+const SimdKernels& detect() {
+#if defined(VIBESYNC_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return kAvx2;
+    if (__builtin_cpu_supports("sse2")) return kSse;
+#elif defined(VIBESYNC_SIMD_NEON)
+    return kNeon;
+#endif
+    return kScalar;
+}
+
+} // namespace
+
+const SimdKernels& SimdKernels::get() {
+    static const SimdKernels& kernels = detect();
+    return kernels;
+}
+
+const SimdKernels& SimdKernels::scalar() {
+    return kScalar;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+
+// Runtime-dispatched float kernels for the audio analysis hot paths.
+//
+// Each instruction set gets its own implementation (AVX2+FMA, SSE2, NEON)
+// with a scalar fallback. The best one the CPU supports is picked once on
+// first use; call sites just go through SimdKernels::get().
+struct SimdKernels {
+    const char* name;
+
+    // dst[i] = a[i] * b[i]
+    void (*multiply)(const float* a, const float* b, float* dst, size_t n);
+
+    // Radix-2 butterflies on split-complex data:
+    //   t = x1 * w;  x1 = x0 - t;  x0 = x0 + t
+    void (*butterfly)(float* re0, float* im0, float* re1, float* im1,
+                      const float* wr, const float* wi, size_t n);
+
+    // dst[i] = sqrt(re[i]^2 + im[i]^2)
+    void (*magnitude)(const float* re, const float* im, float* dst, size_t n);
+
+    // Returns sum(x[i]^2)
+    float (*sumSquares)(const float* x, size_t n);
+
+    // Returns max(|x[i]|)
+    float (*peakAbs)(const float* x, size_t n);
+
+    static const SimdKernels& get();
+    static const SimdKernels& scalar();
+};
@@ -0,0 +1,97 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+// Lock-free single-producer/single-consumer ring buffer.
+//
+// Storage is allocated once in the constructor and never again, so the
+// producer (audio thread) and the consumer (render thread) can move data
+// without taking locks or touching the allocator. Capacity is rounded up
+// to a power of two so indices wrap with a mask.
+//
+// Writes never block: when the ring is full the excess is dropped and the
+// caller gets back how much was actually written.
+template<typename T>
+class SpscRingBuffer {
+    static_assert(std::is_trivially_copyable_v<T>, "SpscRingBuffer needs trivially copyable elements");
+
+public:
+    explicit SpscRingBuffer(size_t minCapacity) {
+        size_t cap = 1;
+        while (cap < minCapacity) cap <<= 1;
+        m_capacity = cap;
+        m_mask = cap - 1;
+        m_data = std::make_unique<T[]>(cap);
+    }
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    size_t capacity() const { return m_capacity; }
+
+    // Producer side
+    size_t writeAvailable() const {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        return m_capacity - (head - tail);
+    }
+
+    size_t write(const T* src, size_t count) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        const size_t n = std::min(count, m_capacity - (head - tail));
+        if (n == 0) return 0;
+
+        const size_t start = head & m_mask;
+        const size_t first = std::min(n, m_capacity - start);
+        std::memcpy(m_data.get() + start, src, first * sizeof(T));
+        std::memcpy(m_data.get(), src + first, (n - first) * sizeof(T));
+
+        m_head.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer side
+    size_t readAvailable() const {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t head = m_head.load(std::memory_order_acquire);
+        return head - tail;
+    }
+
+    size_t read(T* dst, size_t count) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t head = m_head.load(std::memory_order_acquire);
+        const size_t n = std::min(count, head - tail);
+        if (n == 0) return 0;
+
+        const size_t start = tail & m_mask;
+        const size_t first = std::min(n, m_capacity - start);
+        std::memcpy(dst, m_data.get() + start, first * sizeof(T));
+        std::memcpy(dst + first, m_data.get(), (n - first) * sizeof(T));
+
+        m_tail.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // Drops up to count queued elements without copying them (consumer side).
+    size_t discard(size_t count) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t head = m_head.load(std::memory_order_acquire);
+        const size_t n = std::min(count, head - tail);
+        m_tail.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+private:
+    // Keep the two indices on separate cache lines so the producer and the
+    // consumer do not false-share.
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+    alignas(64) size_t m_capacity = 0;
+    size_t m_mask = 0;
+    std::unique_ptr<T[]> m_data;
+};
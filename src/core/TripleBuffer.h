@@ -0,0 +1,55 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Wait-free single-producer/single-consumer triple buffer.
+//
+// The producer always owns one slot it can fill at leisure, the consumer
+// always owns one slot it can read at leisure, and the third slot is swapped
+// between them with a single atomic exchange. Neither side ever waits, and
+// the consumer always sees the most recently published value.
+//
+// Slots are constructed up front; use forEachSlot() to preallocate any
+// containers inside T before the threads start.
+template<typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    template<typename F>
+    void forEachSlot(F&& fn) {
+        for (auto& slot : m_slots) fn(slot);
+    }
+
+    // Producer side: fill back(), then publish()
+    T& back() { return m_slots[m_back]; }
+
+    void publish() {
+        m_back = m_middle.exchange(static_cast<uint8_t>(m_back | kDirty), std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    // Consumer side: update() pulls in the latest published slot (if any)
+    // and returns whether front() changed.
+    bool update() {
+        if (!(m_middle.load(std::memory_order_relaxed) & kDirty)) return false;
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+
+    // The consumer may write to its slot too; the next update() hands the
+    // writes to the producer along with the slot
+    T& front() { return m_slots[m_front]; }
+    const T& front() const { return m_slots[m_front]; }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x3;
+    static constexpr uint8_t kDirty = 0x4;
+
+    std::array<T, 3> m_slots{};
+    uint8_t m_back = 0;                 // Producer-owned
+    alignas(64) std::atomic<uint8_t> m_middle{1};
+    alignas(64) uint8_t m_front = 2;    // Consumer-owned
+};
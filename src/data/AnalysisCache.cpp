@@ -0,0 +1,134 @@
+#include "AnalysisCache.h"
+#include "core/PathUtils.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QSaveFile>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr char kMagic[4] = {'V', 'S', 'A', '1'};
+constexpr quint32 kVersion = 1;
+}
+
+// File layout: Header, beats (u32), sections (u32), envelope (u8).
+// Everything is naturally aligned, so the arrays can be used in place.
+struct CachedTrackAnalysis::Header {
+    char magic[4];
+    quint32 version;
+    quint64 sourceSize;
+    qint64 sourceMtimeMs;
+    qint64 durationMs;
+    float bpm;
+    float loudnessLufs;
+    quint32 envelopeHopMs;
+    quint32 beatCount;
+    quint32 sectionCount;
+    quint32 envelopeCount;
+};
+
+const CachedTrackAnalysis::Header* CachedTrackAnalysis::header() const {
+    return reinterpret_cast<const Header*>(m_data);
+}
+
+qint64 CachedTrackAnalysis::durationMs() const { return header()->durationMs; }
+float CachedTrackAnalysis::bpm() const { return header()->bpm; }
+float CachedTrackAnalysis::loudnessLufs() const { return header()->loudnessLufs; }
+quint32 CachedTrackAnalysis::envelopeHopMs() const { return header()->envelopeHopMs; }
+
+std::span<const quint32> CachedTrackAnalysis::beatsMs() const {
+    const auto* beats = reinterpret_cast<const quint32*>(m_data + sizeof(Header));
+    return {beats, header()->beatCount};
+}
+
+std::span<const quint32> CachedTrackAnalysis::sectionsMs() const {
+    return {beatsMs().data() + header()->beatCount, header()->sectionCount};
+}
+
+std::span<const quint8> CachedTrackAnalysis::envelope() const {
+    const auto* env = reinterpret_cast<const quint8*>(sectionsMs().data() + header()->sectionCount);
+    return {env, header()->envelopeCount};
+}
+
+float CachedTrackAnalysis::energyAt(qint64 positionMs) const {
+    const auto env = envelope();
+    if (env.empty() || positionMs < 0) return 0.0f;
+    const size_t index = std::min(env.size() - 1, static_cast<size_t>(positionMs / envelopeHopMs()));
+    return env[index] / 255.0f;
+}
+
+AnalysisCache::AnalysisCache() {
+    m_directory = PathUtils::getCachePath() + "/analysis";
+    QDir().mkpath(m_directory);
+}
+
+QString AnalysisCache::entryPath(const QFileInfo& track) const {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(track.absoluteFilePath().toUtf8());
+    hash.addData(QByteArray::number(track.size()));
+    hash.addData(QByteArray::number(track.lastModified().toMSecsSinceEpoch()));
+    return m_directory + "/" + QString::fromLatin1(hash.result().toHex()) + ".vsa";
+}
+
+bool AnalysisCache::contains(const QString& trackPath) const {
+    return QFile::exists(entryPath(QFileInfo(trackPath)));
+}
+
+std::shared_ptr<const CachedTrackAnalysis> AnalysisCache::lookup(const QString& trackPath) const {
+    const QFileInfo track(trackPath);
+    auto file = std::make_unique<QFile>(entryPath(track));
+    if (!file->open(QIODevice::ReadOnly)) return nullptr;
+
+    const qint64 size = file->size();
+    if (size < static_cast<qint64>(sizeof(CachedTrackAnalysis::Header))) return nullptr;
+
+    const uchar* data = file->map(0, size);
+    if (!data) return nullptr;
+
+    CachedTrackAnalysis::Header header;
+    std::memcpy(&header, data, sizeof(header));
+    const qint64 expected = static_cast<qint64>(sizeof(header)) +
+                            4 * (qint64(header.beatCount) + header.sectionCount) + header.envelopeCount;
+
+    // The hash already covers path/size/mtime; re-check them to rule out collisions
+    if (std::memcmp(header.magic, kMagic, 4) != 0 || header.version != kVersion ||
+        header.sourceSize != static_cast<quint64>(track.size()) ||
+        header.sourceMtimeMs != track.lastModified().toMSecsSinceEpoch() ||
+        header.envelopeHopMs == 0 || size != expected) {
+        qWarning() << "⚠️ Ignoring stale or corrupt analysis cache entry for" << track.fileName();
+        return nullptr;
+    }
+
+    auto entry = std::make_shared<CachedTrackAnalysis>();
+    entry->m_data = data;
+    entry->m_file = std::move(file);
+    return entry;
+}
+
+bool AnalysisCache::store(const QString& trackPath, const TrackAnalysis& analysis) {
+    const QFileInfo track(trackPath);
+
+    CachedTrackAnalysis::Header header{};
+    std::memcpy(header.magic, kMagic, 4);
+    header.version = kVersion;
+    header.sourceSize = static_cast<quint64>(track.size());
+    header.sourceMtimeMs = track.lastModified().toMSecsSinceEpoch();
+    header.durationMs = analysis.durationMs;
+    header.bpm = analysis.bpm;
+    header.loudnessLufs = analysis.loudnessLufs;
+    header.envelopeHopMs = analysis.envelopeHopMs;
+    header.beatCount = static_cast<quint32>(analysis.beatsMs.size());
+    header.sectionCount = static_cast<quint32>(analysis.sectionsMs.size());
+    header.envelopeCount = static_cast<quint32>(analysis.envelope.size());
+
+    // Write to a temp file and rename, so readers never map a partial entry
+    QSaveFile out(entryPath(track));
+    if (!out.open(QIODevice::WriteOnly)) return false;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(analysis.beatsMs.constData()), analysis.beatsMs.size() * sizeof(quint32));
+    out.write(reinterpret_cast<const char*>(analysis.sectionsMs.constData()), analysis.sectionsMs.size() * sizeof(quint32));
+    out.write(reinterpret_cast<const char*>(analysis.envelope.constData()), analysis.envelope.size());
+    return out.commit();
+}
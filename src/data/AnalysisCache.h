@@ -0,0 +1,67 @@
+#pragma once
+#include <QString>
+#include <QFile>
+#include <QFileInfo>
+#include <QVector>
+#include <memory>
+#include <span>
+
+// Per-track analysis produced offline by TrackAnalyzer
+struct TrackAnalysis {
+    qint64 durationMs = 0;
+    float bpm = 0.0f;
+    float loudnessLufs = -70.0f;      // Integrated loudness (BS.1770, gated)
+    quint32 envelopeHopMs = 100;
+    QVector<quint32> beatsMs;         // Beat grid
+    QVector<quint32> sectionsMs;      // Section boundaries (excluding 0)
+    QVector<quint8> envelope;         // RMS per hop, -60..0 dBFS mapped to 0..255
+};
+
+// Read-only view of a cache entry, backed directly by the mapped file
+class CachedTrackAnalysis {
+public:
+    qint64 durationMs() const;
+    float bpm() const;
+    float loudnessLufs() const;
+    quint32 envelopeHopMs() const;
+    std::span<const quint32> beatsMs() const;
+    std::span<const quint32> sectionsMs() const;
+    std::span<const quint8> envelope() const;
+
+    // Envelope value (0..1) at a playback position
+    float energyAt(qint64 positionMs) const;
+
+private:
+    friend class AnalysisCache;
+    struct Header;
+
+    std::unique_ptr<QFile> m_file;
+    const uchar* m_data = nullptr;
+    const Header* header() const;
+};
+
+// On-disk cache of TrackAnalysis, one compact file per track.
+//
+// Entries are keyed by a hash of the absolute path, size and mtime, so an
+// edited or replaced file simply misses. Files are memory-mapped on lookup,
+// which makes loading an entry effectively free at track start.
+class AnalysisCache {
+public:
+    static AnalysisCache& instance() {
+        static AnalysisCache s;
+        return s;
+    }
+
+    bool contains(const QString& trackPath) const;
+    std::shared_ptr<const CachedTrackAnalysis> lookup(const QString& trackPath) const;
+    bool store(const QString& trackPath, const TrackAnalysis& analysis);
+
+    QString cacheDirectory() const { return m_directory; }
+
+private:
+    AnalysisCache();
+
+    QString entryPath(const QFileInfo& track) const;
+
+    QString m_directory;
+};
@@ -0,0 +1,99 @@
+#include "PresetCostIndex.h"
+#include "core/PathUtils.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QDebug>
+
+namespace {
+constexpr int kVersion = 1;
+}
+
+PresetCostIndex::PresetCostIndex() {
+    const QString directory = PathUtils::getCachePath();
+    QDir().mkpath(directory);
+    m_path = directory + "/preset_costs.json";
+    load();
+}
+
+void PresetCostIndex::load() {
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root.value("version").toInt() != kVersion) {
+        qWarning() << "⚠️ Ignoring preset cost index with unknown version:" << m_path;
+        return;
+    }
+
+    const QJsonObject presets = root.value("presets").toObject();
+    for (auto it = presets.begin(); it != presets.end(); ++it) {
+        const QJsonObject json = it.value().toObject();
+        Entry entry;
+        entry.sourceSize = json.value("size").toInteger();
+        entry.sourceMtimeMs = json.value("mtime_ms").toInteger();
+        entry.cost.meanMs = json.value("mean_ms").toDouble();
+        entry.cost.p95Ms = json.value("p95_ms").toDouble();
+        entry.cost.p99Ms = json.value("p99_ms").toDouble();
+        entry.cost.loadMs = json.value("load_ms").toDouble();
+        entry.cost.shaderMs = json.value("shader_ms").toDouble(-1.0);
+        entry.cost.frames = json.value("frames").toInt();
+        entry.cost.width = json.value("width").toInt();
+        entry.cost.height = json.value("height").toInt();
+        entry.cost.renderer = json.value("renderer").toString();
+        m_entries.insert(it.key(), entry);
+    }
+}
+
+std::optional<PresetCost> PresetCostIndex::lookup(const QString& presetPath) const {
+    const QFileInfo preset(presetPath);
+    const auto it = m_entries.constFind(preset.absoluteFilePath());
+    if (it == m_entries.constEnd()) return std::nullopt;
+
+    // Measured on another version of the file
+    if (it->sourceSize != preset.size() || it->sourceMtimeMs != preset.lastModified().toMSecsSinceEpoch()) {
+        return std::nullopt;
+    }
+    return it->cost;
+}
+
+void PresetCostIndex::store(const QString& presetPath, const PresetCost& cost) {
+    const QFileInfo preset(presetPath);
+    Entry& entry = m_entries[preset.absoluteFilePath()];
+    entry.sourceSize = preset.size();
+    entry.sourceMtimeMs = preset.lastModified().toMSecsSinceEpoch();
+    entry.cost = cost;
+}
+
+bool PresetCostIndex::save() {
+    QJsonObject presets;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        const PresetCost& cost = it->cost;
+        QJsonObject json;
+        json["size"] = it->sourceSize;
+        json["mtime_ms"] = it->sourceMtimeMs;
+        json["mean_ms"] = cost.meanMs;
+        json["p95_ms"] = cost.p95Ms;
+        json["p99_ms"] = cost.p99Ms;
+        json["load_ms"] = cost.loadMs;
+        json["shader_ms"] = cost.shaderMs;
+        json["frames"] = cost.frames;
+        json["width"] = cost.width;
+        json["height"] = cost.height;
+        json["renderer"] = cost.renderer;
+        presets[it.key()] = json;
+    }
+
+    QJsonObject root;
+    root["version"] = kVersion;
+    root["presets"] = presets;
+
+    QSaveFile out(m_path);
+    if (!out.open(QIODevice::WriteOnly)) return false;
+    out.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    return out.commit();
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <QHash>
+#include <QString>
+#include <optional>
+
+// Measured rendering cost of one preset, as recorded by PresetProfiler
+struct PresetCost {
+    double meanMs = 0.0;        // Frame time
+    double p95Ms = 0.0;
+    double p99Ms = 0.0;
+    double loadMs = 0.0;        // Load plus first frame
+    double shaderMs = -1.0;     // Compile/link time within loadMs; -1 if unknown
+    int frames = 0;
+    int width = 0;
+    int height = 0;
+    QString renderer;           // GL_RENDERER the numbers were taken on
+};
+
+// Persistent index of preset costs, a JSON file in the cache directory.
+//
+// Entries are keyed by absolute path and remember the preset's size and
+// mtime, so an edited preset reads as unmeasured until it is profiled
+// again. The file is plain JSON on purpose: CI jobs publish it as an
+// artifact and it can be copied between machines with the preset packs.
+class PresetCostIndex {
+public:
+    static PresetCostIndex& instance() {
+        static PresetCostIndex s;
+        return s;
+    }
+
+    std::optional<PresetCost> lookup(const QString& presetPath) const;
+    void store(const QString& presetPath, const PresetCost& cost);
+    bool save();
+
+    QString indexPath() const { return m_path; }
+    int size() const { return m_entries.size(); }
+
+private:
+    PresetCostIndex();
+
+    struct Entry {
+        qint64 sourceSize = 0;
+        qint64 sourceMtimeMs = 0;
+        PresetCost cost;
+    };
+
+    void load();
+
+    QString m_path;
+    QHash<QString, Entry> m_entries;
+};
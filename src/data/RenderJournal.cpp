@@ -0,0 +1,112 @@
+#include "RenderJournal.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QDebug>
+
+namespace {
+constexpr int kVersion = 1;
+
+QString stateName(RenderJob::State state) {
+    switch (state) {
+    case RenderJob::State::Pending: return "pending";
+    case RenderJob::State::Running: return "running";
+    case RenderJob::State::Done: return "done";
+    case RenderJob::State::Failed: return "failed";
+    }
+    return "pending";
+}
+
+RenderJob::State stateFromName(const QString& name) {
+    if (name == "running") return RenderJob::State::Running;
+    if (name == "done") return RenderJob::State::Done;
+    if (name == "failed") return RenderJob::State::Failed;
+    return RenderJob::State::Pending;
+}
+}
+
+RenderJournal::RenderJournal(const QString& outputDirectory)
+    : m_path(outputDirectory + "/render_journal.json") {
+    load();
+}
+
+void RenderJournal::load() {
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root.value("version").toInt() != kVersion) {
+        qWarning() << "⚠️ Ignoring render journal with unknown version:" << m_path;
+        return;
+    }
+
+    for (const QJsonValue& value : root.value("jobs").toArray()) {
+        const QJsonObject json = value.toObject();
+        RenderJob job;
+        job.track = json.value("track").toString();
+        job.output = json.value("output").toString();
+        job.firstFrame = json.value("first_frame").toInteger(0);
+        job.frameCount = json.value("frame_count").toInteger(-1);
+        job.state = stateFromName(json.value("state").toString());
+        job.attempts = json.value("attempts").toInt();
+        job.mediaSeconds = json.value("media_seconds").toDouble();
+        job.wallSeconds = json.value("wall_seconds").toDouble();
+        job.error = json.value("error").toString();
+        if (!job.track.isEmpty() && !job.output.isEmpty()) m_jobs.append(job);
+    }
+}
+
+int RenderJournal::find(const QString& track, qint64 firstFrame) const {
+    for (int i = 0; i < m_jobs.size(); ++i) {
+        if (m_jobs[i].track == track && m_jobs[i].firstFrame == firstFrame) return i;
+    }
+    return -1;
+}
+
+int RenderJournal::add(const QString& track, const QString& output, qint64 firstFrame, qint64 frameCount) {
+    RenderJob job;
+    job.track = track;
+    job.output = output;
+    job.firstFrame = firstFrame;
+    job.frameCount = frameCount;
+    m_jobs.append(job);
+    return m_jobs.size() - 1;
+}
+
+bool RenderJournal::containsOutput(const QString& output) const {
+    for (const RenderJob& job : m_jobs) {
+        if (job.output == output) return true;
+    }
+    return false;
+}
+
+bool RenderJournal::save() {
+    QJsonArray jobs;
+    for (const RenderJob& job : m_jobs) {
+        QJsonObject json;
+        json["track"] = job.track;
+        json["output"] = job.output;
+        if (job.frameCount >= 0) {
+            json["first_frame"] = job.firstFrame;
+            json["frame_count"] = job.frameCount;
+        }
+        json["state"] = stateName(job.state);
+        json["attempts"] = job.attempts;
+        json["media_seconds"] = job.mediaSeconds;
+        json["wall_seconds"] = job.wallSeconds;
+        if (!job.error.isEmpty()) json["error"] = job.error;
+        jobs.append(json);
+    }
+
+    QJsonObject root;
+    root["version"] = kVersion;
+    root["jobs"] = jobs;
+
+    // Written in full and renamed into place, so a crash leaves the old one
+    QSaveFile out(m_path);
+    if (!out.open(QIODevice::WriteOnly)) return false;
+    out.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    return out.commit();
+}
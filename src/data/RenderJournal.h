@@ -0,0 +1,45 @@
+#pragma once
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+
+// One track of a batch render, or one segment of a segmented one
+struct RenderJob {
+    enum class State { Pending, Running, Done, Failed };
+
+    QString track;
+    QString output;
+    qint64 firstFrame = 0;      // Segments: the video frames rendered
+    qint64 frameCount = -1;     // -1 for the whole track
+    State state = State::Pending;
+    int attempts = 0;
+    double mediaSeconds = 0.0;  // Length of the rendered video
+    double wallSeconds = 0.0;   // Time the render took
+    QString error;              // Why the last attempt failed
+};
+
+// Persistent job list of a batch render, a JSON file in its output
+// directory.
+//
+// Saved on every state change, so after a crash the next run knows which
+// tracks are done and which were cut short. Jobs keep the playlist order.
+class RenderJournal {
+public:
+    explicit RenderJournal(const QString& outputDirectory);
+
+    // Index of the job for track (from firstFrame), or -1
+    int find(const QString& track, qint64 firstFrame = 0) const;
+    int add(const QString& track, const QString& output, qint64 firstFrame = 0, qint64 frameCount = -1);
+    RenderJob& job(int index) { return m_jobs[index]; }
+    const QList<RenderJob>& jobs() const { return m_jobs; }
+    bool containsOutput(const QString& output) const;
+
+    bool save();
+    QString path() const { return m_path; }
+
+private:
+    void load();
+
+    QString m_path;
+    QList<RenderJob> m_jobs;
+};
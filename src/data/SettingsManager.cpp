@@ -44,10 +44,89 @@ float SettingsManager::getGlobalScale() const {
 }
 
 QString SettingsManager::getFFmpegCommand() const {
-    QString defaultCmd = "ffmpeg -y -f rawvideo -vcodec rawvideo -pix_fmt bgra -s {WIDTH}x{HEIGHT} -r {FPS} -i - -c:v libx264 -preset ultrafast -crf 18 {OUTPUT}";
+    QString defaultCmd = "ffmpeg -y -f rawvideo -vcodec rawvideo -pix_fmt {PIX_FMT} -s {WIDTH}x{HEIGHT} -r {FPS} -i - -c:v libx264 -preset ultrafast -crf 18 -colorspace bt709 -color_primaries bt709 -color_trc bt709 -color_range tv {OUTPUT}";
     return value("recording/ffmpeg_cmd", defaultCmd).toString();
 }
 
+QSize SettingsManager::getRecordingSize() const {
+    return QSize(value("recording/width", 1920).toInt(), value("recording/height", 1080).toInt());
+}
+
+int SettingsManager::getRecordingFps() const {
+    return value("recording/fps", 60).toInt();
+}
+
+int SettingsManager::getRecordingQueueFrames() const {
+    return value("recording/queue_frames", 4).toInt();
+}
+
+QString SettingsManager::getRecordingFullQueuePolicy() const {
+    return value("recording/full_queue_policy", "duplicate-last").toString();
+}
+
+QString SettingsManager::getRecordingBackend() const {
+    return value("recording/backend", "libav").toString();
+}
+
+QString SettingsManager::getRecordingAudioCodec() const {
+    return value("recording/audio_codec", "aac").toString();
+}
+
+QList<QSize> SettingsManager::getRecordingRenditions() const {
+    // "1280x720,1080x1080"
+    QList<QSize> sizes;
+    for (const QString& item : value("recording/renditions", QString()).toString().split(',', Qt::SkipEmptyParts)) {
+        const QStringList parts = item.trimmed().split('x');
+        const QSize size = parts.size() == 2 ? QSize(parts[0].toInt(), parts[1].toInt()) : QSize();
+        if (size.width() > 0 && size.height() > 0) sizes << size;
+    }
+    return sizes;
+}
+
+double SettingsManager::getReplaySeconds() const {
+    return value("recording/replay_seconds", 30.0).toDouble();
+}
+
+int SettingsManager::getReplayMaxMegabytes() const {
+    return value("recording/replay_max_mb", 384).toInt();
+}
+
+QString SettingsManager::getReplayHotkey() const {
+    return value("recording/replay_hotkey", "Ctrl+Shift+R").toString();
+}
+
+int SettingsManager::getFftSize() const {
+    return value("audio/fft_size", 2048).toInt();
+}
+
+double SettingsManager::getRenderScaleMin() const {
+    return value("viz/render_scale_min", 0.5).toDouble();
+}
+
+double SettingsManager::getRenderScaleMax() const {
+    return value("viz/render_scale_max", 1.0).toDouble();
+}
+
+int SettingsManager::getMeshX() const {
+    return value("viz/mesh_x", 32).toInt();
+}
+
+int SettingsManager::getMeshY() const {
+    return value("viz/mesh_y", 24).toInt();
+}
+
+bool SettingsManager::getAdaptiveMesh() const {
+    return value("viz/adaptive_mesh", true).toBool();
+}
+
+double SettingsManager::getPresetCostLimitMs() const {
+    return value("viz/preset_cost_limit_ms", 0.0).toDouble();
+}
+
+bool SettingsManager::getExcludeCostlyPresets() const {
+    return value("viz/preset_cost_exclude", false).toBool();
+}
+
 void SettingsManager::setPresetPath(const QString& path) {
     setValue("viz/preset_path", path);
 }
@@ -74,4 +153,64 @@ void SettingsManager::setGlobalScale(float scale) {
 
 void SettingsManager::setFFmpegCommand(const QString& cmd) {
     setValue("recording/ffmpeg_cmd", cmd);
-}
\ No newline at end of file
+}
+
+void SettingsManager::setRecordingSize(const QSize& size) {
+    setValue("recording/width", size.width());
+    setValue("recording/height", size.height());
+}
+
+void SettingsManager::setRecordingFps(int fps) {
+    setValue("recording/fps", fps);
+}
+
+void SettingsManager::setRecordingQueue(int frames, const QString& fullQueuePolicy) {
+    setValue("recording/queue_frames", frames);
+    setValue("recording/full_queue_policy", fullQueuePolicy);
+}
+
+void SettingsManager::setRecordingBackend(const QString& backend) {
+    setValue("recording/backend", backend);
+}
+
+void SettingsManager::setRecordingAudioCodec(const QString& codec) {
+    setValue("recording/audio_codec", codec);
+}
+
+void SettingsManager::setRecordingRenditions(const QList<QSize>& sizes) {
+    QStringList items;
+    for (const QSize& size : sizes) items << QString("%1x%2").arg(size.width()).arg(size.height());
+    setValue("recording/renditions", items.join(','));
+}
+
+void SettingsManager::setReplayBuffer(double seconds, int maxMegabytes) {
+    setValue("recording/replay_seconds", seconds);
+    setValue("recording/replay_max_mb", maxMegabytes);
+}
+
+void SettingsManager::setReplayHotkey(const QString& keys) {
+    setValue("recording/replay_hotkey", keys);
+}
+
+void SettingsManager::setFftSize(int size) {
+    setValue("audio/fft_size", size);
+}
+
+void SettingsManager::setRenderScaleRange(double minScale, double maxScale) {
+    setValue("viz/render_scale_min", minScale);
+    setValue("viz/render_scale_max", maxScale);
+}
+
+void SettingsManager::setMeshSize(int x, int y) {
+    setValue("viz/mesh_x", x);
+    setValue("viz/mesh_y", y);
+}
+
+void SettingsManager::setAdaptiveMesh(bool enabled) {
+    setValue("viz/adaptive_mesh", enabled);
+}
+
+void SettingsManager::setPresetCostLimit(double limitMs, bool exclude) {
+    setValue("viz/preset_cost_limit_ms", limitMs);
+    setValue("viz/preset_cost_exclude", exclude);
+}
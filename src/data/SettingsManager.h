@@ -3,6 +3,8 @@
 #include <QSettings>
 #include <QVariant>
 #include <QString>
+#include <QSize>
+#include <QList>
 
 class SettingsManager : public QObject {
     Q_OBJECT
@@ -26,6 +28,24 @@ public:
     bool getShowWatermark() const;
     float getGlobalScale() const;
     QString getFFmpegCommand() const;
+    QSize getRecordingSize() const;
+    int getRecordingFps() const;
+    int getRecordingQueueFrames() const;         // Frames waiting for the encoder
+    QString getRecordingFullQueuePolicy() const; // "block", "drop-oldest" or "duplicate-last"
+    QString getRecordingBackend() const;         // "libav" (in-process, when built with it) or "process"
+    QString getRecordingAudioCodec() const;      // "aac", "flac", "pcm" or "none"; libav backend only
+    QList<QSize> getRecordingRenditions() const; // Extra outputs, cropped and scaled from the recording size
+    double getReplaySeconds() const;             // Replay buffer span
+    int getReplayMaxMegabytes() const;           // Replay buffer memory cap
+    QString getReplayHotkey() const;             // Saves the replay buffer
+    int getFftSize() const;
+    double getRenderScaleMin() const;   // Dynamic resolution bounds, per axis
+    double getRenderScaleMax() const;
+    int getMeshX() const;               // projectM per-vertex mesh, the governor's ceiling
+    int getMeshY() const;
+    bool getAdaptiveMesh() const;
+    double getPresetCostLimitMs() const;  // p95 frame time from the cost index, 0 = no limit
+    bool getExcludeCostlyPresets() const; // Otherwise they are only picked less often
 
     // Specialized setters
     void setPresetPath(const QString& path);
@@ -35,6 +55,19 @@ public:
     void setShowWatermark(bool show);
     void setGlobalScale(float scale);
     void setFFmpegCommand(const QString& cmd);
+    void setRecordingSize(const QSize& size);
+    void setRecordingFps(int fps);
+    void setRecordingQueue(int frames, const QString& fullQueuePolicy);
+    void setRecordingBackend(const QString& backend);
+    void setRecordingAudioCodec(const QString& codec);
+    void setRecordingRenditions(const QList<QSize>& sizes);
+    void setReplayBuffer(double seconds, int maxMegabytes);
+    void setReplayHotkey(const QString& keys);
+    void setFftSize(int size);
+    void setRenderScaleRange(double minScale, double maxScale);
+    void setMeshSize(int x, int y);
+    void setAdaptiveMesh(bool enabled);
+    void setPresetCostLimit(double limitMs, bool exclude);
 
 signals:
     void settingChanged(const QString& key, const QVariant& value);
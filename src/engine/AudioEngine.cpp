@@ -1,79 +1,523 @@
 #include "AudioEngine.h"
+#include <QAudioDevice>
+#include <QMediaDevices>
+#include <QIODevice>
+#include <QFileInfo>
 #include <QDebug>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+constexpr qint64 kSinkBufferUs = 40000;
+constexpr size_t kRenderChunkFrames = 2048;
+constexpr int kEventPollMs = 20;    // How late the owner may hear of a transition
+
+qint64 steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+// Pull-mode source for the QAudioSink. Lives on the output thread; every
+// read renders straight from the decoders, converting to the sink format
+// if the device cannot take float, and resampling if it cannot run at
+// kTapSampleRate.
+class PlaybackDevice : public QIODevice {
+public:
+    PlaybackDevice(AudioEngine* engine, const QAudioFormat& format)
+        : m_engine(engine)
+        , m_format(format)
+        , m_step(double(AudioEngine::kTapSampleRate) / format.sampleRate())
+        , m_scratch(kRenderChunkFrames * AudioEngine::kTapChannels) {
+        if (format.sampleRate() != AudioEngine::kTapSampleRate) {
+            // One chunk of output plus the interpolation neighbours
+            m_input.resize((size_t(std::ceil(kRenderChunkFrames * m_step)) + 3) * AudioEngine::kTapChannels);
+        }
+    }
+
+    void setSink(QAudioSink* sink) { m_sink = sink; }
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override { return QIODevice::bytesAvailable() + (1 << 20); }
+
+protected:
+    qint64 readData(char* data, qint64 maxlen) override {
+        const int bytesPerFrame = m_format.bytesPerFrame();
+        size_t frames = static_cast<size_t>(maxlen / bytesPerFrame);
+        qint64 written = 0;
+
+        // Whatever the device still holds plays before this data does
+        const qint64 queuedBytes = m_sink ? std::max<qint64>(0, m_sink->bufferSize() - m_sink->bytesFree()) : 0;
+        const size_t queued = static_cast<size_t>(queuedBytes / bytesPerFrame);
+
+        while (frames > 0) {
+            const size_t n = std::min(frames, kRenderChunkFrames);
+            const size_t ahead = queued + static_cast<size_t>(written / bytesPerFrame);
+            if (m_input.empty()) {
+                m_engine->render(m_scratch.data(), n, ahead);
+            } else {
+                resample(n, ahead);
+            }
+
+            const size_t samples = n * AudioEngine::kTapChannels;
+            if (m_format.sampleFormat() == QAudioFormat::Float) {
+                std::memcpy(data + written, m_scratch.data(), samples * sizeof(float));
+            } else {
+                auto* out = reinterpret_cast<qint16*>(data + written);
+                for (size_t i = 0; i < samples; ++i) {
+                    out[i] = static_cast<qint16>(std::clamp(m_scratch[i], -1.0f, 1.0f) * 32767.0f);
+                }
+            }
+            written += static_cast<qint64>(n) * bytesPerFrame;
+            frames -= n;
+        }
+        return written;
+    }
+
+    qint64 writeData(const char*, qint64) override { return -1; }
+
+private:
+    // Linear interpolation from kTapSampleRate into m_scratch. ahead is in
+    // device frames; render() wants tap frames, including those rendered but
+    // not yet handed out.
+    void resample(size_t frames, size_t ahead) {
+        constexpr size_t channels = AudioEngine::kTapChannels;
+        const size_t need = static_cast<size_t>(m_position + frames * m_step) + 2;
+        if (need > m_inputFrames) {
+            const size_t pending = static_cast<size_t>(ahead * m_step + (m_inputFrames - m_position));
+            m_engine->render(m_input.data() + m_inputFrames * channels, need - m_inputFrames, pending);
+            m_inputFrames = need;
+        }
+
+        for (size_t k = 0; k < frames; ++k) {
+            const double t = m_position + k * m_step;
+            const size_t i = static_cast<size_t>(t);
+            const float f = static_cast<float>(t - i);
+            const float* a = m_input.data() + i * channels;
+            for (size_t c = 0; c < channels; ++c) {
+                m_scratch[k * channels + c] = a[c] + (a[channels + c] - a[c]) * f;
+            }
+        }
+
+        // Keep the frame the next output starts from and everything after it
+        m_position += frames * m_step;
+        const size_t consumed = static_cast<size_t>(m_position);
+        std::memmove(m_input.data(), m_input.data() + consumed * channels,
+                     (m_inputFrames - consumed) * channels * sizeof(float));
+        m_inputFrames -= consumed;
+        m_position -= consumed;
+    }
+
+    AudioEngine* m_engine;
+    QAudioSink* m_sink = nullptr;
+    QAudioFormat m_format;
+    double m_step;                 // Tap frames per device frame
+    std::vector<float> m_scratch;
+    std::vector<float> m_input;    // Tap-rate frames; empty when no resampling is needed
+    size_t m_inputFrames = 0;
+    double m_position = 0.0;       // Read position into m_input, in frames
+};
 
 AudioEngine::AudioEngine() {
-    m_player = new QMediaPlayer(this);
-    m_audioOutput = new QAudioOutput(this);
-    m_player->setAudioOutput(m_audioOutput);
-    
-    m_positionTimer = new QTimer(this);
-    connect(m_positionTimer, &QTimer::timeout, this, [this]() {
-        emit positionChanged(m_player->position());
-    });
-    
-    setupConnections();
-}
-
-void AudioEngine::setupConnections() {
-    connect(m_player, &QMediaPlayer::playbackStateChanged, this, [this](QMediaPlayer::PlaybackState state) {
-        switch (state) {
-        case QMediaPlayer::PlayingState:
-            m_positionTimer->start(100);
-            emit playbackStarted();
-            break;
-        case QMediaPlayer::PausedState:
-            m_positionTimer->stop();
-            emit playbackPaused();
-            break;
-        case QMediaPlayer::StoppedState:
-            m_positionTimer->stop();
-            emit playbackStopped();
-            break;
+    setupPcmTap();
+
+    m_decodeThread.setObjectName("AudioDecode");
+    for (int slot = 0; slot < 2; ++slot) {
+        auto* decoder = new TrackDecoder();
+        decoder->moveToThread(&m_decodeThread);
+        connect(&m_decodeThread, &QThread::finished, decoder, &QObject::deleteLater);
+        m_decoders[slot] = decoder;
+
+        // Only the owner's current slot drives pre-roll and duration
+        connect(decoder, &TrackDecoder::decodingFinished, this, [this, slot](quint32 generation) {
+            if (slot == m_slot && generation == m_slotGeneration[slot]) prerollNext();
+        });
+        connect(decoder, &TrackDecoder::durationChanged, this, [this, slot](quint32 generation, qint64 durationMs) {
+            if (slot == m_slot && generation == m_slotGeneration[slot]) emit durationChanged(durationMs);
+        });
+        connect(decoder, &TrackDecoder::failed, this, [this, slot](quint32 generation, const QString& reason) {
+            if (generation == m_slotGeneration[slot]) {
+                qWarning() << "⚠️ Could not decode" << QFileInfo(m_slotPath[slot]).fileName() << ":" << reason;
+            }
+        });
+    }
+    m_decodeThread.start();
+
+    m_eventTimer = new QTimer(this);
+    m_eventTimer->setInterval(kEventPollMs);
+    connect(m_eventTimer, &QTimer::timeout, this, &AudioEngine::pollAudioEvents);
+
+    setupOutput();
+}
+
+AudioEngine::~AudioEngine() {
+    m_outputThread.quit();
+    m_outputThread.wait();
+    m_decodeThread.quit();
+    m_decodeThread.wait();
+}
+
+void AudioEngine::setupOutput() {
+    const QAudioDevice device = QMediaDevices::defaultAudioOutput();
+    QAudioFormat format;
+    format.setChannelCount(kTapChannels);
+    auto supported = [&device, &format](int sampleRate) {
+        format.setSampleRate(sampleRate);
+        for (auto sampleFormat : {QAudioFormat::Float, QAudioFormat::Int16}) {
+            format.setSampleFormat(sampleFormat);
+            if (device.isFormatSupported(format)) return true;
+        }
+        return false;
+    };
+    // Anything but the tap rate costs a resampler on the output thread
+    if (!supported(kTapSampleRate) && !supported(device.preferredFormat().sampleRate())) {
+        qCritical() << "❌ Audio output" << device.description() << "takes neither float nor int16 stereo at"
+                    << kTapSampleRate << "Hz or its preferred" << device.preferredFormat().sampleRate()
+                    << "Hz; playback is disabled";
+        return;
+    }
+    m_sinkFormat = format;
+
+    // The sink pulls from its own high-priority thread, so nothing on the GUI
+    // thread can starve the output.
+    m_device = new PlaybackDevice(this, format);
+    m_device->moveToThread(&m_outputThread);
+    connect(&m_outputThread, &QThread::finished, m_device, &QObject::deleteLater);
+    m_outputThread.setObjectName("AudioOutput");
+    m_outputThread.start(QThread::TimeCriticalPriority);
+
+    QMetaObject::invokeMethod(m_device, [this, device, format]() {
+        m_sink = new QAudioSink(device, format, m_device);
+        m_sink->setBufferSize(format.bytesForDuration(kSinkBufferUs));
+        m_device->setSink(m_sink);
+        m_device->open(QIODevice::ReadOnly);
+        m_sink->start(m_device);
+    }, Qt::BlockingQueuedConnection);
+
+    qDebug() << "🔊 Audio output:" << device.description() << format.sampleRate() << "Hz"
+             << (format.sampleFormat() == QAudioFormat::Float ? "float" : "int16")
+             << (format.sampleRate() != kTapSampleRate ? "(resampled)" : "");
+}
+
+void AudioEngine::setupPcmTap() {
+    for (auto& tap : m_taps) {
+        tap.ring = std::make_unique<SpscRingBuffer<float>>(kTapCapacityFrames * kTapChannels);
+    }
+}
+
+void AudioEngine::openSlot(int slot, const QString& filePath, qint64 startMs) {
+    const quint32 generation = ++m_generationCounter;
+    m_slotPath[slot] = filePath;
+    m_slotGeneration[slot] = generation;
+
+    TrackDecoder* decoder = m_decoders[slot];
+    QMetaObject::invokeMethod(decoder, [decoder, filePath, startMs, generation]() {
+        decoder->open(filePath, startMs, generation);
+    }, Qt::QueuedConnection);
+}
+
+void AudioEngine::prerollNext() {
+    const int slot = 1 - m_slot;
+    if (m_prerolledGeneration != 0 && m_slotGeneration[slot] == m_prerolledGeneration &&
+        m_slotPath[slot] == m_nextPath) {
+        return; // Already pre-rolled
+    }
+
+    // Revoke the current pre-roll first. If the output has already taken it,
+    // the transition is on its way and will pre-roll again from there.
+    quint32 expected = m_prerolledGeneration;
+    if (!m_nextGeneration.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) return;
+    m_prerolledGeneration = 0;
+    if (m_nextPath.isEmpty()) return;
+
+    openSlot(slot, m_nextPath, 0);
+    m_prerolledGeneration = m_slotGeneration[slot];
+    m_nextGeneration.store(m_prerolledGeneration, std::memory_order_release);
+}
+
+void AudioEngine::onTransition(int slot, quint32 generation) {
+    // Stale if a loadFile() or a new pre-roll superseded it in the meantime
+    if (generation != m_prerolledGeneration || m_slotGeneration[slot] != generation) return;
+
+    m_prerolledGeneration = 0;
+    m_slot = slot;
+    emit durationChanged(m_decoders[slot]->durationMs());
+    emit trackTransition(m_slotPath[slot]);
+
+    // A short track may already be decoded to the end
+    if (m_decoders[slot]->isDecodingFinished()) prerollNext();
+}
+
+void AudioEngine::pollAudioEvents() {
+    const quint64 transition = m_transitioned.exchange(0, std::memory_order_acq_rel);
+    if (transition != 0) onTransition(static_cast<int>(transition & 1), static_cast<quint32>(transition >> 1));
+    if (m_finishPending.exchange(false, std::memory_order_acq_rel)) emit playbackFinished();
+}
+
+void AudioEngine::render(float* dst, size_t frames, size_t queuedFrames) {
+    // A cut requested by loadFile() applies once the target slot holds the new track
+    quint64 pending = m_pendingSwitch.load(std::memory_order_acquire);
+    if (pending != 0) {
+        const int slot = static_cast<int>(pending & 1);
+        if (m_decoders[slot]->generation() == static_cast<quint32>(pending >> 1) &&
+            m_pendingSwitch.compare_exchange_strong(pending, 0, std::memory_order_acq_rel)) {
+            m_current.store(slot, std::memory_order_release);
+        }
+    }
+    for (TrackDecoder* decoder : m_decoders) decoder->acknowledge();
+
+    const quint64 streamStart = m_streamFrames;
+    size_t done = 0;
+    while (m_playing.load(std::memory_order_relaxed) && done < frames) {
+        const int slot = m_current.load(std::memory_order_relaxed);
+        TrackDecoder* current = m_decoders[slot];
+        const size_t got = current->read(dst + done * kTapChannels, frames - done);
+        if (got > 0) {
+            done += got;
+            recordSegment(streamStart + done, true);
+        }
+        if (done == frames) break;
+
+        if (current->atEnd()) {
+            quint32 nextGeneration = m_nextGeneration.load(std::memory_order_acquire);
+            TrackDecoder* next = m_decoders[1 - slot];
+            if (nextGeneration != 0) {
+                if (next->generation() == nextGeneration && next->isReady() &&
+                    m_nextGeneration.compare_exchange_strong(nextGeneration, 0, std::memory_order_acq_rel)) {
+                    // Sample-accurate switch: the rest of this buffer comes from the next track
+                    m_current.store(1 - slot, std::memory_order_release);
+                    m_transitioned.store(packSwitch(1 - slot, nextGeneration), std::memory_order_release);
+                    continue;
+                }
+                // Pre-roll still on its way: wait for it rather than stopping
+            } else if (!m_endSignalled.exchange(true, std::memory_order_relaxed)) {
+                m_finishPending.store(true, std::memory_order_release);
+            }
+        } else if (current->framesRead() > 0) {
+            m_underrunFrames.fetch_add(frames - done, std::memory_order_relaxed);
+        }
+        break;
+    }
+
+    if (done < frames) {
+        // Paused, waiting or underrun: the device plays silence, the track stands still
+        std::fill(dst + done * kTapChannels, dst + frames * kTapChannels, 0.0f);
+        recordSegment(streamStart + frames, false);
+    }
+    m_streamFrames = streamStart + frames;
+    updateClock(streamStart, queuedFrames);
+
+    publishPcm(dst, frames);
+}
+
+void AudioEngine::recordSegment(quint64 streamEnd, bool advancing) {
+    const TrackDecoder* decoder = m_decoders[m_current.load(std::memory_order_relaxed)];
+    Segment& segment = m_segments[m_segmentHead++ % m_segments.size()];
+    segment.streamEnd = streamEnd;
+    segment.trackEnd = decoder->startFrame() + decoder->framesRead();
+    segment.generation = decoder->generation();
+    segment.advancing = advancing;
+}
+
+void AudioEngine::updateClock(quint64 streamStart, size_t queuedFrames) {
+    const qint64 now = steadyNowNs();
+    const quint64 handed = m_streamFrames;
+
+    // The frame at the DAC right now. Never behind what readers may already
+    // have extrapolated to, so the stream clock stays monotonic.
+    quint64 played = streamStart > queuedFrames ? streamStart - queuedFrames : 0;
+    const PlaybackClock previous = m_clock.load();
+    const double previousElapsed = (now - previous.steadyNs) * 1e-9 * kTapSampleRate;
+    const quint64 previousPlayed = previous.streamFrame +
+        static_cast<quint64>(std::clamp(previousElapsed, 0.0, static_cast<double>(previous.streamRunway)));
+    played = std::min(std::max(played, previousPlayed), handed);
+
+    PlaybackClock clock;
+    clock.streamFrame = played;
+    clock.streamRunway = handed - played;
+    clock.steadyNs = now;
+
+    // Map the played frame back to the track through the recent segments,
+    // newest first, then see how long the track keeps running from there.
+    const size_t count = std::min<size_t>(m_segmentHead, m_segments.size());
+    size_t found = 0;
+    while (found + 1 < count) {
+        const Segment& older = m_segments[(m_segmentHead - found - 2) % m_segments.size()];
+        if (older.streamEnd <= played) break;
+        ++found;
+    }
+    if (count > 0) {
+        const Segment& segment = m_segments[(m_segmentHead - found - 1) % m_segments.size()];
+        const quint64 ahead = segment.streamEnd > played ? segment.streamEnd - played : 0;
+        clock.generation = segment.generation;
+        clock.trackFrame = segment.advancing && segment.trackEnd > ahead ? segment.trackEnd - ahead : segment.trackEnd;
+
+        quint64 runway = segment.advancing ? ahead : 0;
+        for (size_t i = found; segment.advancing && i > 0; --i) {
+            const Segment& newer = m_segments[(m_segmentHead - i) % m_segments.size()];
+            const Segment& before = m_segments[(m_segmentHead - i - 1) % m_segments.size()];
+            if (!newer.advancing || newer.generation != segment.generation) break;
+            runway += newer.streamEnd - before.streamEnd;
         }
-    });
-    
-    connect(m_player, &QMediaPlayer::mediaStatusChanged, this, [this](QMediaPlayer::MediaStatus status) {
-        if (status == QMediaPlayer::EndOfMedia) {
-            emit playbackFinished();
+        clock.trackRunway = runway;
+    }
+    m_clock.store(clock);
+}
+
+void AudioEngine::publishPcm(const float* samples, size_t frames) {
+    for (auto& tap : m_taps) {
+        // Only write whole frames so readers stay channel-aligned
+        const size_t room = tap.ring->writeAvailable() / kTapChannels;
+        const size_t n = std::min(frames, room);
+        tap.ring->write(samples, n * kTapChannels);
+        if (n < frames) {
+            tap.framesDropped.fetch_add(frames - n, std::memory_order_relaxed);
         }
-    });
-    
-    connect(m_player, &QMediaPlayer::durationChanged, this, &AudioEngine::durationChanged);
+    }
+}
+
+size_t AudioEngine::readPcm(PcmTap tap, float* dst, size_t maxFrames) {
+    Tap& t = m_taps[static_cast<size_t>(tap)];
+    const size_t frames = std::min(maxFrames, t.ring->readAvailable() / kTapChannels);
+    const size_t n = t.ring->read(dst, frames * kTapChannels) / kTapChannels;
+    t.framesRead.fetch_add(n, std::memory_order_relaxed);
+    return n;
+}
+
+size_t AudioEngine::pcmAvailable(PcmTap tap) const {
+    return m_taps[static_cast<size_t>(tap)].ring->readAvailable() / kTapChannels;
+}
+
+quint64 AudioEngine::pcmReadPosition(PcmTap tap) const {
+    const Tap& t = m_taps[static_cast<size_t>(tap)];
+    return t.framesRead.load(std::memory_order_relaxed) + t.framesDropped.load(std::memory_order_relaxed);
+}
+
+size_t AudioEngine::discardPcm(PcmTap tap) {
+    Tap& t = m_taps[static_cast<size_t>(tap)];
+    const size_t n = t.ring->discard(t.ring->readAvailable()) / kTapChannels;
+    t.framesRead.fetch_add(n, std::memory_order_relaxed);
+    return n;
+}
+
+quint64 AudioEngine::droppedPcmFrames(PcmTap tap) const {
+    return m_taps[static_cast<size_t>(tap)].framesDropped.load(std::memory_order_relaxed);
+}
+
+quint64 AudioEngine::droppedPcmFrames() const {
+    quint64 total = 0;
+    for (const Tap& tap : m_taps) total += tap.framesDropped.load(std::memory_order_relaxed);
+    return total;
 }
 
 bool AudioEngine::loadFile(const QString& filePath) {
-    m_player->setSource(QUrl::fromLocalFile(filePath));
-    return m_player->error() == QMediaPlayer::NoError;
+    if (!QFileInfo::exists(filePath)) {
+        qWarning() << "⚠️ Audio file not found:" << filePath;
+        return false;
+    }
+
+    // Decode into the slot the output is not reading, then cut over to it.
+    // Any pre-roll belonged to the old track and is dropped.
+    const int slot = 1 - m_current.load(std::memory_order_acquire);
+    m_nextGeneration.store(0, std::memory_order_release);
+    m_prerolledGeneration = 0;
+
+    openSlot(slot, filePath, 0);
+    m_slot = slot;
+    m_endSignalled.store(false, std::memory_order_relaxed);
+    m_finishPending.store(false, std::memory_order_relaxed);
+    m_pendingSwitch.store(packSwitch(slot, m_slotGeneration[slot]), std::memory_order_release);
+    return true;
+}
+
+void AudioEngine::setNextFile(const QString& filePath) {
+    if (filePath == m_nextPath) return;
+    m_nextPath = filePath;
+
+    // Pre-roll starts once the current track is fully decoded; if that is
+    // already the case, (re)do it now.
+    TrackDecoder* current = m_decoders[m_slot];
+    if (current->generation() == m_slotGeneration[m_slot] && current->isDecodingFinished()) {
+        prerollNext();
+    }
 }
 
-void AudioEngine::play() {
-    m_player->play();
+bool AudioEngine::play() {
+    // Without a sink nothing pulls the audio, so the clock would never move
+    if (!m_device) {
+        qWarning() << "❌ Cannot play: no usable audio output";
+        return false;
+    }
+    if (m_playing.exchange(true)) return true;
+    m_eventTimer->start();
+    emit playbackStarted();
+    return true;
 }
 
 void AudioEngine::pause() {
-    m_player->pause();
+    if (!m_playing.exchange(false)) return;
+    emit playbackPaused();
 }
 
 void AudioEngine::stop() {
-    m_player->stop();
+    m_playing.store(false);
+    // What the audio thread flagged before this is moot now
+    m_eventTimer->stop();
+    m_transitioned.store(0, std::memory_order_relaxed);
+    m_finishPending.store(false, std::memory_order_relaxed);
+
+    m_nextGeneration.store(0, std::memory_order_release);
+    m_prerolledGeneration = 0;
+    m_pendingSwitch.store(0, std::memory_order_release);
+    for (int slot = 0; slot < 2; ++slot) {
+        const quint32 generation = ++m_generationCounter;
+        m_slotPath[slot].clear();
+        m_slotGeneration[slot] = generation;
+        TrackDecoder* decoder = m_decoders[slot];
+        QMetaObject::invokeMethod(decoder, [decoder, generation]() { decoder->close(generation); },
+                                  Qt::QueuedConnection);
+    }
+    emit playbackStopped();
+}
+
+PlaybackClock AudioEngine::clock() const {
+    return m_clock.load();
 }
 
-bool AudioEngine::isPlaying() const {
-    return m_player->playbackState() == QMediaPlayer::PlayingState;
+double AudioEngine::streamSeconds() const {
+    const PlaybackClock clock = m_clock.load();
+    const double elapsed = (steadyNowNs() - clock.steadyNs) * 1e-9 * kTapSampleRate;
+    return (clock.streamFrame + std::clamp(elapsed, 0.0, static_cast<double>(clock.streamRunway))) / kTapSampleRate;
 }
 
-qint64 AudioEngine::position() const {
-    return m_player->position();
+double AudioEngine::positionMs() const {
+    const PlaybackClock clock = m_clock.load();
+    const double elapsed = (steadyNowNs() - clock.steadyNs) * 1e-9 * kTapSampleRate;
+    return (clock.trackFrame + std::clamp(elapsed, 0.0, static_cast<double>(clock.trackRunway))) * 1000.0 / kTapSampleRate;
 }
 
 qint64 AudioEngine::duration() const {
-    return m_player->duration();
+    return m_decoders[m_slot]->durationMs();
 }
 
 void AudioEngine::setPosition(qint64 position) {
-    m_player->setPosition(position);
+    if (m_slotPath[m_slot].isEmpty()) return;
+
+    // Re-open the current slot at the new offset; the output drops the old
+    // data as soon as the decoder switches generation.
+    openSlot(m_slot, m_slotPath[m_slot], position);
+    quint64 pending = m_pendingSwitch.load(std::memory_order_acquire);
+    if (pending != 0 && static_cast<int>(pending & 1) == m_slot) {
+        m_pendingSwitch.compare_exchange_strong(pending, packSwitch(m_slot, m_slotGeneration[m_slot]));
+    }
+    emit positionChanged(position);
 }
 
 void AudioEngine::setVolume(int volume) {
-    m_audioOutput->setVolume(volume / 100.0f);
-}
\ No newline at end of file
+    if (!m_device) return;
+    QMetaObject::invokeMethod(m_device, [this, volume]() {
+        if (m_sink) m_sink->setVolume(volume / 100.0);
+    }, Qt::QueuedConnection);
+}
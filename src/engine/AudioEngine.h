@@ -1,10 +1,52 @@
 #pragma once
 #include <QObject>
-#include <QMediaPlayer>
-#include <QAudioOutput>
+#include <QAudioSink>
+#include <QAudioFormat>
+#include <QThread>
 #include <QTimer>
 #include <QString>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "../core/SeqLock.h"
+#include "../core/SpscRingBuffer.h"
+#include "TrackDecoder.h"
 
+// Consumers of the played PCM stream. Each one gets its own SPSC ring so the
+// readers never contend with each other or with the audio thread.
+enum class PcmTap {
+    Visualizer,
+    Analyzer,
+    Recorder,   // Overflows while nothing records; discardPcm() before reading
+    Count
+};
+
+class PlaybackDevice;
+
+// Snapshot of the playback clock, taken by the audio thread each time it
+// hands data to the device. Frame counts are at kTapSampleRate.
+struct PlaybackClock {
+    quint64 streamFrame = 0;    // Output frame at the DAC when sampled (includes silence)
+    quint64 streamRunway = 0;   // Frames already handed over beyond streamFrame
+    quint64 trackFrame = 0;     // Track position of streamFrame
+    quint64 trackRunway = 0;    // Frames the track keeps running for without a pause or cut
+    quint32 generation = 0;     // Decoder generation of that track
+    qint64 steadyNs = 0;        // Steady clock when sampled
+};
+
+// Gapless playback engine.
+//
+// Two TrackDecoders alternate between "current" and "next". Once the current
+// track has been fully decoded (its tail sits in the decoder's bounded ring),
+// the next track is opened and pre-rolled into the other decoder. The audio
+// output thread pulls from the current decoder and, on the very sample where
+// it runs dry, continues from the next one, so there is no gap and no stall.
+//
+// The audio thread never locks or allocates: decoders, taps and the switch
+// state are all lock-free, and what the owner has to hear about (a track
+// transition, the end of playback) is left in atomics it polls. Everything
+// else runs on the thread that owns the engine (the GUI thread).
 class AudioEngine : public QObject {
     Q_OBJECT
 public:
@@ -13,32 +55,133 @@ public:
         return s;
     }
 
+    // Tap format: interleaved stereo float at kTapSampleRate
+    static constexpr int kTapChannels = TrackDecoder::kChannels;
+    static constexpr int kTapSampleRate = TrackDecoder::kSampleRate;
+    static constexpr size_t kTapCapacityFrames = 1 << 15; // ~680 ms
+
+    // Starts decoding filePath; it replaces the current track as soon as its
+    // first samples are decoded.
     bool loadFile(const QString& filePath);
-    void play();
+    // The track to continue with gaplessly when the current one ends. An
+    // empty path means playback stops at the end of the current track.
+    void setNextFile(const QString& filePath);
+    QString currentFile() const { return m_slotPath[m_slot]; }
+
+    // False if there is no audio output to play through
+    bool play();
     void pause();
     void stop();
-    
-    bool isPlaying() const;
-    qint64 position() const;
+
+    bool isPlaying() const { return m_playing.load(std::memory_order_relaxed); }
     qint64 duration() const;
-    
+
+    // Playback clock, lock-free from any thread. It counts the samples
+    // actually handed to the output device, minus what the device still has
+    // queued, and is extrapolated on the steady clock between audio
+    // callbacks for sub-millisecond precision. This is the master clock for
+    // the renderer and the recorder.
+    PlaybackClock clock() const;
+    double streamSeconds() const;   // Monotonic output time, including pauses
+    double positionMs() const;      // Audible position in the current track
+    qint64 position() const { return static_cast<qint64>(positionMs()); }
+
     void setPosition(qint64 position);
     void setVolume(int volume);
 
+    // Lock-free read side of a PCM tap. Returns the number of frames copied
+    // into dst (which must hold maxFrames * kTapChannels floats).
+    size_t readPcm(PcmTap tap, float* dst, size_t maxFrames);
+    size_t pcmAvailable(PcmTap tap) const;
+    // Output stream frame (see PlaybackClock::streamFrame) of the next frame
+    // readPcm() returns. Exact unless the tap overflowed, then within the
+    // frames dropped since.
+    quint64 pcmReadPosition(PcmTap tap) const;
+    // Drops everything queued in the tap, making pcmReadPosition() exact
+    // again after an overflow. Reader side only.
+    size_t discardPcm(PcmTap tap);
+    quint64 droppedPcmFrames() const;
+    quint64 droppedPcmFrames(PcmTap tap) const;
+    quint64 underrunFrames() const { return m_underrunFrames.load(std::memory_order_relaxed); }
+
 signals:
     void playbackStarted();
     void playbackPaused();
     void playbackStopped();
     void playbackFinished();
-    void positionChanged(qint64 position);
+    // The output moved on to the pre-rolled next track without a gap
+    void trackTransition(const QString& filePath);
+    void positionChanged(qint64 position);  // Seeks only; poll the clock for progress
     void durationChanged(qint64 duration);
 
 private:
+    friend class PlaybackDevice;
+
     AudioEngine();
-    
-    QMediaPlayer* m_player = nullptr;
-    QAudioOutput* m_audioOutput = nullptr;
-    QTimer* m_positionTimer = nullptr;
-    
-    void setupConnections();
-};
\ No newline at end of file
+    ~AudioEngine();
+
+    void setupOutput();
+    void setupPcmTap();
+    void openSlot(int slot, const QString& filePath, qint64 startMs);
+    void prerollNext();
+    void onTransition(int slot, quint32 generation);
+    // Owner thread: acts on what the audio thread flagged
+    void pollAudioEvents();
+
+    // Audio thread. queuedFrames is what the device holds ahead of dst.
+    void render(float* dst, size_t frames, size_t queuedFrames);
+    void recordSegment(quint64 streamEnd, bool advancing);
+    void updateClock(quint64 streamStart, size_t queuedFrames);
+    void publishPcm(const float* samples, size_t frames);
+
+    static quint64 packSwitch(int slot, quint32 generation) { return (quint64(generation) << 1) | quint64(slot); }
+
+    QThread m_outputThread;
+    QThread m_decodeThread;
+    PlaybackDevice* m_device = nullptr;
+    QAudioSink* m_sink = nullptr;          // Lives on the output thread
+    QAudioFormat m_sinkFormat;
+    QTimer* m_eventTimer = nullptr;        // Runs pollAudioEvents() from play() to stop()
+
+    std::array<TrackDecoder*, 2> m_decoders{};
+
+    // Owner-thread view of the slots
+    std::array<QString, 2> m_slotPath;
+    std::array<quint32, 2> m_slotGeneration{};
+    int m_slot = 0;                        // Slot the owner considers current
+    quint32 m_generationCounter = 0;
+    quint32 m_prerolledGeneration = 0;    // Last generation published as next
+    QString m_nextPath;
+
+    // Shared with the audio thread
+    std::atomic<bool> m_playing{false};
+    std::atomic<int> m_current{0};         // Slot the output is reading
+    std::atomic<quint64> m_pendingSwitch{0}; // packSwitch() of a requested cut, 0 = none
+    std::atomic<quint32> m_nextGeneration{0}; // Generation pre-rolled as next, 0 = none
+    std::atomic<bool> m_endSignalled{false};
+    std::atomic<quint64> m_transitioned{0};  // packSwitch() of a transition not yet handled, 0 = none
+    std::atomic<bool> m_finishPending{false};
+    std::atomic<quint64> m_underrunFrames{0};
+
+    // Audio thread: recent stretches of output and where the track stood at
+    // their end, used to map the frame at the DAC back to a track position
+    struct Segment {
+        quint64 streamEnd = 0;
+        quint64 trackEnd = 0;
+        quint32 generation = 0;
+        bool advancing = false;
+    };
+    std::array<Segment, 128> m_segments{};
+    size_t m_segmentHead = 0;
+    quint64 m_streamFrames = 0;
+    SeqLock<PlaybackClock> m_clock;
+
+    // Taps receive every output frame, silence included, so tap frames line
+    // up with the stream clock
+    struct Tap {
+        std::unique_ptr<SpscRingBuffer<float>> ring;
+        std::atomic<quint64> framesRead{0};
+        std::atomic<quint64> framesDropped{0};
+    };
+    std::array<Tap, static_cast<size_t>(PcmTap::Count)> m_taps;
+};
@@ -0,0 +1,470 @@
+#include "BatchRenderer.h"
+#include "PlaylistManager.h"
+#include "SegmentJoiner.h"
+#include "../core/StringUtils.h"
+#include "../data/SettingsManager.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QRegularExpression>
+#include <QThread>
+#include <QTimer>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#ifdef VIBESYNC_LIBAV_ENCODER
+extern "C" {
+#include <libavformat/avformat.h>
+}
+#endif
+
+namespace {
+constexpr int kReportIntervalMs = 10000;
+
+// OfflineRenderer's progress and result lines
+const QRegularExpression kProgressLine(R"((\d+)%\s+([\d.]+)x real time)");
+const QRegularExpression kResultLine(R"(Rendered ([\d.]+) s of video in ([\d.]+) s)");
+
+#ifdef VIBESYNC_LIBAV_ENCODER
+// From the container; 0 if unknown. Only splits the work, so it need not be exact.
+double probeSeconds(const QString& path) {
+    const QByteArray file = path.toUtf8();
+    AVFormatContext* format = nullptr;
+    if (avformat_open_input(&format, file.constData(), nullptr, nullptr) < 0) return 0.0;
+    double seconds = 0.0;
+    if (avformat_find_stream_info(format, nullptr) >= 0 && format->duration != AV_NOPTS_VALUE) {
+        seconds = format->duration / double(AV_TIME_BASE);
+    }
+    avformat_close_input(&format);
+    return seconds;
+}
+#endif
+}
+
+BatchRenderer::BatchRenderer(const Options& options) : m_options(options) {}
+
+BatchRenderer::~BatchRenderer() = default;
+
+QList<int> BatchRenderer::availableCpus() {
+    QList<int> cpus;
+#ifdef __linux__
+    // Honours taskset and cgroup cpusets the batch itself was started under
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) cpus << cpu;
+        }
+    }
+#endif
+    if (cpus.isEmpty()) {
+        for (int cpu = 0; cpu < QThread::idealThreadCount(); ++cpu) cpus << cpu;
+    }
+    return cpus;
+}
+
+bool BatchRenderer::prepareJobs(const QStringList& tracks) {
+    const QString extension = SettingsManager::instance().getRecordingAudioCodec() == "pcm" ? "mov" : "mp4";
+    const QDir outputDir(m_options.outputDirectory);
+
+    for (const QString& track : tracks) {
+        if (m_journal->find(track) >= 0) continue;
+        QString name = StringUtils::safeFilename(QFileInfo(track).completeBaseName());
+        if (name.isEmpty()) name = "UnknownTrack";
+        // Tracks of the same name from different folders
+        QString output = outputDir.absoluteFilePath(name + "." + extension);
+        for (int n = 2; m_journal->containsOutput(output); ++n) {
+            output = outputDir.absoluteFilePath(QString("%1_%2.%3").arg(name).arg(n).arg(extension));
+        }
+        m_journal->add(track, output);
+    }
+    return resumeJobs();
+}
+
+bool BatchRenderer::prepareSegments(qint64 totalFrames, int segments) {
+    const QString& track = m_options.segmentTrack;
+    // An earlier run's split stands, or its finished segments would not fit
+    if (m_journal->find(track) < 0) {
+        const QDir workDir(m_options.outputDirectory);
+        for (int i = 0; i < segments; ++i) {
+            const qint64 first = totalFrames * i / segments;
+            // The last one runs to the end of the audio, wherever the probe put it
+            const qint64 count = i + 1 < segments ? totalFrames * (i + 1) / segments - first : -1;
+            m_journal->add(track, workDir.absoluteFilePath(QString("segment_%1.mkv").arg(i, 3, 10, QChar('0'))), first,
+                           count);
+        }
+    }
+    return resumeJobs();
+}
+
+bool BatchRenderer::resumeJobs() {
+    // What an earlier run left behind
+    int done = 0;
+    int interrupted = 0;
+    for (int i = 0; i < m_journal->jobs().size(); ++i) {
+        RenderJob& job = m_journal->job(i);
+        if (!inPlaylist(job)) continue;
+        if (job.state == RenderJob::State::Done && QFileInfo::exists(job.output)) {
+            ++done;
+        } else if (job.state == RenderJob::State::Failed && job.attempts >= kMaxAttempts) {
+            // Stays failed; delete the journal to try again
+        } else {
+            if (job.state == RenderJob::State::Running) {
+                ++interrupted;
+                QFile::remove(job.output);  // Cut short, not a playable file
+            }
+            job.state = RenderJob::State::Pending;
+        }
+    }
+    if (done > 0 || interrupted > 0) {
+        qInfo().noquote() << QString("♻️ Resuming: %1 done, %2 interrupted and restarted").arg(done).arg(interrupted);
+    }
+    return m_journal->save();
+}
+
+int BatchRenderer::run() {
+    if (!m_options.segmentTrack.isEmpty()) return runSegmented();
+
+    const QStringList tracks = PlaylistManager::readPlaylist(m_options.playlistPath);
+    if (tracks.isEmpty()) {
+        qWarning() << "❌ No tracks in" << m_options.playlistPath;
+        return 1;
+    }
+    if (!QDir().mkpath(m_options.outputDirectory)) {
+        qWarning() << "❌ Could not create" << m_options.outputDirectory;
+        return 1;
+    }
+    m_options.outputDirectory = QDir(m_options.outputDirectory).absolutePath();
+    m_tracks = QSet<QString>(tracks.begin(), tracks.end());
+    m_journal = std::make_unique<RenderJournal>(m_options.outputDirectory);
+    if (!prepareJobs(tracks)) {
+        qWarning() << "❌ Could not write" << m_journal->path();
+        return 1;
+    }
+
+    int pending = 0;
+    for (const RenderJob& job : m_journal->jobs()) {
+        if (job.state == RenderJob::State::Pending && inPlaylist(job)) ++pending;
+    }
+
+    const QList<int> cpus = availableCpus();
+    int workers = m_options.workers > 0 ? m_options.workers : std::max(1, int(cpus.size()) / kCoresPerWorker);
+    workers = std::clamp(std::min(workers, pending), 1, int(cpus.size()));
+    qInfo().noquote() << QString("🎬 Batch: %1 tracks, %2 to render, %3 workers on %4 CPUs, output in %5")
+                             .arg(tracks.size()).arg(pending).arg(workers).arg(cpus.size())
+                             .arg(m_options.outputDirectory);
+
+    m_elapsed.start();
+    runJobs(workers);
+
+    // Totals over this playlist, earlier runs included
+    int done = 0;
+    int failed = 0;
+    double mediaSeconds = 0.0;
+    for (const RenderJob& job : m_journal->jobs()) {
+        if (!inPlaylist(job)) continue;
+        if (job.state == RenderJob::State::Done) {
+            ++done;
+            mediaSeconds += job.mediaSeconds;
+        } else {
+            ++failed;
+        }
+    }
+    const double wallSeconds = m_elapsed.elapsed() / 1000.0;
+    qInfo().noquote() << QString("📊 Batch finished in %1 s: %2 done, %3 failed, %4 min of video")
+                             .arg(wallSeconds, 0, 'f', 0).arg(done).arg(failed).arg(mediaSeconds / 60.0, 0, 'f', 1);
+    return failed > 0 ? 1 : 0;
+}
+
+void BatchRenderer::runJobs(int workers) {
+    // Disjoint, contiguous slices: neighbouring CPUs tend to share a cache
+    const QList<int> cpus = availableCpus();
+    workers = std::clamp(workers, 1, int(cpus.size()));
+    m_workers.resize(workers);
+    for (int i = 0; i < workers; ++i) {
+        const int first = int(cpus.size()) * i / workers;
+        const int last = int(cpus.size()) * (i + 1) / workers;
+        m_workers[i].cpus = cpus.mid(first, last - first);
+    }
+
+    QEventLoop loop;
+    QTimer report;
+    QObject::connect(&report, &QTimer::timeout, [this]() { reportProgress(); });
+    report.start(kReportIntervalMs);
+
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        Worker& worker = m_workers[i];
+        worker.process = new QProcess(&loop);
+        worker.process->setProcessChannelMode(QProcess::MergedChannels);
+        QObject::connect(worker.process, &QProcess::readyReadStandardOutput, &loop, [this, i]() {
+            readOutput(m_workers[i]);
+        });
+        // The next job starts from the event loop, not inside the process's own signal
+        auto jobEnded = [this, i, &loop](bool ok) {
+            Worker& worker = m_workers[i];
+            readOutput(worker);
+            finishJob(worker, ok);
+            QMetaObject::invokeMethod(&loop, [this, i, &loop]() {
+                if (!startNext(m_workers[i]) && !anyRunning()) loop.quit();
+            }, Qt::QueuedConnection);
+        };
+        QObject::connect(worker.process, &QProcess::finished, &loop,
+                         [jobEnded](int exitCode, QProcess::ExitStatus status) {
+            jobEnded(status == QProcess::NormalExit && exitCode == 0);
+        });
+        // Without a process there is no finished()
+        QObject::connect(worker.process, &QProcess::errorOccurred, &loop, [jobEnded](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) jobEnded(false);
+        });
+        startNext(worker);
+    }
+    if (anyRunning()) loop.exec();
+    report.stop();
+    m_workers.clear();
+}
+
+int BatchRenderer::runSegmented() {
+#ifndef VIBESYNC_LIBAV_ENCODER
+    qWarning() << "❌ Segmented rendering needs the in-process encoder, which this build lacks";
+    return 1;
+#else
+    m_options.segmentTrack = QFileInfo(m_options.segmentTrack).absoluteFilePath();
+    const QString& track = m_options.segmentTrack;
+    const QString output = QFileInfo(m_options.segmentOutput).absoluteFilePath();
+
+    // Spelled out for the workers: every segment has to be encoded alike,
+    // even when the settings change before a retry
+    const SettingsManager& settings = SettingsManager::instance();
+    if (m_options.size.isEmpty()) m_options.size = settings.getRecordingSize();
+    if (m_options.fps <= 0) m_options.fps = settings.getRecordingFps();
+    const int fps = m_options.fps;
+
+    const double seconds = probeSeconds(track);
+    if (seconds <= 0.0) {
+        qWarning() << "❌ Could not tell the length of" << track;
+        return 1;
+    }
+    const qint64 totalFrames = qint64(std::ceil(seconds * fps));
+
+    m_options.outputDirectory = output + ".segments";
+    if (!QDir().mkpath(m_options.outputDirectory)) {
+        qWarning() << "❌ Could not create" << m_options.outputDirectory;
+        return 1;
+    }
+    m_tracks = {track};
+    m_journal = std::make_unique<RenderJournal>(m_options.outputDirectory);
+
+    const QList<int> cpus = availableCpus();
+    int workers = m_options.workers > 0 ? m_options.workers : std::max(1, int(cpus.size()) / kCoresPerWorker);
+    workers = std::clamp(workers, 1, int(cpus.size()));
+    const int segments = int(std::clamp<qint64>(totalFrames / (qint64(kMinSegmentSeconds) * fps), 1, workers));
+    if (!prepareSegments(totalFrames, segments)) {
+        qWarning() << "❌ Could not write" << m_journal->path();
+        return 1;
+    }
+
+    int pending = 0;
+    for (const RenderJob& job : m_journal->jobs()) {
+        if (job.state == RenderJob::State::Pending && inPlaylist(job)) ++pending;
+    }
+    workers = std::clamp(workers, 1, std::max(pending, 1));
+    qInfo().noquote() << QString("🎬 Segmented render: %1 (%2 s) in %3 segments, %4 to render, %5 s pre-roll, "
+                                 "%6 workers on %7 CPUs")
+                             .arg(QFileInfo(track).fileName()).arg(seconds, 0, 'f', 1)
+                             .arg(m_journal->jobs().size()).arg(pending).arg(m_options.prerollSeconds, 0, 'f', 1)
+                             .arg(workers).arg(cpus.size());
+
+    m_elapsed.start();
+    if (pending > 0) runJobs(workers);
+
+    // Journal order is frame order
+    QList<SegmentJoiner::Segment> parts;
+    int failed = 0;
+    double mediaSeconds = 0.0;
+    for (const RenderJob& job : m_journal->jobs()) {
+        if (!inPlaylist(job)) continue;
+        if (job.state != RenderJob::State::Done) {
+            ++failed;
+            continue;
+        }
+        parts.append({job.output, job.firstFrame});
+        mediaSeconds += job.mediaSeconds;
+    }
+    if (failed > 0) {
+        // The finished segments stay for the next run
+        qWarning().noquote() << QString("❌ %1 of %2 segments failed; see %3")
+                                    .arg(failed).arg(failed + parts.size()).arg(m_journal->path());
+        return 1;
+    }
+
+    const QString audioCodec = settings.getRecordingAudioCodec();
+    SegmentJoiner joiner(output, fps, audioCodec == "none" ? QString() : audioCodec);
+    if (!joiner.join(parts)) {
+        qWarning() << "❌ Could not join the segments:" << joiner.errorString();
+        return 1;
+    }
+    for (const SegmentJoiner::Segment& part : parts) QFile::remove(part.path);
+    QFile::remove(m_journal->path());
+    QDir().rmdir(m_options.outputDirectory);
+
+    const double wallSeconds = m_elapsed.elapsed() / 1000.0;
+    qInfo().noquote() << QString("✅ Rendered %1 s of video in %2 s (%3x real time): %4")
+                             .arg(mediaSeconds, 0, 'f', 1)
+                             .arg(wallSeconds, 0, 'f', 1)
+                             .arg(mediaSeconds / std::max(wallSeconds, 0.001), 0, 'f', 2)
+                             .arg(output);
+    return 0;
+#endif
+}
+
+bool BatchRenderer::startNext(Worker& worker) {
+    worker.job = -1;
+    const QList<RenderJob>& jobs = m_journal->jobs();
+    while (m_nextJob < jobs.size() && (jobs[m_nextJob].state != RenderJob::State::Pending || !inPlaylist(jobs[m_nextJob]))) {
+        ++m_nextJob;
+    }
+    if (m_nextJob >= jobs.size()) return false;
+
+    worker.job = m_nextJob++;
+    RenderJob& job = m_journal->job(worker.job);
+    job.state = RenderJob::State::Running;
+    ++job.attempts;
+    job.error.clear();
+    m_journal->save();
+
+    QStringList arguments{"--render", job.track, "--out", job.output};
+    if (!m_options.presetPath.isEmpty()) arguments << "--render-preset" << m_options.presetPath;
+    if (!m_options.size.isEmpty()) {
+        arguments << "--render-size" << QString("%1x%2").arg(m_options.size.width()).arg(m_options.size.height());
+    }
+    if (m_options.fps > 0) arguments << "--render-fps" << QString::number(m_options.fps);
+    if (!m_options.segmentTrack.isEmpty()) {
+        // Lossless audio, encoded once for the whole track when joining
+        // Renditions would have to be joined too; render them from the result instead
+        arguments << "--render-audio" << "flac" << "--render-renditions" << "none"
+                  << "--render-start-frame" << QString::number(job.firstFrame)
+                  << "--render-preroll" << QString::number(m_options.prerollSeconds);
+        if (job.frameCount >= 0) arguments << "--render-frame-count" << QString::number(job.frameCount);
+    }
+
+    // llvmpipe counts the CPUs of the machine, not of the affinity mask
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert("LP_NUM_THREADS", QString::number(worker.cpus.size()));
+    worker.process->setProcessEnvironment(environment);
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : worker.cpus) CPU_SET(cpu, &set);
+    // Runs in the child before exec; threads it starts inherit the mask
+    worker.process->setChildProcessModifier([set]() { sched_setaffinity(0, sizeof(set), &set); });
+#endif
+
+    worker.percent = 0;
+    worker.speed = 0.0;
+    worker.lastError.clear();
+    worker.partialLine.clear();
+    worker.timer.start();
+    worker.process->start(QCoreApplication::applicationFilePath(), arguments);
+    qInfo().noquote() << QString("▶️ %1 (attempt %2, CPUs %3-%4)")
+                             .arg(jobName(job)).arg(job.attempts)
+                             .arg(worker.cpus.first()).arg(worker.cpus.last());
+    return true;
+}
+
+void BatchRenderer::readOutput(Worker& worker) {
+    worker.partialLine += worker.process->readAll();
+    qsizetype newline;
+    while ((newline = worker.partialLine.indexOf('\n')) >= 0) {
+        const QString line = QString::fromUtf8(worker.partialLine.left(newline)).trimmed();
+        worker.partialLine.remove(0, newline + 1);
+
+        const QRegularExpressionMatch progress = kProgressLine.match(line);
+        if (progress.hasMatch()) {
+            worker.percent = progress.captured(1).toInt();
+            worker.speed = progress.captured(2).toDouble();
+            continue;
+        }
+        const QRegularExpressionMatch result = kResultLine.match(line);
+        if (result.hasMatch() && worker.job >= 0) {
+            RenderJob& job = m_journal->job(worker.job);
+            job.mediaSeconds = result.captured(1).toDouble();
+            continue;
+        }
+        if (line.startsWith("❌")) worker.lastError = line;
+        if (worker.job >= 0 && (line.startsWith("❌") || line.startsWith("⚠️"))) {
+            qWarning().noquote() << jobName(m_journal->jobs()[worker.job]) << line;
+        }
+    }
+}
+
+void BatchRenderer::finishJob(Worker& worker, bool ok) {
+    if (worker.job < 0) return;
+    RenderJob& job = m_journal->job(worker.job);
+    job.wallSeconds = worker.timer.elapsed() / 1000.0;
+    const QString name = jobName(job);
+
+    if (ok) {
+        job.state = RenderJob::State::Done;
+        qInfo().noquote() << QString("✅ %1: %2 s in %3 s (%4x real time)")
+                                 .arg(name)
+                                 .arg(job.mediaSeconds, 0, 'f', 1)
+                                 .arg(job.wallSeconds, 0, 'f', 1)
+                                 .arg(job.mediaSeconds / std::max(job.wallSeconds, 0.001), 0, 'f', 2);
+    } else {
+        job.error = worker.lastError.isEmpty() ? worker.process->errorString() : worker.lastError;
+        QFile::remove(job.output);
+        // Retried next while attempts remain
+        if (job.attempts < kMaxAttempts) {
+            job.state = RenderJob::State::Pending;
+            m_nextJob = std::min(m_nextJob, worker.job);
+            qWarning().noquote() << "⚠️" << name << "failed, will retry:" << job.error;
+        } else {
+            job.state = RenderJob::State::Failed;
+            qWarning().noquote() << "❌" << name << "failed:" << job.error;
+        }
+    }
+    m_journal->save();
+}
+
+QString BatchRenderer::jobName(const RenderJob& job) const {
+    const QString name = QFileInfo(job.track).fileName();
+    if (m_options.segmentTrack.isEmpty()) return name;
+    const QString last = job.frameCount >= 0 ? QString::number(job.firstFrame + job.frameCount - 1) : QString("end");
+    return QString("%1 [frames %2-%3]").arg(name).arg(job.firstFrame).arg(last);
+}
+
+bool BatchRenderer::anyRunning() const {
+    return std::any_of(m_workers.begin(), m_workers.end(), [](const Worker& worker) { return worker.job >= 0; });
+}
+
+void BatchRenderer::reportProgress() const {
+    int done = 0;
+    int pending = 0;
+    double mediaSeconds = 0.0;
+    for (const RenderJob& job : m_journal->jobs()) {
+        if (job.state == RenderJob::State::Done) {
+            ++done;
+            mediaSeconds += job.mediaSeconds;
+        } else if (job.state == RenderJob::State::Pending) {
+            ++pending;
+        }
+    }
+
+    QStringList running;
+    for (const Worker& worker : m_workers) {
+        if (worker.job < 0) continue;
+        running << QString("%1 %2% %3x").arg(jobName(m_journal->jobs()[worker.job]))
+                                         .arg(worker.percent).arg(worker.speed, 0, 'f', 1);
+    }
+    qInfo().noquote() << QString("📊 %1 done, %2 pending, %3 min of video so far | %4")
+                             .arg(done).arg(pending).arg(mediaSeconds / 60.0, 0, 'f', 1).arg(running.join(", "));
+}
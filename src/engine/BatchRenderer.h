@@ -0,0 +1,97 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QList>
+#include <QSet>
+#include <QSize>
+#include <QString>
+#include <memory>
+#include <vector>
+#include "../data/RenderJournal.h"
+
+class QProcess;
+
+// Renders every track of a playlist to video with a pool of worker
+// processes, each an OfflineRenderer (vibe-sync --render) of its own.
+//
+// Processes rather than threads: every worker gets its own GL context,
+// projectM instance and encoder, and a crash takes down one track, not the
+// batch. Each worker is pinned to a disjoint slice of the CPUs this process
+// may use, and llvmpipe, x264 and Qt's thread pool size themselves from the
+// affinity mask, so the workers never fight over cores. The RenderJournal
+// in the output directory records every job's state; running the same
+// batch again skips what is done and redoes what was interrupted.
+//
+// Segmented mode renders one long track instead: it is cut into one
+// segment per worker, each rendered from a few seconds earlier (the
+// pre-roll, rendered but not encoded) so that projectM's feedback buffers
+// and beat detection have settled by the first encoded frame. The segments
+// are then joined by SegmentJoiner without re-encoding the video. Presets
+// drawing random numbers can still differ visibly at a seam.
+class BatchRenderer {
+public:
+    struct Options {
+        QString playlistPath;       // M3U/M3U8 or a directory
+        QString outputDirectory;
+        int workers = 0;            // 0: one per kCoresPerWorker CPUs
+        QString presetPath;         // Passed on to the workers
+        QSize size;                 // Empty: the workers' recording settings
+        int fps = 0;                // 0: likewise
+
+        // Segmented mode, when segmentTrack is set; the segments and their
+        // journal go in a work directory next to segmentOutput
+        QString segmentTrack;
+        QString segmentOutput;
+        double prerollSeconds = 8.0;
+    };
+
+    // Enough for llvmpipe's rasteriser threads plus the encoder and the
+    // YUV conversion; with fewer, encoding starves the renderer
+    static constexpr int kCoresPerWorker = 4;
+    // Attempts per track, counting the ones of earlier runs
+    static constexpr int kMaxAttempts = 2;
+    // Shorter segments spend more on pre-roll than they save
+    static constexpr int kMinSegmentSeconds = 30;
+
+    explicit BatchRenderer(const Options& options);
+    ~BatchRenderer();
+
+    // Needs a QCoreApplication. Returns the process exit code.
+    int run();
+
+private:
+    struct Worker {
+        QProcess* process = nullptr;
+        QList<int> cpus;
+        int job = -1;               // Running job, -1 when idle
+        QElapsedTimer timer;
+        int percent = 0;
+        double speed = 0.0;         // Times real time, from the worker's progress
+        QString lastError;
+        QByteArray partialLine;
+    };
+
+    int runSegmented();
+    bool prepareJobs(const QStringList& tracks);
+    bool prepareSegments(qint64 totalFrames, int segments);
+    // Resets what an earlier run left unfinished; false if the journal cannot be written
+    bool resumeJobs();
+    // Runs the pending jobs on up to maxWorkers workers until none is left
+    void runJobs(int maxWorkers);
+    // Track name, and the frames of a segment
+    QString jobName(const RenderJob& job) const;
+    // Starts the next pending job on the worker; false when none is left
+    bool startNext(Worker& worker);
+    void readOutput(Worker& worker);
+    void finishJob(Worker& worker, bool ok);
+    bool anyRunning() const;
+    bool inPlaylist(const RenderJob& job) const { return m_tracks.contains(job.track); }
+    void reportProgress() const;
+    static QList<int> availableCpus();
+
+    Options m_options;
+    QSet<QString> m_tracks;         // Of this run's playlist; the journal may know more
+    std::unique_ptr<RenderJournal> m_journal;
+    std::vector<Worker> m_workers;     // Sized once; callbacks hold indices
+    int m_nextJob = 0;
+    QElapsedTimer m_elapsed;
+};
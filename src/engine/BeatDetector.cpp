@@ -0,0 +1,308 @@
+#include "BeatDetector.h"
+#include <QDebug>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+constexpr double kFluxWindowSeconds = 0.75;   // Adaptive threshold history
+constexpr double kEnvelopeSeconds = 6.0;      // Tempo analysis history
+constexpr double kTempoIntervalSeconds = 0.5; // How often tempo is re-estimated
+constexpr double kRefractorySeconds = 0.06;   // Minimum gap between onsets
+constexpr float kLogCompression = 100.0f;
+constexpr float kMinFlux = 0.02f;             // Ignore near-silence
+constexpr float kThresholdDeviations = 1.5f;
+constexpr float kLockConfidence = 0.15f;
+constexpr double kPhaseCorrection = 0.2;      // Fraction of phase error corrected per onset
+constexpr double kBeatTolerance = 0.2;        // Fraction of a period counted as "on the beat"
+
+qint64 steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+BeatDetector::BeatDetector(int sampleRate, QObject* parent)
+    : QObject(parent),
+      m_sampleRate(sampleRate),
+      m_fft(kOnsetFftSize),
+      m_hop(kHopFrames, 0.0f),
+      m_window(kOnsetFftSize, 0.0f),
+      m_magnitudes(m_fft.binCount(), 0.0f),
+      m_prevLogMag(m_fft.binCount(), 0.0f) {
+    const double hopsPerSecond = double(sampleRate) / kHopFrames;
+    m_fluxHistory.assign(static_cast<size_t>(kFluxWindowSeconds * hopsPerSecond), 0.0f);
+    m_envelope.assign(static_cast<size_t>(kEnvelopeSeconds * hopsPerSecond), 0.0f);
+    m_envLinear.assign(m_envelope.size(), 0.0f);
+}
+
+void BeatDetector::setSensitivity(float sensitivity) {
+    m_sensitivity.store(std::clamp(sensitivity, 0.1f, 5.0f), std::memory_order_relaxed);
+}
+
+void BeatDetector::reset() {
+    std::fill(m_window.begin(), m_window.end(), 0.0f);
+    std::fill(m_prevLogMag.begin(), m_prevLogMag.end(), 0.0f);
+    std::fill(m_fluxHistory.begin(), m_fluxHistory.end(), 0.0f);
+    std::fill(m_envelope.begin(), m_envelope.end(), 0.0f);
+    m_hopFill = 0;
+    m_fluxPos = m_fluxCount = 0;
+    m_fluxSum = m_fluxSumSq = 0.0;
+    m_prevFlux = 0.0f;
+    m_envPos = m_envCount = 0;
+    m_hopsSinceTempo = 0;
+    m_candidatePeriod = 0.0;
+    m_weakEstimates = 0;
+    m_period = m_nextBeat = m_anchor = m_bpm = 0.0;
+    m_confidence = 0.0f;
+    publish();
+}
+
+void BeatDetector::process(const float* stereo, size_t frames) {
+    for (size_t i = 0; i < frames; ++i) {
+        m_hop[m_hopFill++] = 0.5f * (stereo[2 * i] + stereo[2 * i + 1]);
+        if (m_hopFill == m_hop.size()) {
+            m_frame += m_hopFill;
+            m_hopFill = 0;
+            analyseHop();
+        }
+    }
+}
+
+void BeatDetector::analyseHop() {
+    // Slide the onset window and take its spectrum
+    const size_t keep = m_window.size() - m_hop.size();
+    std::memmove(m_window.data(), m_window.data() + m_hop.size(), keep * sizeof(float));
+    std::memcpy(m_window.data() + keep, m_hop.data(), m_hop.size() * sizeof(float));
+    m_fft.transform(m_window.data(), m_magnitudes.data());
+
+    // Half-wave rectified log-magnitude flux, averaged over bins
+    float flux = 0.0f;
+    for (size_t k = 0; k < m_magnitudes.size(); ++k) {
+        const float logMag = std::log1p(kLogCompression * m_magnitudes[k]);
+        flux += std::max(0.0f, logMag - m_prevLogMag[k]);
+        m_prevLogMag[k] = logMag;
+    }
+    flux /= static_cast<float>(m_magnitudes.size());
+
+    m_envelope[m_envPos] = flux;
+    m_envPos = (m_envPos + 1) % m_envelope.size();
+    m_envCount = std::min(m_envCount + 1, m_envelope.size());
+
+    const bool isOnset = detectOnset(flux);
+    if (isOnset) emit onset(flux);
+
+    const double hint = m_tempoHint.exchange(0.0, std::memory_order_relaxed);
+    if (hint >= kMinBpm && hint <= kMaxBpm) {
+        adoptPeriod(60.0 * m_sampleRate / hint);
+        m_bpm = hint;
+        m_confidence = kLockConfidence;
+        emit tempoChanged(m_bpm);
+    }
+
+    if (++m_hopsSinceTempo >= static_cast<int>(kTempoIntervalSeconds * m_sampleRate / kHopFrames)) {
+        m_hopsSinceTempo = 0;
+        updateTempo();
+    }
+
+    advanceTracker(isOnset);
+    publish();
+}
+
+bool BeatDetector::detectOnset(float flux) {
+    // Threshold against the history *before* this value enters it
+    bool isOnset = false;
+    if (m_fluxCount > 0) {
+        const double mean = m_fluxSum / m_fluxCount;
+        const double variance = std::max(0.0, m_fluxSumSq / m_fluxCount - mean * mean);
+        const double threshold = mean + (kThresholdDeviations / sensitivity()) * std::sqrt(variance);
+        const quint64 refractory = static_cast<quint64>(kRefractorySeconds * m_sampleRate);
+
+        // Rising edge only: no look-ahead, so no added latency
+        isOnset = flux > kMinFlux && flux > threshold && flux > m_prevFlux &&
+                  m_frame - m_lastOnsetFrame >= refractory;
+    }
+    if (isOnset) m_lastOnsetFrame = m_frame;
+    m_prevFlux = flux;
+
+    const float old = m_fluxHistory[m_fluxPos];
+    if (m_fluxCount == m_fluxHistory.size()) {
+        m_fluxSum -= old;
+        m_fluxSumSq -= double(old) * old;
+    } else {
+        ++m_fluxCount;
+    }
+    m_fluxHistory[m_fluxPos] = flux;
+    m_fluxPos = (m_fluxPos + 1) % m_fluxHistory.size();
+    m_fluxSum += flux;
+    m_fluxSumSq += double(flux) * flux;
+
+    return isOnset;
+}
+
+void BeatDetector::updateTempo() {
+    const double hopsPerSecond = double(m_sampleRate) / kHopFrames;
+    const size_t minLag = static_cast<size_t>(std::floor(60.0 / kMaxBpm * hopsPerSecond));
+    const size_t maxLag = static_cast<size_t>(std::ceil(60.0 / kMinBpm * hopsPerSecond));
+    const size_t n = m_envCount;
+    if (n < 2 * maxLag) return; // Need a couple of periods of history
+
+    // Unroll the ring oldest-first and remove the mean
+    const size_t start = (m_envPos + m_envelope.size() - n) % m_envelope.size();
+    double mean = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        m_envLinear[i] = m_envelope[(start + i) % m_envelope.size()];
+        mean += m_envLinear[i];
+    }
+    mean /= n;
+    double energy = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        m_envLinear[i] -= static_cast<float>(mean);
+        energy += double(m_envLinear[i]) * m_envLinear[i];
+    }
+    if (energy <= 0.0) return;
+
+    // Autocorrelation weighted by a log-Gaussian prior around 120 BPM,
+    // which resolves most octave ambiguities
+    auto acf = [&](size_t lag) {
+        double sum = 0.0;
+        for (size_t i = lag; i < n; ++i) sum += double(m_envLinear[i]) * m_envLinear[i - lag];
+        return sum / (n - lag);
+    };
+    auto weighted = [&](size_t lag, double value) {
+        const double bpm = 60.0 * hopsPerSecond / lag;
+        const double octaves = std::log2(bpm / 120.0);
+        return value * std::exp(-0.5 * octaves * octaves);
+    };
+
+    size_t bestLag = 0;
+    double bestScore = 0.0, bestValue = 0.0;
+    for (size_t lag = minLag; lag <= maxLag; ++lag) {
+        const double value = acf(lag);
+        const double score = weighted(lag, value);
+        if (score > bestScore) {
+            bestScore = score;
+            bestValue = value;
+            bestLag = lag;
+        }
+    }
+    if (bestLag == 0) return;
+
+    // Parabolic interpolation for sub-hop period resolution
+    double lag = static_cast<double>(bestLag);
+    if (bestLag > minLag && bestLag < maxLag) {
+        const double a = acf(bestLag - 1), b = bestValue, c = acf(bestLag + 1);
+        const double denom = a - 2.0 * b + c;
+        if (denom < 0.0) lag += 0.5 * (a - c) / denom;
+    }
+
+    m_confidence = static_cast<float>(bestValue / (energy / n));
+    const double period = lag * kHopFrames;
+
+    if (m_confidence < kLockConfidence) {
+        // Drop the lock after a few weak estimates in a row (breakdowns, silence)
+        if (m_period > 0.0 && ++m_weakEstimates >= 4) {
+            m_period = 0.0;
+            m_bpm = 0.0;
+            emit tempoChanged(0.0);
+        }
+        return;
+    }
+    m_weakEstimates = 0;
+
+    const bool close = m_period > 0.0 && std::abs(period - m_period) < 0.04 * m_period;
+    if (close) {
+        m_period = 0.8 * m_period + 0.2 * period;
+    } else if (m_period <= 0.0 || std::abs(period - m_candidatePeriod) < 0.04 * period) {
+        // Adopt a new tempo straight away when unlocked, otherwise only once
+        // two consecutive estimates agree on it
+        adoptPeriod(period);
+    } else {
+        m_candidatePeriod = period;
+        return;
+    }
+
+    const double bpm = 60.0 * m_sampleRate / m_period;
+    if (std::abs(bpm - m_bpm) >= 0.5) {
+        m_bpm = bpm;
+        emit tempoChanged(m_bpm);
+    }
+}
+
+void BeatDetector::adoptPeriod(double period) {
+    m_period = period;
+    m_candidatePeriod = 0.0;
+
+    // Acquire phase from the last onset so the grid starts on the music
+    const double now = static_cast<double>(m_frame);
+    const double since = now - static_cast<double>(m_lastOnsetFrame);
+    if (m_lastOnsetFrame > 0 && since < 2.0 * m_period) {
+        m_nextBeat = m_lastOnsetFrame + std::ceil(since / m_period) * m_period;
+    } else {
+        m_nextBeat = now + m_period;
+    }
+}
+
+void BeatDetector::advanceTracker(bool isOnset) {
+    const double now = static_cast<double>(m_frame);
+
+    if (m_period <= 0.0) {
+        // No tempo yet: every onset is a beat
+        if (isOnset) fireBeat(now);
+        return;
+    }
+
+    if (isOnset) {
+        const double tolerance = kBeatTolerance * m_period;
+        const double early = now - m_nextBeat;
+        const double late = now - m_anchor;
+        if (early > -tolerance && early <= 0.0) {
+            // Onset just ahead of the prediction: take the beat now and pull
+            // the grid part of the way towards it
+            m_nextBeat += kPhaseCorrection * early;
+            fireBeat(now);
+            m_nextBeat += m_period;
+            return;
+        }
+        if (late >= 0.0 && late < tolerance) {
+            // Onset just after a predicted beat: we fired early, slow down
+            m_nextBeat += kPhaseCorrection * late;
+        }
+    }
+
+    if (now >= m_nextBeat) {
+        fireBeat(m_nextBeat);
+        m_nextBeat += m_period;
+        // Skip ahead if we fell more than a beat behind (e.g. after a reset)
+        while (m_nextBeat <= now) m_nextBeat += m_period;
+    }
+}
+
+void BeatDetector::fireBeat(double frame) {
+    m_anchor = frame;
+    ++m_beatIndex;
+    emit beat(m_beatIndex, m_bpm);
+}
+
+void BeatDetector::publish() {
+    BeatState s;
+    s.beatIndex = m_beatIndex;
+    s.anchorFrame = m_anchor;
+    s.periodFrames = m_period;
+    s.bpm = m_bpm;
+    s.confidence = m_confidence;
+    s.publishedFrame = m_frame;
+    s.publishedNs = steadyNowNs();
+    m_state.store(s);
+}
+
+double BeatDetector::beatPhase() const {
+    const BeatState s = state();
+    if (s.periodFrames <= 0.0) return 0.0;
+
+    const double elapsedFrames = (steadyNowNs() - s.publishedNs) * 1e-9 * m_sampleRate;
+    const double now = s.publishedFrame + elapsedFrames;
+    const double beats = (now - s.anchorFrame) / s.periodFrames;
+    return std::max(0.0, beats - std::floor(beats));
+}
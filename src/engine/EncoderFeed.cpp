@@ -0,0 +1,226 @@
+#include "EncoderFeed.h"
+#include "AudioEngine.h"
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+// The recorder tap holds ~680 ms; the writer looks at it at least this often
+constexpr unsigned long kAudioPollMs = 20;
+constexpr size_t kPcmChunkFrames = 4096;
+
+// The PCM that was played, from AudioEngine
+class RecorderTap : public PcmSource {
+public:
+    size_t discard() override { return AudioEngine::instance().discardPcm(PcmTap::Recorder); }
+    quint64 dropped() const override { return AudioEngine::instance().droppedPcmFrames(PcmTap::Recorder); }
+    quint64 position() const override { return AudioEngine::instance().pcmReadPosition(PcmTap::Recorder); }
+    size_t read(float* dst, size_t maxFrames) override {
+        return AudioEngine::instance().readPcm(PcmTap::Recorder, dst, maxFrames);
+    }
+};
+}
+
+EncoderFeed::~EncoderFeed() {
+    stop();
+}
+
+std::shared_ptr<PcmSource> EncoderFeed::recorderTap() {
+    return std::make_shared<RecorderTap>();
+}
+
+EncoderFeed::Policy EncoderFeed::policyFromString(const QString& name) {
+    if (name == "block") return Policy::Block;
+    if (name == "drop-oldest") return Policy::DropOldest;
+    return Policy::DuplicateLast;
+}
+
+bool EncoderFeed::start(std::unique_ptr<FrameEncoder> encoder, int capacity, Policy policy,
+                        std::shared_ptr<PcmSource> audio) {
+    stop();
+    m_encoder = std::move(encoder);
+    m_audio = audio ? std::move(audio) : recorderTap();
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_queue.assign(std::max(1, capacity), Entry{});
+        m_head = 0;
+        m_count = 0;
+        m_policy = policy;
+        m_stats = Stats{};
+        m_startResult = -1;
+        m_running = true;
+    }
+
+    // Encoders open on the thread that writes to them (a QProcess has to belong to it)
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName("EncoderFeed");
+    m_thread->start();
+
+    QMutexLocker locker(&m_mutex);
+    while (m_startResult < 0) m_started.wait(&m_mutex);
+    if (m_startResult == 1) return true;
+
+    locker.unlock();
+    stop();
+    return false;
+}
+
+void EncoderFeed::stop() {
+    if (!m_thread) return;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_running = false;
+        m_notEmpty.wakeAll();
+        m_notFull.wakeAll();
+    }
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+    m_encoder.reset();
+    m_audio.reset();
+}
+
+bool EncoderFeed::isRunning() const {
+    QMutexLocker locker(&m_mutex);
+    return m_running;
+}
+
+void EncoderFeed::push(VideoFramePtr frame) {
+    QMutexLocker locker(&m_mutex);
+    if (!m_running) return;
+
+    const int capacity = static_cast<int>(m_queue.size());
+    if (m_count == capacity) {
+        switch (m_policy) {
+        case Policy::Block:
+            while (m_count == capacity && m_running) m_notFull.wait(&m_mutex);
+            if (!m_running) return;
+            break;
+        case Policy::DropOldest:
+            m_queue[m_head] = Entry{};
+            m_head = (m_head + 1) % capacity;
+            --m_count;
+            ++m_stats.dropped;
+            break;
+        case Policy::DuplicateLast:
+            ++m_queue[(m_head + m_count - 1) % capacity].repeats;
+            ++m_stats.dropped;
+            ++m_stats.duplicated;
+            return;
+        }
+    }
+
+    m_queue[(m_head + m_count) % capacity] = Entry{std::move(frame), 0};
+    ++m_count;
+    m_notEmpty.wakeOne();
+}
+
+EncoderFeed::Stats EncoderFeed::stats() const {
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+void EncoderFeed::run() {
+    const bool started = m_encoder->open();
+    {
+        QMutexLocker locker(&m_mutex);
+        m_startResult = started ? 1 : 0;
+        if (!started) m_running = false;
+        m_started.wakeAll();
+    }
+    if (!started) {
+        qWarning() << "❌ Could not start encoder:" << m_encoder->errorString();
+        m_encoder->close();
+        return;
+    }
+
+    // Whatever piled up in the tap while nobody recorded goes; from here on
+    // its read position is exact
+    const bool audio = m_encoder->hasAudio();
+    if (audio) {
+        m_audio->discard();
+        m_tapDropped = m_audio->dropped();
+        m_pcm.resize(kPcmChunkFrames * AudioEngine::kTapChannels);
+    }
+
+    bool healthy = true;
+    bool firstWritten = false;
+    while (true) {
+        Entry entry;
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_count == 0 && m_running) {
+                // With audio, wake up regularly to keep the tap drained
+                if (audio && firstWritten) m_notEmpty.wait(&m_mutex, kAudioPollMs);
+                else m_notEmpty.wait(&m_mutex);
+            }
+            if (m_count == 0 && !m_running) break;    // Stopped and drained
+            if (m_count > 0) {
+                entry = std::move(m_queue[m_head]);
+                m_queue[m_head] = Entry{};
+                m_head = (m_head + 1) % static_cast<int>(m_queue.size());
+                --m_count;
+                m_notFull.wakeOne();
+            }
+        }
+
+        if (entry.frame) {
+            if (audio && !firstWritten && m_audio->dropped() != m_tapDropped) {
+                // Overflowed waiting for the first frame: nothing of the
+                // recording is lost yet, just resynchronise
+                m_audio->discard();
+                m_tapDropped = m_audio->dropped();
+            }
+            for (int copy = 0; copy <= entry.repeats && healthy; ++copy) {
+                healthy = m_encoder->write(*entry.frame);
+                if (healthy) {
+                    QMutexLocker locker(&m_mutex);
+                    ++m_stats.written;
+                }
+            }
+            firstWritten = true;
+        }
+        // Audio starts at the first frame's stream position, so not before it
+        if (healthy && audio && firstWritten) healthy = pumpAudio();
+        if (!healthy) break;
+    }
+
+    if (!healthy) {
+        const QString error = m_encoder->errorString();
+        qWarning() << "❌ Encoder stopped accepting frames:" << error;
+        {
+            // Nothing more is taken, so producers never block on a dead encoder
+            QMutexLocker locker(&m_mutex);
+            m_running = false;
+            std::fill(m_queue.begin(), m_queue.end(), Entry{});
+            m_stats.dropped += static_cast<quint64>(m_count);
+            m_count = 0;
+            m_notFull.wakeAll();
+        }
+        if (m_onFailure) m_onFailure(error);
+    } else if (audio && firstWritten) {
+        pumpAudio();
+    }
+    m_encoder->close();
+}
+
+bool EncoderFeed::pumpAudio() {
+    // An overflow loses the newest samples while older ones are still queued,
+    // which leaves the read position unsure; start over from an empty tap.
+    // The encoder fills the hole with silence.
+    const quint64 dropped = m_audio->dropped();
+    if (dropped != m_tapDropped) {
+        const quint64 lost = dropped - m_tapDropped + m_audio->discard();
+        m_tapDropped = m_audio->dropped();
+        qWarning() << "⚠️ Recorder fell behind the audio," << lost << "PCM frames replaced by silence";
+        QMutexLocker locker(&m_mutex);
+        m_stats.audioLost += lost;
+    }
+
+    while (true) {
+        const quint64 position = m_audio->position();
+        const size_t frames = m_audio->read(m_pcm.data(), kPcmChunkFrames);
+        if (frames == 0) return true;
+        if (!m_encoder->writeAudio(m_pcm.data(), frames, position)) return false;
+    }
+}
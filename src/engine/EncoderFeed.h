@@ -0,0 +1,108 @@
+#pragma once
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "FrameEncoder.h"
+
+// Where an encoder's audio track comes from, read on the feed's writer
+// thread: interleaved stereo at the tap format, positioned on the output
+// stream clock like VideoFrame::streamFrame
+class PcmSource {
+public:
+    virtual ~PcmSource() = default;
+
+    // Live sources drop what piled up before the recording; returns the
+    // frames dropped
+    virtual size_t discard() { return 0; }
+    // Frames lost to overflow so far
+    virtual quint64 dropped() const { return 0; }
+    // Stream frame of the next frame read()
+    virtual quint64 position() const = 0;
+    // What is available now, up to maxFrames
+    virtual size_t read(float* dst, size_t maxFrames) = 0;
+};
+
+// Hands frames to a FrameEncoder on a thread of its own.
+//
+// For encoders with an audio track the writer thread also drains a
+// PcmSource, by default AudioEngine's recorder tap, so the track is exactly
+// the PCM that was played, positioned by the same stream clock the frames
+// were rendered for.
+//
+// Frames wait in a bounded queue of pooled buffers; the writer thread takes
+// them in order and blocks in the encoder, so memory stays bounded however
+// far the encoder falls behind. What happens to the producer (the render
+// thread) when the queue is full is up to the policy:
+//   - Block: the producer waits for room. Nothing is lost; for offline use.
+//   - DropOldest: the oldest queued frame is discarded.
+//   - DuplicateLast: the new frame is discarded and the newest queued frame
+//     is written once more in its place, so the stream keeps its length and
+//     stays in step with the audio.
+class EncoderFeed {
+public:
+    enum class Policy { Block, DropOldest, DuplicateLast };
+
+    struct Stats {
+        quint64 written = 0;        // Frames written, duplicates included
+        quint64 dropped = 0;        // Frames discarded
+        quint64 duplicated = 0;     // Repeats written in place of dropped frames
+        quint64 audioLost = 0;      // PCM frames the recorder tap overflowed by
+    };
+
+    // Called on the writer thread when the encoder stops taking data
+    using FailureHandler = std::function<void(const QString& error)>;
+
+    EncoderFeed() = default;
+    ~EncoderFeed();
+
+    static Policy policyFromString(const QString& name);
+    // AudioEngine's recorder tap, the default audio; one reader at a time
+    static std::shared_ptr<PcmSource> recorderTap();
+
+    // Opens encoder on the writer thread. False if it did not open. Audio
+    // comes from audio, or the recorder tap when null.
+    bool start(std::unique_ptr<FrameEncoder> encoder, int capacity, Policy policy,
+               std::shared_ptr<PcmSource> audio = nullptr);
+    // Writes out what is queued, then closes the encoder
+    void stop();
+    // False once stopped, or once the encoder failed; frames pushed then are ignored
+    bool isRunning() const;
+    // Set before start()
+    void setFailureHandler(FailureHandler handler) { m_onFailure = std::move(handler); }
+
+    // Any thread
+    void push(VideoFramePtr frame);
+    Stats stats() const;
+
+private:
+    struct Entry {
+        VideoFramePtr frame;
+        int repeats = 0;            // Extra copies to write after the frame
+    };
+
+    void run();
+    // Passes the source's PCM on to the encoder
+    bool pumpAudio();
+
+    QThread* m_thread = nullptr;
+    std::unique_ptr<FrameEncoder> m_encoder;    // Writer thread only while it runs
+    std::shared_ptr<PcmSource> m_audio;         // Writer thread only while it runs
+    std::vector<float> m_pcm;                   // Writer thread
+    FailureHandler m_onFailure;
+    quint64 m_tapDropped = 0;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    QWaitCondition m_started;
+    std::vector<Entry> m_queue;     // Ring of capacity entries
+    int m_head = 0;
+    int m_count = 0;
+    Policy m_policy = Policy::DuplicateLast;
+    bool m_running = false;         // Accepting frames
+    int m_startResult = -1;         // Set by the writer thread: 1 opened, 0 failed
+    Stats m_stats;
+};
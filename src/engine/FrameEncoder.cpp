@@ -0,0 +1,72 @@
+#include "FrameEncoder.h"
+#include "YuvConverter.h"
+#include "SplicePipe.h"
+#include <QProcess>
+#include <QDebug>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+ProcessEncoder::ProcessEncoder(const QString& program, const QStringList& arguments, Input input)
+    : m_program(program), m_arguments(arguments), m_input(input) {}
+
+ProcessEncoder::~ProcessEncoder() = default;
+
+bool ProcessEncoder::open() {
+    m_process = std::make_unique<QProcess>();
+    // Nothing on the writer thread reads the encoder's output. Left in pipes,
+    // ffmpeg's progress lines fill them and it stops reading stdin for good
+    m_process->setProcessChannelMode(QProcess::ForwardedChannels);
+#ifdef __linux__
+    m_pipe = std::make_unique<SplicePipe>();
+    if (m_pipe->create()) {
+        // Replaces the stdin QProcess set up; runs in the child just before exec
+        const int fd = m_pipe->readFd();
+        m_process->setChildProcessModifier([fd]() { ::dup2(fd, STDIN_FILENO); });
+    } else {
+        qWarning() << "⚠️ No splice pipe for the encoder, writing through QProcess:" << m_pipe->errorString();
+        m_pipe.reset();
+    }
+#endif
+    m_process->start(m_program, m_arguments);
+    const bool started = m_process->waitForStarted();
+#ifdef __linux__
+    if (m_pipe) m_pipe->closeReadEnd();  // Otherwise the encoder never sees EOF
+#endif
+    return started;
+}
+
+bool ProcessEncoder::write(const VideoFrame& frame) {
+    const std::vector<uchar>* bytes = &frame.pixels;
+    if (m_input == Input::I420) {
+        YuvConverter::convertI420(frame, m_converted);
+        bytes = &m_converted;
+    }
+
+    // Blocking on the pipe is the point: the writer thread absorbs the encoder's pace
+#ifdef __linux__
+    if (m_pipe) return m_pipe->write(bytes->data(), bytes->size());
+#endif
+    if (m_process->write(reinterpret_cast<const char*>(bytes->data()), qint64(bytes->size())) < 0) return false;
+    while (m_process->bytesToWrite() > 0) {
+        if (!m_process->waitForBytesWritten(-1)) return false;
+    }
+    return true;
+}
+
+void ProcessEncoder::close() {
+    if (!m_process) return;
+#ifdef __linux__
+    m_pipe.reset();
+#endif
+    m_process->closeWriteChannel();  // EOF for the encoder
+    m_process->waitForFinished(-1);
+    m_process.reset();
+}
+
+QString ProcessEncoder::errorString() const {
+#ifdef __linux__
+    if (m_pipe && !m_pipe->errorString().isEmpty()) return m_program + ": " + m_pipe->errorString();
+#endif
+    return m_process ? m_program + ": " + m_process->errorString() : m_program;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <vector>
+#include "FrameReadback.h"
+
+// Where EncoderFeed's writer thread sends frames. Created on any thread,
+// then used only from the writer thread, open() first.
+class FrameEncoder {
+public:
+    virtual ~FrameEncoder() = default;
+
+    virtual bool open() = 0;
+    // Encodes frame; called again with the same frame for a duplicate
+    virtual bool write(const VideoFrame& frame) = 0;
+
+    // Encoders with an audio track get the played PCM (AudioEngine's tap
+    // format) through writeAudio(), starting after the first video frame.
+    // streamFrame is the output stream frame of the first sample, the same
+    // clock as VideoFrame::streamFrame.
+    virtual bool hasAudio() const { return false; }
+    virtual bool writeAudio(const float* samples, size_t frames, quint64 streamFrame) {
+        Q_UNUSED(samples); Q_UNUSED(frames); Q_UNUSED(streamFrame);
+        return true;
+    }
+
+    // Flushes and finalizes the output
+    virtual void close() = 0;
+    virtual QString errorString() const = 0;
+};
+
+// Raw frames through an encoder process's stdin (the ffmpeg command
+// template): BGRA as captured, or converted to I420 first, which is less
+// than half the bytes through the pipe. On Linux stdin is a SplicePipe, so
+// frames reach the encoder without passing through QProcess's buffer.
+class ProcessEncoder : public FrameEncoder {
+public:
+    enum class Input { Bgra, I420 };
+
+    ProcessEncoder(const QString& program, const QStringList& arguments, Input input = Input::Bgra);
+    ~ProcessEncoder() override;
+
+    bool open() override;
+    bool write(const VideoFrame& frame) override;
+    void close() override;
+    QString errorString() const override;
+
+private:
+    QString m_program;
+    QStringList m_arguments;
+    Input m_input;
+    std::vector<uchar> m_converted;             // I420 staging
+    std::unique_ptr<class QProcess> m_process;   // Belongs to the writer thread
+#ifdef __linux__
+    std::unique_ptr<class SplicePipe> m_pipe;    // The process's stdin when set
+#endif
+};
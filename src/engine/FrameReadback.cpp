@@ -0,0 +1,118 @@
+#include "FrameReadback.h"
+#include <QDebug>
+#include <atomic>
+#include <cstring>
+
+#ifndef GL_BGRA
+#define GL_BGRA 0x80E1
+#endif
+
+FramePool::FramePool(int capacity) {
+    reserve(capacity);
+}
+
+void FramePool::reserve(int capacity) {
+    if (capacity <= int(m_frames.size())) return;
+    m_frames.reserve(capacity);
+    while (int(m_frames.size()) < capacity) m_frames.push_back(std::make_shared<VideoFrame>());
+}
+
+std::shared_ptr<VideoFrame> FramePool::acquire(const QSize& size) {
+    for (const std::shared_ptr<VideoFrame>& frame : m_frames) {
+        if (frame.use_count() != 1) continue;
+        // Pairs with the release of the consumer's last reference
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        const int stride = size.width() * 4;
+        frame->pixels.resize(static_cast<size_t>(stride) * size.height());
+        frame->size = size;
+        frame->stride = stride;
+        return frame;
+    }
+    return nullptr;
+}
+
+ReadbackRing::ReadbackRing(Sink sink) : m_pool(kPoolFrames), m_sink(std::move(sink)) {}
+
+void ReadbackRing::capture(QOpenGLExtraFunctions* gl, GLuint framebuffer, const QSize& size,
+                           const FrameScheduler::Frame& frame) {
+    if (m_pending == kSlots) {
+        // Every buffer is in flight: the oldest read has to land first
+        finish(gl, m_slots[m_head]);
+        --m_pending;
+    }
+
+    Slot& slot = m_slots[m_head];
+    const qsizetype bytes = qsizetype(size.width()) * size.height() * 4;
+    if (!slot.buffer) gl->glGenBuffers(1, &slot.buffer);
+    gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (slot.bytes != bytes) {
+        gl->glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+        slot.bytes = bytes;
+    }
+
+    gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    gl->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    gl->glReadPixels(0, 0, size.width(), size.height(), GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+    gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.size = size;
+    slot.presentNs = frame.presentNs;
+    slot.streamFrame = frame.streamFrame;
+    m_head = (m_head + 1) % kSlots;
+    ++m_pending;
+}
+
+void ReadbackRing::collect(QOpenGLExtraFunctions* gl, bool wait) {
+    while (m_pending > 0) {
+        Slot& oldest = m_slots[(m_head - m_pending + kSlots) % kSlots];
+        if (!wait && gl->glClientWaitSync(oldest.fence, 0, 0) == GL_TIMEOUT_EXPIRED) break;
+        finish(gl, oldest);
+        --m_pending;
+    }
+}
+
+void ReadbackRing::finish(QOpenGLExtraFunctions* gl, Slot& slot) {
+    gl->glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    gl->glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    std::shared_ptr<VideoFrame> frame = m_pool.acquire(slot.size);
+    if (!frame) {
+        // The consumer still holds every frame
+        if (m_dropped++ % 60 == 0) {
+            qWarning() << "⚠️ Recorder is falling behind," << m_dropped << "captured frames dropped";
+        }
+        return;
+    }
+
+    gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const auto* mapped = static_cast<const uchar*>(
+        gl->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.bytes, GL_MAP_READ_BIT));
+    if (mapped) {
+        // GL rows run bottom-up; flip while copying out
+        const int height = slot.size.height();
+        for (int y = 0; y < height; ++y) {
+            std::memcpy(frame->pixels.data() + size_t(y) * frame->stride,
+                        mapped + size_t(height - 1 - y) * frame->stride, frame->stride);
+        }
+        gl->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!mapped) return;
+
+    frame->presentNs = slot.presentNs;
+    frame->streamFrame = slot.streamFrame;
+    m_sink(std::move(frame));
+}
+
+void ReadbackRing::release(QOpenGLExtraFunctions* gl) {
+    for (Slot& slot : m_slots) {
+        if (slot.fence) gl->glDeleteSync(slot.fence);
+        if (slot.buffer) gl->glDeleteBuffers(1, &slot.buffer);
+        slot = Slot{};
+    }
+    m_head = 0;
+    m_pending = 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <QSize>
+#include <QOpenGLExtraFunctions>
+#include <array>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "FrameScheduler.h"
+
+// A rendered frame in system memory, BGRA (QImage::Format_ARGB32 on
+// little-endian, ffmpeg's "bgra"), top row first
+struct VideoFrame {
+    std::vector<uchar> pixels;
+    QSize size;
+    int stride = 0;             // Bytes per row
+    qint64 presentNs = 0;       // From the FrameScheduler::Frame it was rendered for
+    quint64 streamFrame = 0;
+};
+using VideoFramePtr = std::shared_ptr<const VideoFrame>;
+
+// Set of reusable frame buffers.
+//
+// The pool keeps a reference to every frame; a frame is free again once
+// all other references are gone, so consumers simply drop their pointer
+// when done, on any thread. Buffers are only reallocated when the frame
+// size changes.
+class FramePool {
+public:
+    explicit FramePool(int capacity);
+
+    // Producer thread. Grows the pool to capacity frames; it never shrinks.
+    void reserve(int capacity);
+
+    // Single producer. A free frame sized for size, or null if all are in use.
+    std::shared_ptr<VideoFrame> acquire(const QSize& size);
+
+private:
+    std::vector<std::shared_ptr<VideoFrame>> m_frames;
+};
+
+// Asynchronous readback through a ring of pixel buffer objects.
+//
+// capture() only queues a glReadPixels into the next PBO and fences it, so
+// the GPU copies the frame while the following ones render. collect() maps
+// the reads whose fence has passed and copies them into pooled frames.
+// Only when all kSlots reads are still outstanding does capture() wait for
+// the oldest, which in practice has long finished by then.
+//
+// Buffers and fences are shared objects, so any context of the share group
+// may be current; all calls must come from one thread.
+class ReadbackRing {
+public:
+    static constexpr int kSlots = 3;
+    static constexpr int kPoolFrames = 8;    // Initial pool; see reservePool()
+
+    using Sink = std::function<void(VideoFramePtr)>;
+
+    // sink receives every finished frame, on the calling thread
+    explicit ReadbackRing(Sink sink);
+
+    // Queues a read of framebuffer's color attachment
+    void capture(QOpenGLExtraFunctions* gl, GLuint framebuffer, const QSize& size, const FrameScheduler::Frame& frame);
+    // Passes finished reads to the sink, oldest first. With wait, the ones
+    // still in flight as well.
+    void collect(QOpenGLExtraFunctions* gl, bool wait);
+    // Drops pending reads and deletes the buffers
+    void release(QOpenGLExtraFunctions* gl);
+    // Makes sure a frame is still free while the sink's consumers hold
+    // heldFrames of them (every queue full, every encoder busy)
+    void reservePool(int heldFrames) { m_pool.reserve(heldFrames + 1); }
+
+    // Frames lost because every pooled frame was still in use
+    quint64 dropped() const { return m_dropped; }
+
+private:
+    struct Slot {
+        GLuint buffer = 0;
+        qsizetype bytes = 0;
+        QSize size;
+        GLsync fence = nullptr;
+        qint64 presentNs = 0;
+        quint64 streamFrame = 0;
+    };
+
+    void finish(QOpenGLExtraFunctions* gl, Slot& slot);
+
+    std::array<Slot, kSlots> m_slots;
+    int m_head = 0;         // Next slot to read into
+    int m_pending = 0;      // Reads in flight, ending at m_head
+    FramePool m_pool;
+    Sink m_sink;
+    quint64 m_dropped = 0;
+};
@@ -0,0 +1,111 @@
+#include "FrameScaler.h"
+#include "../core/PixelKernels.h"
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <numeric>
+
+namespace {
+constexpr int kOne = 1 << 14;       // Weights are Q14
+// Below this many output rows per band the hand-off costs more than it saves
+constexpr int kMinRowsPerBand = 16;
+}
+
+FrameScaler::FrameScaler(const QSize& source, const QSize& target)
+    : m_source(source),
+      m_target(target.boundedTo(source)),
+      m_crop(cropFor(source, target)),
+      m_columns(makeTaps(m_crop.width(), m_target.width())),
+      m_rows(makeTaps(m_crop.height(), m_target.height())) {}
+
+QRect FrameScaler::cropFor(const QSize& source, const QSize& target) {
+    // The largest centred rectangle of the target's aspect ratio
+    const qint64 width = std::min<qint64>(source.width(), qint64(source.height()) * target.width() / target.height());
+    const qint64 height = std::min<qint64>(source.height(), qint64(source.width()) * target.height() / target.width());
+    return QRect(int(source.width() - width) / 2, int(source.height() - height) / 2, int(width), int(height));
+}
+
+FrameScaler::Taps FrameScaler::makeTaps(int length, int target) {
+    // In units of 1/(length * target): source sample s spans
+    // [s * target, (s + 1) * target), output sample i [i * length, (i + 1) * length)
+    Taps taps;
+    // Whole ratios (a plain crop among them) line up with the source grid
+    taps.count = std::min(length, length % target == 0 ? length / target : length / target + 2);
+    taps.first.resize(target);
+    taps.weights.assign(size_t(target) * taps.count, 0);
+
+    for (int i = 0; i < target; ++i) {
+        const qint64 begin = qint64(i) * length;
+        const qint64 end = begin + length;
+        // Kept inside the row so every tap can be read, weighted 0 or not
+        const int first = std::min(int(begin / target), length - taps.count);
+        taps.first[i] = first;
+
+        uint16_t* weights = taps.weights.data() + size_t(i) * taps.count;
+        int sum = 0;
+        int largest = 0;
+        for (int t = 0; t < taps.count; ++t) {
+            const qint64 overlap = std::min(end, qint64(first + t + 1) * target) - std::max(begin, qint64(first + t) * target);
+            if (overlap <= 0) continue;
+            weights[t] = uint16_t((overlap * kOne + length / 2) / length);
+            sum += weights[t];
+            if (weights[t] > weights[largest]) largest = t;
+        }
+        // Rounding leftovers go to the biggest tap, so flat areas stay exact
+        weights[largest] = uint16_t(weights[largest] + kOne - sum);
+    }
+    return taps;
+}
+
+void FrameScaler::scale(const VideoFrame& frame, VideoFrame& out) const {
+    const PixelKernels& kernels = PixelKernels::get();
+    const int width = m_target.width();
+    const int height = m_target.height();
+    out.size = m_target;
+    out.stride = width * 4;
+    out.pixels.resize(size_t(out.stride) * height);
+    out.presentNs = frame.presentNs;
+    out.streamFrame = frame.streamFrame;
+
+    const uchar* origin = frame.pixels.data() + size_t(m_crop.y()) * frame.stride + size_t(m_crop.x()) * 4;
+    const int rowBytes = m_crop.width() * 4;
+
+    auto scaleRows = [&](int firstRow, int lastRow) {
+        // Source rows blended into one, then resampled along it
+        std::vector<uint8_t> blended(size_t(rowBytes));
+        std::vector<const uint8_t*> rows(size_t(m_rows.count));
+        for (int y = firstRow; y < lastRow; ++y) {
+            for (int t = 0; t < m_rows.count; ++t) rows[t] = origin + size_t(m_rows.first[y] + t) * frame.stride;
+            kernels.blendRows(rows.data(), m_rows.weights.data() + size_t(y) * m_rows.count, m_rows.count, rowBytes,
+                              blended.data());
+            kernels.blendPixels(blended.data(), m_columns.first.data(), m_columns.weights.data(), m_columns.count,
+                                width, out.pixels.data() + size_t(y) * out.stride);
+        }
+    };
+
+    const int bands = std::clamp(height / kMinRowsPerBand, 1, QThread::idealThreadCount());
+    if (bands == 1) {
+        scaleRows(0, height);
+        return;
+    }
+    std::vector<int> indices(bands);
+    std::iota(indices.begin(), indices.end(), 0);
+    QtConcurrent::blockingMap(indices, [&](int band) {
+        scaleRows(height * band / bands, height * (band + 1) / bands);
+    });
+}
+
+ScaledEncoder::ScaledEncoder(std::unique_ptr<FrameEncoder> encoder, const QSize& size)
+    : m_encoder(std::move(encoder)), m_size(size) {}
+
+bool ScaledEncoder::write(const VideoFrame& frame) {
+    // A repeated frame (the feed's duplicate policy) is scaled only once
+    if (&frame != m_lastSource || frame.streamFrame != m_scaled.streamFrame || frame.presentNs != m_scaled.presentNs) {
+        if (!m_scaler || m_scaler->sourceSize() != frame.size) {
+            m_scaler = std::make_unique<FrameScaler>(frame.size, m_size);
+        }
+        m_scaler->scale(frame, m_scaled);
+        m_lastSource = &frame;
+    }
+    return m_encoder->write(m_scaled);
+}
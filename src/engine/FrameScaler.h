@@ -0,0 +1,69 @@
+#pragma once
+#include <QRect>
+#include <QSize>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "FrameEncoder.h"
+
+// A smaller rendition of BGRA frames: the centre of the frame cropped to
+// the target's aspect ratio, then scaled down to the target by area
+// averaging (each output pixel the mean of the source area it covers).
+//
+// Both passes use the best PixelKernels implementation, with the output
+// rows split into bands converted in parallel on the global thread pool,
+// like YuvConverter.
+class FrameScaler {
+public:
+    // target no larger than source
+    FrameScaler(const QSize& source, const QSize& target);
+
+    // The part of a source frame a rendition of size target shows
+    static QRect cropFor(const QSize& source, const QSize& target);
+
+    // Blocks until done. out is sized for the target and takes the frame's timing.
+    void scale(const VideoFrame& frame, VideoFrame& out) const;
+
+    QSize sourceSize() const { return m_source; }
+    QSize targetSize() const { return m_target; }
+
+private:
+    // Source samples feeding each output sample along one axis
+    struct Taps {
+        int count = 1;                  // Per output sample
+        std::vector<int32_t> first;     // First source sample, from the crop's edge
+        std::vector<uint16_t> weights;  // count per output sample, Q14
+    };
+    static Taps makeTaps(int length, int target);
+
+    QSize m_source;
+    QSize m_target;
+    QRect m_crop;
+    Taps m_columns;
+    Taps m_rows;
+};
+
+// Encodes a rendition of the frames it is given: scales each one on the
+// writer thread of its feed, then hands it to the wrapped encoder, which
+// was set up for the rendition's size.
+class ScaledEncoder : public FrameEncoder {
+public:
+    ScaledEncoder(std::unique_ptr<FrameEncoder> encoder, const QSize& size);
+
+    bool open() override { return m_encoder->open(); }
+    bool write(const VideoFrame& frame) override;
+    void close() override { m_encoder->close(); }
+    QString errorString() const override { return m_encoder->errorString(); }
+
+    bool hasAudio() const override { return m_encoder->hasAudio(); }
+    bool writeAudio(const float* samples, size_t frames, quint64 streamFrame) override {
+        return m_encoder->writeAudio(samples, frames, streamFrame);
+    }
+
+private:
+    std::unique_ptr<FrameEncoder> m_encoder;
+    QSize m_size;
+    std::unique_ptr<FrameScaler> m_scaler;  // For the size of the frames coming in
+    VideoFrame m_scaled;
+    const VideoFrame* m_lastSource = nullptr;   // What m_scaled was made from
+};
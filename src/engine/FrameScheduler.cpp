@@ -0,0 +1,160 @@
+#include "FrameScheduler.h"
+#include "AudioEngine.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+constexpr size_t kIntervalWindow = 32;
+constexpr double kPeriodTolerance = 0.1;   // Measured period must be within 10% of nominal
+
+qint64 steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+FrameScheduler::FrameScheduler(double refreshHz)
+    : m_nominalPeriodNs(1e9 / std::max(1.0, refreshHz))
+    , m_periodNs(m_nominalPeriodNs) {
+    m_intervals.reserve(kIntervalWindow);
+    m_sortedIntervals.reserve(kIntervalWindow);
+    updateDivisor();
+    resetStats();
+}
+
+void FrameScheduler::setNominalRefreshRate(double hz) {
+    if (hz <= 0.0) return;
+    m_nominalPeriodNs = 1e9 / hz;
+    m_periodNs = m_nominalPeriodNs;
+    m_intervals.clear();
+    m_intervalPos = 0;
+    updateDivisor();
+}
+
+void FrameScheduler::setMaxFps(int fps) {
+    m_maxFps = std::max(1, fps);
+    updateDivisor();
+}
+
+void FrameScheduler::setIdle(bool idle) {
+    if (idle == m_idle) return;
+    m_idle = idle;
+    updateDivisor();
+}
+
+void FrameScheduler::updateDivisor() {
+    const double refreshHz = 1e9 / m_periodNs;
+    const int maxFps = m_idle ? std::min(m_maxFps, kIdleFps) : m_maxFps;
+    m_divisor = std::max(1, static_cast<int>(std::ceil(refreshHz / maxFps - 0.01)));
+}
+
+void FrameScheduler::frameSwapped() {
+    const qint64 now = steadyNowNs();
+    ++m_stats.presented;
+
+    if (m_lastSwapNs != 0) {
+        const qint64 interval = now - m_lastSwapNs;
+        const int bucket = std::min<qint64>(kHistogramBuckets - 1, interval / 1000000);
+        ++m_histogram[bucket];
+
+        const qint64 missed = std::llround(interval / m_periodNs) - 1;
+        if (missed > 0) m_stats.missedVsyncs += static_cast<quint64>(missed);
+
+        // Median of recent single-vsync intervals tracks the real refresh
+        // rate (which is rarely exactly the nominal one)
+        if (missed == 0) {
+            if (m_intervals.size() < kIntervalWindow) m_intervals.push_back(interval);
+            else m_intervals[m_intervalPos++ % kIntervalWindow] = interval;
+
+            if (m_intervals.size() >= kIntervalWindow / 2) {
+                std::vector<qint64>& sorted = m_sortedIntervals;
+                sorted.assign(m_intervals.begin(), m_intervals.end());
+                std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+                const double median = static_cast<double>(sorted[sorted.size() / 2]);
+                if (std::abs(median - m_nominalPeriodNs) < kPeriodTolerance * m_nominalPeriodNs &&
+                    std::abs(median - m_periodNs) > 0.001 * m_periodNs) {
+                    m_periodNs = median;
+                    updateDivisor();
+                }
+            }
+        }
+    }
+    m_lastSwapNs = now;
+}
+
+FrameScheduler::Frame FrameScheduler::beginFrame() {
+    const qint64 now = steadyNowNs();
+
+    // This frame is shown at the first vsync after now
+    qint64 presentNs = now;
+    if (m_lastSwapNs != 0) {
+        const double periods = std::max(1.0, std::ceil((now - m_lastSwapNs) / m_periodNs));
+        presentNs = m_lastSwapNs + static_cast<qint64>(periods * m_periodNs);
+    }
+
+    Frame frame;
+    frame.presentNs = presentNs;
+
+    // Render on every Nth vsync. Measured in time rather than counted, so a
+    // missed vsync does not shift the cadence; the frame simply skips ahead.
+    const double sinceLast = static_cast<double>(presentNs - m_lastRenderPresentNs);
+    frame.render = m_lastRenderPresentNs == 0 || sinceLast > (m_divisor - 0.5) * m_periodNs;
+    if (!frame.render) {
+        ++m_stats.repeated;
+        return frame;
+    }
+
+    m_lastRenderPresentNs = presentNs;
+    ++m_stats.rendered;
+    frame.budgetNs = static_cast<qint64>(m_divisor * m_periodNs);
+
+    // Audio that will be audible when the frame appears
+    frame.presentNs += static_cast<qint64>(m_pipelineDepth * m_periodNs);
+    const AudioEngine& audio = AudioEngine::instance();
+    const double aheadSeconds = (frame.presentNs - now) * 1e-9;
+    frame.streamFrame = static_cast<quint64>((audio.streamSeconds() + aheadSeconds) * AudioEngine::kTapSampleRate);
+    frame.positionMs = audio.positionMs() + (audio.isPlaying() ? aheadSeconds * 1000.0 : 0.0);
+    return frame;
+}
+
+void FrameScheduler::recordRenderTime(qint64 renderNs) {
+    m_renderNsTotal += static_cast<double>(renderNs);
+}
+
+qint64 FrameScheduler::nanosUntilNextFrame() const {
+    if (m_lastRenderPresentNs == 0) return 0;
+    const qint64 due = m_lastRenderPresentNs + static_cast<qint64>(m_divisor * m_periodNs);
+    // Start painting a vsync early so the frame is ready by its slot
+    return std::max<qint64>(0, due - static_cast<qint64>(m_periodNs) - steadyNowNs());
+}
+
+FrameScheduler::Stats FrameScheduler::stats() const {
+    Stats s = m_stats;
+    const double seconds = (steadyNowNs() - m_statsStartNs) * 1e-9;
+    s.refreshHz = 1e9 / m_periodNs;
+    s.renderFps = seconds > 0.0 ? s.rendered / seconds : 0.0;
+    s.meanRenderMs = s.rendered ? m_renderNsTotal / s.rendered / 1e6 : 0.0;
+    return s;
+}
+
+double FrameScheduler::intervalPercentileMs(double percentile) const {
+    quint64 total = 0;
+    for (quint32 count : m_histogram) total += count;
+    if (total == 0) return 0.0;
+
+    const quint64 target = static_cast<quint64>(std::ceil(total * percentile / 100.0));
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < kHistogramBuckets; ++bucket) {
+        seen += m_histogram[bucket];
+        if (seen >= target) return bucket + 1.0;
+    }
+    return kHistogramBuckets;
+}
+
+void FrameScheduler::resetStats() {
+    m_stats = Stats{};
+    m_histogram.fill(0);
+    m_renderNsTotal = 0.0;
+    m_statsStartNs = steadyNowNs();
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <QtGlobal>
+#include <array>
+#include <vector>
+
+// Paces visualizer frames against the display and the audio clock.
+//
+// frameSwapped() feeds vsync timing back in; from it the scheduler measures
+// the real refresh period and counts missed vsyncs. Frames are rendered on
+// an even cadence of every Nth vsync, with N chosen so the render rate does
+// not exceed the configured maximum (60 fps becomes 50 on a 50 Hz screen and
+// 48 on a 144 Hz one, rather than an uneven mix). Vsyncs in between repeat
+// the last frame, and after a missed vsync the next frame jumps ahead to the
+// audio clock instead of falling behind it.
+//
+// Each rendered frame is stamped with the audio time at which it is expected
+// to be on screen, so the caller can feed exactly the audio that will be
+// audible then.
+class FrameScheduler {
+public:
+    static constexpr int kHistogramBuckets = 64;   // 1 ms each, last one is overflow
+    static constexpr int kIdleFps = 15;
+
+    struct Frame {
+        bool render = false;        // false: repeat the previous frame
+        qint64 presentNs = 0;       // Predicted vsync this frame will be shown at
+        double positionMs = 0.0;    // Track position audible at presentNs
+        quint64 streamFrame = 0;    // Output stream frame audible at presentNs
+        qint64 budgetNs = 0;        // Time until the next frame is due
+    };
+
+    struct Stats {
+        quint64 presented = 0;      // Swaps seen
+        quint64 rendered = 0;       // New frames drawn
+        quint64 repeated = 0;       // Vsyncs that re-showed the previous frame
+        quint64 missedVsyncs = 0;   // Vsyncs lost to late frames
+        double refreshHz = 0.0;
+        double renderFps = 0.0;
+        double meanRenderMs = 0.0;
+    };
+
+    explicit FrameScheduler(double refreshHz = 60.0);
+
+    void setNominalRefreshRate(double hz);
+    void setMaxFps(int fps);
+    // Vsyncs between requesting a frame and presenting it, e.g. 1 when it is
+    // rendered asynchronously and shown by the following paint
+    void setPipelineDepth(int vsyncs) { m_pipelineDepth = vsyncs; }
+    // While idle (no audio playing) frames are rendered at kIdleFps
+    void setIdle(bool idle);
+
+    // Call once per presented frame
+    void frameSwapped();
+    // Call at the start of a paint. Returns what to render, if anything.
+    Frame beginFrame();
+    // Time the renderer spent on a frame, for the stats
+    void recordRenderTime(qint64 renderNs);
+
+    // Nanoseconds from now until the next frame is due, for callers that
+    // would rather sleep than wake on every vsync
+    qint64 nanosUntilNextFrame() const;
+
+    double refreshPeriodMs() const { return m_periodNs / 1e6; }
+    int divisor() const { return m_divisor; }
+    // Swap-to-swap intervals since the last resetStats()
+    const std::array<quint32, kHistogramBuckets>& histogram() const { return m_histogram; }
+    double intervalPercentileMs(double percentile) const;
+    Stats stats() const;
+    void resetStats();
+
+private:
+    void updateDivisor();
+
+    double m_nominalPeriodNs;
+    double m_periodNs;
+    int m_maxFps = 60;
+    bool m_idle = false;
+    int m_divisor = 1;
+    int m_pipelineDepth = 0;
+
+    qint64 m_lastSwapNs = 0;
+    qint64 m_lastRenderPresentNs = 0;
+    std::vector<qint64> m_intervals;      // Recent swap intervals, for the period estimate
+    std::vector<qint64> m_sortedIntervals; // Scratch for their median, reused every vsync
+    size_t m_intervalPos = 0;
+
+    std::array<quint32, kHistogramBuckets> m_histogram{};
+    Stats m_stats;
+    qint64 m_statsStartNs = 0;
+    double m_renderNsTotal = 0.0;
+};
@@ -0,0 +1,350 @@
+#include "LibavEncoder.h"
+#include "YuvConverter.h"
+#include "AudioEngine.h"
+
+#ifdef VIBESYNC_LIBAV_ENCODER
+
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/opt.h>
+}
+
+namespace {
+constexpr int kSampleRate = AudioEngine::kTapSampleRate;
+constexpr int kChannels = AudioEngine::kTapChannels;
+
+// Sample formats the tap's interleaved float converts to, in order of preference
+bool convertible(AVSampleFormat format) {
+    return format == AV_SAMPLE_FMT_FLTP || format == AV_SAMPLE_FMT_FLT ||
+           format == AV_SAMPLE_FMT_S16 || format == AV_SAMPLE_FMT_S32;
+}
+
+void convertPcm(const float* src, int frames, AVFrame* dst) {
+    switch (dst->format) {
+    case AV_SAMPLE_FMT_FLTP:
+        for (int c = 0; c < kChannels; ++c) {
+            float* plane = reinterpret_cast<float*>(dst->data[c]);
+            for (int i = 0; i < frames; ++i) plane[i] = src[i * kChannels + c];
+        }
+        break;
+    case AV_SAMPLE_FMT_FLT:
+        std::copy(src, src + frames * kChannels, reinterpret_cast<float*>(dst->data[0]));
+        break;
+    case AV_SAMPLE_FMT_S16: {
+        int16_t* out = reinterpret_cast<int16_t*>(dst->data[0]);
+        for (int i = 0; i < frames * kChannels; ++i) {
+            out[i] = static_cast<int16_t>(std::lrint(std::clamp(src[i], -1.0f, 1.0f) * 32767.0f));
+        }
+        break;
+    }
+    case AV_SAMPLE_FMT_S32: {
+        int32_t* out = reinterpret_cast<int32_t*>(dst->data[0]);
+        for (int i = 0; i < frames * kChannels; ++i) {
+            out[i] = static_cast<int32_t>(std::lrint(std::clamp(src[i], -1.0f, 1.0f) * 2147483520.0));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+}
+
+LibavEncoder::LibavEncoder(const QString& path, const QSize& size, int fps, const QString& audioCodec)
+    : m_path(path), m_size(size), m_fps(std::max(1, fps)), m_audioCodecName(audioCodec) {}
+
+LibavEncoder::~LibavEncoder() {
+    release();
+    avcodec_parameters_free(&m_copy);
+}
+
+void LibavEncoder::setVideoCopy(const AVCodecParameters* parameters) {
+    if (!m_copy) m_copy = avcodec_parameters_alloc();
+    avcodec_parameters_copy(m_copy, parameters);
+}
+
+bool LibavEncoder::fail(const QString& what, int error) {
+    m_error = what;
+    if (error < 0) {
+        char buffer[AV_ERROR_MAX_STRING_SIZE] = {};
+        av_strerror(error, buffer, sizeof(buffer));
+        m_error += QString(": ") + buffer;
+    }
+    return false;
+}
+
+bool LibavEncoder::open() {
+    const QByteArray path = m_path.toUtf8();
+    int result = avformat_alloc_output_context2(&m_format, nullptr, nullptr, path.constData());
+    if (result < 0 || !m_format) return fail("No container for " + m_path, result);
+    // Audio is encoded in either mode, so the packet is needed in both
+    m_packet = av_packet_alloc();
+
+    if (m_copy) {
+        m_stream = avformat_new_stream(m_format, nullptr);
+        if (!m_stream) return fail("Could not add a video stream");
+        avcodec_parameters_copy(m_stream->codecpar, m_copy);
+        m_stream->codecpar->codec_tag = 0;     // The source container's tag may not fit this one
+        m_stream->time_base = AVRational{1, m_fps};
+        m_originFrame = 0;
+        if (!m_audioCodecName.isEmpty() && !openAudio()) return false;
+        if (!openOutput()) return false;
+        m_outputOpen = true;
+        qDebug() << "🎬 Copying video" << (m_audioCodec ? QString("with %1 audio").arg(m_audioCodec->codec->name) : QString())
+                 << "to" << m_path;
+        return true;
+    }
+
+    const AVCodec* codec = avcodec_find_encoder_by_name("libx264");
+    if (!codec) codec = avcodec_find_encoder(m_format->oformat->video_codec);
+    if (!codec) return fail("No video encoder for " + m_path);
+
+    m_codec = avcodec_alloc_context3(codec);
+    m_codec->width = m_size.width();
+    m_codec->height = m_size.height();
+    m_codec->time_base = AVRational{1, m_fps};
+    m_codec->framerate = AVRational{m_fps, 1};
+    m_codec->pix_fmt = AV_PIX_FMT_YUV420P;
+    // Hardware encoders tend to want NV12 only
+    if (codec->pix_fmts) {
+        bool planar = false;
+        for (const AVPixelFormat* format = codec->pix_fmts; *format != AV_PIX_FMT_NONE; ++format) {
+            planar |= *format == AV_PIX_FMT_YUV420P;
+            m_nv12 |= *format == AV_PIX_FMT_NV12;
+        }
+        m_nv12 &= !planar;
+        if (m_nv12) m_codec->pix_fmt = AV_PIX_FMT_NV12;
+    }
+    m_codec->color_primaries = AVCOL_PRI_BT709;
+    m_codec->color_trc = AVCOL_TRC_BT709;
+    m_codec->colorspace = AVCOL_SPC_BT709;
+    m_codec->color_range = AVCOL_RANGE_MPEG;
+    m_codec->gop_size = m_fps * 2;
+    if (m_format->oformat->flags & AVFMT_GLOBALHEADER) m_codec->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    // Only libx264 knows these; others ignore the attempt
+    av_opt_set(m_codec->priv_data, "preset", "ultrafast", 0);
+    av_opt_set(m_codec->priv_data, "crf", "18", 0);
+
+    result = avcodec_open2(m_codec, codec, nullptr);
+    if (result < 0) return fail(QString("Could not open encoder %1").arg(codec->name), result);
+
+    m_stream = avformat_new_stream(m_format, nullptr);
+    if (!m_stream) return fail("Could not add a video stream");
+    m_stream->time_base = m_codec->time_base;
+    avcodec_parameters_from_context(m_stream->codecpar, m_codec);
+    if (!m_audioCodecName.isEmpty() && !openAudio()) return false;
+
+    if (!openOutput()) return false;
+    m_outputOpen = true;
+
+    m_frame = av_frame_alloc();
+    m_frame->format = m_codec->pix_fmt;
+    m_frame->width = m_codec->width;
+    m_frame->height = m_codec->height;
+    result = av_frame_get_buffer(m_frame, 0);
+    if (result < 0) return fail("Could not allocate a frame", result);
+
+    qDebug() << "🎬 Encoding in-process with" << codec->name
+             << (m_audioCodec ? m_audioCodec->codec->name : "no audio") << "to" << m_path;
+    return true;
+}
+
+bool LibavEncoder::openAudio() {
+    AVCodecID id = AV_CODEC_ID_AAC;
+    if (m_audioCodecName == "flac") id = AV_CODEC_ID_FLAC;
+    else if (m_audioCodecName == "pcm") id = AV_CODEC_ID_PCM_S16LE;
+    const AVCodec* codec = avcodec_find_encoder(id);
+    if (!codec) return fail("No audio encoder for " + m_audioCodecName);
+
+    m_audioCodec = avcodec_alloc_context3(codec);
+    m_audioCodec->sample_fmt = AV_SAMPLE_FMT_NONE;
+    for (const AVSampleFormat* format = codec->sample_fmts; format && *format != AV_SAMPLE_FMT_NONE; ++format) {
+        if (convertible(*format)) {
+            m_audioCodec->sample_fmt = *format;
+            break;
+        }
+    }
+    if (m_audioCodec->sample_fmt == AV_SAMPLE_FMT_NONE) return fail(QString("%1 takes no usable sample format").arg(codec->name));
+    m_audioCodec->sample_rate = kSampleRate;
+    av_channel_layout_default(&m_audioCodec->ch_layout, kChannels);
+    m_audioCodec->time_base = AVRational{1, kSampleRate};
+    if (id == AV_CODEC_ID_AAC) m_audioCodec->bit_rate = 320000;
+    // FLAC in MP4 is still flagged experimental by the muxer
+    if (id == AV_CODEC_ID_FLAC) m_format->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+    if (m_format->oformat->flags & AVFMT_GLOBALHEADER) m_audioCodec->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    int result = avcodec_open2(m_audioCodec, codec, nullptr);
+    if (result < 0) return fail(QString("Could not open audio encoder %1").arg(codec->name), result);
+
+    m_audioStream = avformat_new_stream(m_format, nullptr);
+    if (!m_audioStream) return fail("Could not add an audio stream");
+    m_audioStream->time_base = m_audioCodec->time_base;
+    avcodec_parameters_from_context(m_audioStream->codecpar, m_audioCodec);
+
+    // PCM and FLAC take any size; AAC wants exactly its frame size
+    m_audioFrameSize = m_audioCodec->frame_size > 0 ? m_audioCodec->frame_size : 1024;
+    m_audioFrame = av_frame_alloc();
+    m_audioFrame->format = m_audioCodec->sample_fmt;
+    m_audioFrame->sample_rate = kSampleRate;
+    m_audioFrame->nb_samples = m_audioFrameSize;
+    av_channel_layout_copy(&m_audioFrame->ch_layout, &m_audioCodec->ch_layout);
+    result = av_frame_get_buffer(m_audioFrame, 0);
+    if (result < 0) return fail("Could not allocate an audio frame", result);
+    m_pcm.reserve(size_t(m_audioFrameSize) * 8 * kChannels);
+    return true;
+}
+
+bool LibavEncoder::write(const VideoFrame& frame) {
+    if (m_copy) return fail("Opened for stream copy");
+    if (frame.size != m_size) return fail("Frame size does not match the stream");
+
+    // The encoder may still reference the previous frame's buffers
+    int result = av_frame_make_writable(m_frame);
+    if (result < 0) return fail("Could not reuse the frame", result);
+
+    YuvConverter::Planes planes;
+    for (int plane = 0; plane < 3; ++plane) {
+        planes.data[plane] = m_frame->data[plane];
+        planes.stride[plane] = m_frame->linesize[plane];
+    }
+    YuvConverter::convert(frame, m_nv12 ? YuvConverter::Layout::Nv12 : YuvConverter::Layout::I420, planes);
+
+    // Nearest tick to the audio the frame was rendered for, kept strictly increasing
+    if (m_originFrame < 0) m_originFrame = qint64(frame.streamFrame);
+    const qint64 sinceOrigin = qint64(frame.streamFrame) - m_originFrame;
+    const qint64 ticks = (sinceOrigin * m_fps + kSampleRate / 2) / kSampleRate;
+    m_lastPts = std::max(ticks, m_lastPts + 1);
+    m_frame->pts = m_lastPts;
+    return encode(m_codec, m_stream, m_frame);
+}
+
+bool LibavEncoder::writeVideoPacket(AVPacket* packet, AVRational timeBase, qint64 firstFrame) {
+    if (!m_copy || !m_outputOpen) return fail("Not opened for stream copy");
+
+    // Whole frames, so containers with coarse clocks (Matroska's ms) come out exact
+    const AVRational frameBase{1, m_fps};
+    const auto toStream = [&](int64_t timestamp) {
+        if (timestamp == AV_NOPTS_VALUE) return timestamp;
+        const int64_t frame = av_rescale_q_rnd(timestamp, timeBase, frameBase,
+                                               AVRounding(AV_ROUND_NEAR_INF | AV_ROUND_PASS_MINMAX));
+        return av_rescale_q(frame + firstFrame, frameBase, m_stream->time_base);
+    };
+    packet->pts = toStream(packet->pts);
+    packet->dts = toStream(packet->dts);
+    packet->duration = av_rescale_q(1, frameBase, m_stream->time_base);
+    packet->stream_index = m_stream->index;
+    packet->pos = -1;
+    return writePacket(packet, m_stream);
+}
+
+bool LibavEncoder::writeAudio(const float* samples, size_t frames, quint64 streamFrame) {
+    if (!m_audioCodec || m_originFrame < 0) return true;
+
+    // Line the samples up with the stream: what precedes the first video
+    // frame (or was already written) is cut, a hole becomes silence
+    const qint64 next = m_originFrame + m_audioPts + qint64(m_pcm.size() / kChannels);
+    qint64 start = qint64(streamFrame);
+    const qint64 end = start + qint64(frames);
+    if (end <= next) return true;
+    if (start < next) {
+        samples += (next - start) * kChannels;
+        start = next;
+    } else if (start > next) {
+        m_pcm.insert(m_pcm.end(), size_t(start - next) * kChannels, 0.0f);
+    }
+    m_pcm.insert(m_pcm.end(), samples, samples + (end - start) * kChannels);
+
+    int whole = int(m_pcm.size() / kChannels / m_audioFrameSize);
+    for (; whole > 0; --whole) {
+        if (!encodeAudio(m_audioFrameSize)) return false;
+    }
+    return true;
+}
+
+bool LibavEncoder::encodeAudio(int frames) {
+    int result = av_frame_make_writable(m_audioFrame);
+    if (result < 0) return fail("Could not reuse the audio frame", result);
+    m_audioFrame->nb_samples = frames;
+    convertPcm(m_pcm.data(), frames, m_audioFrame);
+    m_pcm.erase(m_pcm.begin(), m_pcm.begin() + size_t(frames) * kChannels);
+
+    m_audioFrame->pts = m_audioPts;
+    m_audioPts += frames;
+    return encode(m_audioCodec, m_audioStream, m_audioFrame);
+}
+
+bool LibavEncoder::encode(AVCodecContext* codec, AVStream* stream, AVFrame* frame) {
+    int result = avcodec_send_frame(codec, frame);
+    if (result < 0) return fail("Encoding failed", result);
+
+    while (true) {
+        result = avcodec_receive_packet(codec, m_packet);
+        if (result == AVERROR(EAGAIN) || result == AVERROR_EOF) return true;
+        if (result < 0) return fail("Encoding failed", result);
+
+        av_packet_rescale_ts(m_packet, codec->time_base, stream->time_base);
+        m_packet->stream_index = stream->index;
+        if (!writePacket(m_packet, stream)) return false;
+    }
+}
+
+bool LibavEncoder::openOutput() {
+    const QByteArray path = m_path.toUtf8();
+    if (!(m_format->oformat->flags & AVFMT_NOFILE)) {
+        const int result = avio_open(&m_format->pb, path.constData(), AVIO_FLAG_WRITE);
+        if (result < 0) return fail("Could not create " + m_path, result);
+    }
+    const int result = avformat_write_header(m_format, nullptr);
+    if (result < 0) return fail("Could not write the header of " + m_path, result);
+    return true;
+}
+
+bool LibavEncoder::writePacket(AVPacket* packet, AVStream* stream) {
+    Q_UNUSED(stream);
+    const int result = av_interleaved_write_frame(m_format, packet);  // Takes the packet's data
+    if (result < 0) return fail("Could not write to " + m_path, result);
+    return true;
+}
+
+void LibavEncoder::closeOutput() {
+    av_write_trailer(m_format);
+}
+
+void LibavEncoder::close() {
+    if (m_outputOpen) {
+        if (m_frame) encode(m_codec, m_stream, nullptr);
+        if (m_audioFrame) {
+            // The last frame may be short
+            const int remaining = int(m_pcm.size() / kChannels);
+            if (remaining > 0) encodeAudio(remaining);
+            encode(m_audioCodec, m_audioStream, nullptr);
+        }
+        closeOutput();
+        m_outputOpen = false;
+    }
+    release();
+}
+
+void LibavEncoder::release() {
+    av_packet_free(&m_packet);
+    av_frame_free(&m_frame);
+    avcodec_free_context(&m_codec);
+    av_frame_free(&m_audioFrame);
+    avcodec_free_context(&m_audioCodec);
+    m_audioStream = nullptr;
+    m_pcm.clear();
+    if (m_format) {
+        if (m_format->pb && !(m_format->oformat->flags & AVFMT_NOFILE)) avio_closep(&m_format->pb);
+        avformat_free_context(m_format);
+        m_format = nullptr;
+    }
+    m_stream = nullptr;
+}
+
+#endif
@@ -0,0 +1,95 @@
+#pragma once
+#include "FrameEncoder.h"
+#include <QSize>
+#include <vector>
+
+#ifdef VIBESYNC_LIBAV_ENCODER
+
+struct AVCodecContext;
+struct AVCodecParameters;
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+struct AVRational;
+struct AVStream;
+
+// Encodes and muxes in-process with libavcodec/libavformat: H.264 (libx264
+// ultrafast, CRF 18, like the default command template) or else the
+// container's default codec. Frames are converted by YuvConverter straight
+// into the encoder's planes, I420 or NV12, whichever the codec takes.
+//
+// With an audio codec ("aac", "flac" or "pcm") the played PCM is encoded
+// into a second stream. Both streams are timed by the audio output clock:
+// video by each frame's streamFrame, audio by the tap position of its
+// samples, counted from the first frame. They cannot drift apart however
+// long the recording; frames lost upstream leave a gap in the video (a
+// repeated frame takes the next tick) and lost PCM becomes silence.
+class LibavEncoder : public FrameEncoder {
+public:
+    // audioCodec empty for a silent recording
+    LibavEncoder(const QString& path, const QSize& size, int fps, const QString& audioCodec = QString());
+    ~LibavEncoder() override;
+
+    bool open() override;
+    bool write(const VideoFrame& frame) override;
+    void close() override;
+    QString errorString() const override { return m_error; }
+
+    bool hasAudio() const override { return m_audioCodec != nullptr; }
+    bool writeAudio(const float* samples, size_t frames, quint64 streamFrame) override;
+
+    // Stream copy: instead of encoding frames, takes video already encoded
+    // with these parameters through writeVideoPacket(). Call before open().
+    // Both streams then start at stream frame 0.
+    void setVideoCopy(const AVCodecParameters* parameters);
+    // packet's timestamps in timeBase, counted from firstFrame (in video
+    // frames); rounded to whole frames
+    bool writeVideoPacket(AVPacket* packet, AVRational timeBase, qint64 firstFrame);
+
+protected:
+    // Where encoded packets go; by default muxed into the file at path.
+    // openOutput() runs once both streams exist, closeOutput() after the
+    // encoders are flushed.
+    virtual bool openOutput();
+    virtual bool writePacket(AVPacket* packet, AVStream* stream);
+    virtual void closeOutput();
+
+    bool fail(const QString& what, int error = 0);
+    AVFormatContext* formatContext() const { return m_format; }
+    AVStream* videoStream() const { return m_stream; }
+    AVStream* audioStream() const { return m_audioStream; }
+
+private:
+    bool openAudio();
+    // Sends frame (null to flush) and writes out every packet it produces
+    bool encode(AVCodecContext* codec, AVStream* stream, AVFrame* frame);
+    // Encodes frames of pending PCM from the front of m_pcm
+    bool encodeAudio(int frames);
+    void release();
+
+    QString m_path;
+    QSize m_size;
+    int m_fps;
+    QString m_audioCodecName;
+    QString m_error;
+    AVCodecParameters* m_copy = nullptr;
+
+    AVFormatContext* m_format = nullptr;
+    AVCodecContext* m_codec = nullptr;
+    AVStream* m_stream = nullptr;
+    AVFrame* m_frame = nullptr;
+    AVPacket* m_packet = nullptr;
+    bool m_nv12 = false;
+    bool m_outputOpen = false;
+    qint64 m_originFrame = -1;      // streamFrame of the first video frame
+    qint64 m_lastPts = -1;
+
+    AVCodecContext* m_audioCodec = nullptr;
+    AVStream* m_audioStream = nullptr;
+    AVFrame* m_audioFrame = nullptr;
+    int m_audioFrameSize = 0;
+    qint64 m_audioPts = 0;          // Samples encoded since the origin
+    std::vector<float> m_pcm;       // Interleaved, not yet a whole encoder frame
+};
+
+#endif
@@ -0,0 +1,31 @@
+#include "LoadWindow.h"
+#include <algorithm>
+
+LoadWindow::LoadWindow(int frames, qint64 cooldownNs) : m_frames(size_t(std::max(1, frames))), m_cooldownNs(cooldownNs) {
+    m_samples.reserve(m_frames);
+    m_sorted.reserve(m_frames);
+}
+
+bool LoadWindow::add(qint64 ns, qint64 nowNs) {
+    if (m_samples.size() < m_frames) m_samples.push_back(ns);
+    else m_samples[m_pos++ % m_frames] = ns;
+    return m_samples.size() == m_frames && nowNs - m_lastChangeNs >= m_cooldownNs;
+}
+
+qint64 LoadWindow::p90() {
+    if (m_samples.empty()) return 0;
+    m_sorted.assign(m_samples.begin(), m_samples.end());
+    const size_t p90 = m_sorted.size() * 9 / 10;
+    std::nth_element(m_sorted.begin(), m_sorted.begin() + p90, m_sorted.end());
+    return m_sorted[p90];
+}
+
+void LoadWindow::changed(qint64 nowNs) {
+    m_lastChangeNs = nowNs;
+    reset();
+}
+
+void LoadWindow::reset() {
+    m_samples.clear();
+    m_pos = 0;
+}
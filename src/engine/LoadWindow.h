@@ -0,0 +1,33 @@
+#pragma once
+#include <QtGlobal>
+#include <vector>
+
+// The measurement side of the load governors (ResolutionScaler,
+// MeshGovernor): a sliding window of per-frame costs, its 90th percentile,
+// and a cooldown after every change they make.
+//
+// Nothing is allocated after construction; the percentile sorts a copy of
+// the window in a scratch buffer kept for the purpose.
+class LoadWindow {
+public:
+    LoadWindow(int frames, qint64 cooldownNs);
+
+    // Adds one frame's cost. Returns true once the window is full and the
+    // last change has settled, i.e. when p90() is worth acting on.
+    bool add(qint64 ns, qint64 nowNs);
+    // Of the samples in the window
+    qint64 p90();
+    // A change was made at nowNs: the samples so far describe the old
+    // setting, so the window starts over and the cooldown begins
+    void changed(qint64 nowNs);
+    // Drops collected samples, keeping the cooldown
+    void reset();
+
+private:
+    size_t m_frames;
+    qint64 m_cooldownNs;
+    std::vector<qint64> m_samples;
+    std::vector<qint64> m_sorted;       // Scratch for the percentile
+    size_t m_pos = 0;
+    qint64 m_lastChangeNs = 0;
+};
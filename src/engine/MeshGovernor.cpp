@@ -0,0 +1,50 @@
+#include "MeshGovernor.h"
+#include <algorithm>
+#include <cmath>
+
+MeshGovernor::MeshGovernor() : m_window(kWindowFrames, kCooldownNs) {}
+
+void MeshGovernor::setMaximum(const QSize& mesh) {
+    m_maximum = QSize(std::max(kMinMeshX, mesh.width()), std::max(kMinMeshY, mesh.height()));
+    resetWindow();
+}
+
+void MeshGovernor::setEnabled(bool enabled) {
+    m_enabled = enabled;
+    if (!enabled) m_level = 0;
+    resetWindow();
+}
+
+void MeshGovernor::setBudget(qint64 frameNs) {
+    if (frameNs <= 0 || frameNs == m_budgetNs) return;
+    m_budgetNs = frameNs;
+    resetWindow();
+}
+
+void MeshGovernor::resetWindow() {
+    m_window.reset();
+}
+
+bool MeshGovernor::addSample(qint64 warpNs, qint64 nowNs) {
+    if (!m_enabled) return false;
+
+    if (!m_window.add(warpNs, nowNs)) return false;
+    const double load = static_cast<double>(m_window.p90()) / m_budgetNs;
+
+    const QSize before = meshSize();
+    if (load > kHighLoad && m_level + 1 < kLevelCount) {
+        ++m_level;
+    } else if (load < kLowLoad && m_level > 0) {
+        --m_level;
+    }
+    if (meshSize() == before) return false;
+
+    m_window.changed(nowNs);
+    return true;
+}
+
+QSize MeshGovernor::meshSize() const {
+    const double factor = kLevels[m_level];
+    return QSize(std::max(kMinMeshX, static_cast<int>(std::lround(m_maximum.width() * factor))),
+                 std::max(kMinMeshY, static_cast<int>(std::lround(m_maximum.height() * factor))));
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <QSize>
+#include <QtGlobal>
+#include "LoadWindow.h"
+
+// Picks projectM's per-vertex mesh density from the measured warp cost.
+//
+// projectM evaluates the per-vertex (warp) equations on the CPU for every
+// mesh point, so the time spent inside its render call grows with the mesh
+// and not with the output resolution. That makes the mesh the cheapest
+// quality knob: a coarser warp grid is hard to see, while a lower resolution
+// is not. The governor therefore reacts at lower loads than the
+// ResolutionScaler, giving up mesh density first and getting it back last.
+//
+// The configured mesh size is the ceiling. Each step changes both axes by
+// one level of kLevels; decisions use the 90th percentile of a window of
+// frames against a share of the frame budget, with a cooldown in between.
+class MeshGovernor {
+public:
+    static constexpr int kWindowFrames = 30;
+    static constexpr qint64 kCooldownNs = 1000000000;
+    static constexpr double kHighLoad = 0.5;   // Warp share of the frame budget
+    static constexpr double kLowLoad = 0.2;
+    static constexpr int kMinMeshX = 8;
+    static constexpr int kMinMeshY = 6;
+
+    MeshGovernor();
+
+    // The mesh size asked for in the settings
+    void setMaximum(const QSize& mesh);
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+    void setBudget(qint64 frameNs);
+
+    // Feeds the CPU time of one projectM render call. Returns true if the
+    // mesh size changed.
+    bool addSample(qint64 warpNs, qint64 nowNs);
+    // Drops collected samples, e.g. after another knob changed the load
+    void resetWindow();
+
+    QSize meshSize() const;
+
+private:
+    static constexpr double kLevels[] = {1.0, 0.75, 0.5, 0.375, 0.25};
+    static constexpr int kLevelCount = sizeof(kLevels) / sizeof(kLevels[0]);
+
+    QSize m_maximum{32, 24};
+    bool m_enabled = true;
+    int m_level = 0;
+    qint64 m_budgetNs = 16666667;
+
+    LoadWindow m_window;
+};
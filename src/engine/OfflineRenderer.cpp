@@ -0,0 +1,235 @@
+#include "OfflineRenderer.h"
+#include "VizEngine.h"
+#include "PresetManager.h"
+#include "TrackDecoder.h"
+#include "VideoRecorder.h"
+#include "FrameReadback.h"
+#include "../data/SettingsManager.h"
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
+#include <QSurfaceFormat>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+constexpr int kSampleRate = TrackDecoder::kSampleRate;
+constexpr int kChannels = TrackDecoder::kChannels;
+constexpr qint64 kProgressIntervalMs = 5000;
+
+// The decoded track as the encoder's audio. The render loop releases it up
+// to the frame it has rendered, so audio and video reach the muxer roughly
+// interleaved instead of the whole track first.
+class TrackPcm : public PcmSource {
+public:
+    // pcm starts at stream frame base; the encoder gets it from encodeFrom
+    TrackPcm(std::vector<float> pcm, quint64 base, quint64 encodeFrom)
+        : m_pcm(std::move(pcm)), m_base(base), m_position(std::max(base, encodeFrom)) {}
+
+    quint64 end() const { return m_base + m_pcm.size() / kChannels; }
+    const float* at(quint64 streamFrame) const { return m_pcm.data() + (streamFrame - m_base) * kChannels; }
+
+    // Render thread
+    void release(quint64 untilFrame) {
+        m_released.store(std::min(untilFrame, end()), std::memory_order_release);
+    }
+
+    // Writer thread
+    quint64 position() const override { return m_position; }
+    size_t read(float* dst, size_t maxFrames) override {
+        const quint64 released = m_released.load(std::memory_order_acquire);
+        if (released <= m_position) return 0;
+        const size_t count = static_cast<size_t>(std::min<quint64>(maxFrames, released - m_position));
+        std::memcpy(dst, at(m_position), count * kChannels * sizeof(float));
+        m_position += count;
+        return count;
+    }
+
+private:
+    const std::vector<float> m_pcm;
+    const quint64 m_base;
+    std::atomic<quint64> m_released{0};
+    quint64 m_position;
+};
+
+// Output stream frame shown by video frame n
+quint64 streamFrameOf(quint64 frame, int fps) {
+    return frame * kSampleRate / fps;
+}
+}
+
+OfflineRenderer::OfflineRenderer(const Options& options) : m_options(options) {
+    m_options.fps = std::max(1, m_options.fps);
+    m_options.size = m_options.size.expandedTo(QSize(16, 16));
+}
+
+QString OfflineRenderer::choosePreset() const {
+    if (!m_options.presetPath.isEmpty()) return QFileInfo(m_options.presetPath).absoluteFilePath();
+    PresetManager presets;
+    presets.setPresetDirectory(SettingsManager::instance().getPresetPath());
+    return presets.currentPreset();
+}
+
+int OfflineRenderer::run() {
+    const QString preset = choosePreset();
+    if (preset.isEmpty() || !QFileInfo::exists(preset)) {
+        qWarning() << "❌ No preset to render with:" << (preset.isEmpty() ? SettingsManager::instance().getPresetPath() : preset);
+        return 1;
+    }
+
+    // Pre-roll frames are rendered from the audio before startFrame; the
+    // decoder skips what comes before them
+    const int fps = m_options.fps;
+    const qint64 startFrame = std::max<qint64>(0, m_options.startFrame);
+    const qint64 firstFrame = std::max<qint64>(0, startFrame - qint64(std::lround(m_options.prerollSeconds * fps)));
+    const quint64 pcmStart = streamFrameOf(firstFrame, fps);
+    size_t maxFrames = std::numeric_limits<size_t>::max() / kChannels;
+    if (m_options.frameCount >= 0) maxFrames = streamFrameOf(startFrame + m_options.frameCount, fps) - pcmStart;
+
+    std::vector<float> pcm;
+    QString error;
+    QElapsedTimer timer;
+    timer.start();
+    if (!TrackDecoder::decodeFile(m_options.trackPath, pcm, maxFrames, &error, pcmStart)) {
+        qWarning() << "❌ Could not decode" << m_options.trackPath << ":" << error;
+        return 1;
+    }
+    auto audio = std::make_shared<TrackPcm>(std::move(pcm), pcmStart, streamFrameOf(startFrame, fps));
+    qInfo().noquote() << QString("🎵 Decoded %1 (%2 s) in %3 ms")
+                             .arg(QFileInfo(m_options.trackPath).fileName())
+                             .arg(double(audio->end() - pcmStart) / kSampleRate, 0, 'f', 1)
+                             .arg(timer.elapsed());
+
+    // Every frame whose moment the audio reaches
+    qint64 endFrame = qint64((audio->end() * fps + kSampleRate - 1) / kSampleRate);
+    if (m_options.frameCount >= 0) endFrame = std::min(endFrame, startFrame + m_options.frameCount);
+    if (endFrame <= startFrame) {
+        qWarning() << "❌ Nothing to render: the track ends before frame" << startFrame;
+        return 1;
+    }
+    const quint64 totalFrames = quint64(endFrame - startFrame);
+    const double seconds = double(totalFrames) / fps;
+
+    // projectM 4 needs GL 3.3 core, which llvmpipe provides
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    QOpenGLContext context;
+    context.setFormat(format);
+    QOffscreenSurface surface;
+    if (!context.create()) {
+        qWarning() << "❌ Could not create an OpenGL 3.3 context";
+        return 1;
+    }
+    surface.setFormat(context.format());
+    surface.create();
+    if (!context.makeCurrent(&surface)) {
+        qWarning() << "❌ Could not make the OpenGL context current";
+        return 1;
+    }
+    QOpenGLExtraFunctions* gl = context.extraFunctions();
+    const QString renderer = QString::fromLatin1(reinterpret_cast<const char*>(gl->glGetString(GL_RENDERER)));
+
+    VideoRecorder recorder;
+    if (!recorder.startRender(m_options.outputPath, m_options.size, fps, audio, m_options.audioCodec,
+                              m_options.renditions)) {
+        qWarning() << "❌ Could not start encoding to" << m_options.outputPath;
+        return 1;
+    }
+    // The recorder rounds the size down to what the encoder takes
+    const QSize size = recorder.frameSize();
+
+    qInfo().noquote() << "🎬 Rendering" << totalFrames << "frames at"
+                      << QString("%1x%2@%3").arg(size.width()).arg(size.height()).arg(fps)
+                      << (startFrame > 0 ? QString("from frame %1 (%2 pre-roll)").arg(startFrame).arg(startFrame - firstFrame)
+                                         : QString())
+                      << "with" << QFileInfo(preset).fileName() << "on" << renderer;
+
+    quint64 readbackDropped = 0;
+    timer.restart();
+    {
+        QOpenGLFramebufferObject target(size, QOpenGLFramebufferObject::CombinedDepthStencil);
+        const SettingsManager& settings = SettingsManager::instance();
+        VizEngine engine;
+        if (!engine.initialize(preset, settings.getMeshX(), settings.getMeshY(), fps)) {
+            recorder.stop();
+            return 1;
+        }
+        engine.resize(size.width(), size.height());
+        if (!engine.setFrameTime(0.0)) {
+            qWarning() << "⚠️ projectM before 4.1 animates by the wall clock; renders will not be repeatable";
+        }
+
+        // Blocks in the sink while the encoder queue is full, which paces the loop
+        ReadbackRing readback([&recorder](VideoFramePtr frame) { recorder.writeFrame(frame); });
+        readback.reservePool(recorder.framesHeld());
+        quint64 fed = pcmStart;
+        qint64 lastProgressMs = 0;
+        for (qint64 n = firstFrame; n < endFrame; ++n) {
+            // Reported below as an incomplete render
+            if (recorder.hasFailed()) break;
+            // Like the live path: the audio up to the moment the frame is shown
+            const quint64 streamFrame = streamFrameOf(n, fps);
+            if (streamFrame > fed) {
+                engine.addPcm(audio->at(fed), static_cast<size_t>(streamFrame - fed));
+                fed = streamFrame;
+            }
+            engine.setFrameTime(double(n) / fps);
+            engine.renderFrame(target.handle());
+            if (n < startFrame) continue;   // Pre-roll
+
+            FrameScheduler::Frame frame;
+            frame.render = true;
+            frame.presentNs = static_cast<qint64>(quint64(n) * 1000000000ULL / fps);
+            frame.positionMs = frame.presentNs / 1e6;
+            frame.streamFrame = streamFrame;
+            readback.capture(gl, target.handle(), size, frame);
+            readback.collect(gl, false);
+            audio->release(streamFrameOf(n + 1, fps));
+
+            const quint64 done = quint64(n - startFrame + 1);
+            if (timer.elapsed() - lastProgressMs >= kProgressIntervalMs) {
+                lastProgressMs = timer.elapsed();
+                qInfo().noquote() << QString("  %1%  %2x real time")
+                                         .arg(100.0 * done / totalFrames, 0, 'f', 0)
+                                         .arg(done / double(fps) / (lastProgressMs / 1000.0), 0, 'f', 2);
+            }
+        }
+        readback.collect(gl, true);
+        readbackDropped = readback.dropped();
+        readback.release(gl);
+        // The engine owns GL objects, so it goes while the context is current
+    }
+    context.doneCurrent();
+
+    // The tail of the track after the last frame
+    audio->release(audio->end());
+    recorder.stop();
+
+    const EncoderFeed::Stats stats = recorder.stats();
+    const double wallSeconds = timer.elapsed() / 1000.0;
+    for (const EncoderFeed::Stats& rendition : recorder.renditionStats()) {
+        if (rendition.written != totalFrames) {
+            qWarning() << "❌ Rendition incomplete:" << rendition.written << "of" << totalFrames << "frames written";
+            return 1;
+        }
+    }
+    if (stats.written != totalFrames || readbackDropped > 0) {
+        qWarning() << "❌ Render incomplete:" << stats.written << "of" << totalFrames << "frames written,"
+                   << readbackDropped << "lost in readback";
+        return 1;
+    }
+    qInfo().noquote() << QString("✅ Rendered %1 s of video in %2 s (%3x real time): %4")
+                             .arg(seconds, 0, 'f', 1)
+                             .arg(wallSeconds, 0, 'f', 1)
+                             .arg(seconds / std::max(wallSeconds, 0.001), 0, 'f', 2)
+                             .arg(m_options.outputPath);
+    return 0;
+}
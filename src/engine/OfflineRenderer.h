@@ -0,0 +1,46 @@
+#pragma once
+#include <QList>
+#include <QSize>
+#include <QString>
+
+// Headless render of a track (or a part of it) to a video file, faster
+// than real time.
+//
+// Decodes the whole track up front and steps projectM with a frame clock
+// of its own: frame n is rendered at n / fps seconds with the audio up to
+// that point, so the output does not depend on how long a frame takes and
+// two runs give the same video. Frames are read back asynchronously and
+// encoded through VideoRecorder with the track muxed in; when the encoder
+// falls behind, rendering waits for it. Works on Mesa llvmpipe like
+// PresetProfiler.
+class OfflineRenderer {
+public:
+    struct Options {
+        QString trackPath;
+        QString outputPath;
+        QString presetPath;         // Empty: the current preset of the preset directory
+        QSize size{1920, 1080};
+        int fps = 60;
+        QString audioCodec;         // Empty: the recording setting
+        QList<QSize> renditions;    // Extra outputs next to outputPath, as VideoRecorder makes them
+
+        // A part of the track, for segment-parallel rendering: the video
+        // frames from startFrame on (frameCount of them, -1 to the end),
+        // timed as in a render of the whole track. The preroll before it is
+        // rendered but not encoded, so projectM's feedback buffers and beat
+        // detection arrive at startFrame in the state they would have had.
+        qint64 startFrame = 0;
+        qint64 frameCount = -1;
+        double prerollSeconds = 0.0;
+    };
+
+    explicit OfflineRenderer(const Options& options);
+
+    // Needs a QGuiApplication. Returns the process exit code.
+    int run();
+
+private:
+    QString choosePreset() const;
+
+    Options m_options;
+};
@@ -0,0 +1,117 @@
+#include "PcmSplitter.h"
+#include "AudioEngine.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr int kChannels = AudioEngine::kTapChannels;
+constexpr size_t kChunkFrames = 4096;
+constexpr quint64 kMaxLagFrames = quint64(PcmSplitter::kMaxLagSeconds * AudioEngine::kTapSampleRate);
+// What every reader is past is only dropped from the buffer in steps of this
+constexpr quint64 kTrimFrames = AudioEngine::kTapSampleRate;
+}
+
+class PcmSplitter::Branch : public PcmSource {
+public:
+    Branch(std::shared_ptr<PcmSplitter> splitter, size_t reader) : m_splitter(std::move(splitter)), m_reader(reader) {}
+    ~Branch() override { m_splitter->release(m_reader); }
+
+    size_t discard() override { return m_splitter->discard(m_reader); }
+    quint64 dropped() const override { return m_splitter->dropped(m_reader); }
+    quint64 position() const override { return m_splitter->position(m_reader); }
+    size_t read(float* dst, size_t maxFrames) override { return m_splitter->read(m_reader, dst, maxFrames); }
+
+private:
+    std::shared_ptr<PcmSplitter> m_splitter;
+    size_t m_reader;
+};
+
+PcmSplitter::PcmSplitter(std::shared_ptr<PcmSource> source)
+    : m_source(std::move(source)), m_chunk(kChunkFrames * kChannels) {}
+
+std::shared_ptr<PcmSource> PcmSplitter::branch() {
+    QMutexLocker locker(&m_mutex);
+    pull();
+    Reader reader;
+    reader.position = end();
+    m_readers.push_back(reader);
+    return std::make_shared<Branch>(shared_from_this(), m_readers.size() - 1);
+}
+
+quint64 PcmSplitter::end() const {
+    return m_base + m_buffer.size() / kChannels;
+}
+
+void PcmSplitter::pull() {
+    if (!m_started) {
+        m_base = m_source->position();
+        m_sourceDropped = m_source->dropped();
+        m_started = true;
+    }
+
+    // Like EncoderFeed::pumpAudio(): after an overflow the source's read
+    // position is unsure, so start over from an empty source
+    const quint64 dropped = m_source->dropped();
+    if (dropped != m_sourceDropped) {
+        m_lost += dropped - m_sourceDropped + m_source->discard();
+        m_sourceDropped = m_source->dropped();
+        m_buffer.clear();
+        m_base = m_source->position();
+    }
+
+    size_t frames;
+    while ((frames = m_source->read(m_chunk.data(), kChunkFrames)) > 0) {
+        m_buffer.insert(m_buffer.end(), m_chunk.begin(), m_chunk.begin() + frames * kChannels);
+    }
+
+    const quint64 newest = end();
+    quint64 oldest = newest;
+    for (Reader& reader : m_readers) {
+        if (!reader.active) continue;
+        reader.position = std::max(reader.position, m_base);
+        if (newest - reader.position > kMaxLagFrames) {
+            reader.lost += newest - kMaxLagFrames - reader.position;
+            reader.position = newest - kMaxLagFrames;
+        }
+        oldest = std::min(oldest, reader.position);
+    }
+    if (oldest - m_base >= kTrimFrames) {
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + (oldest - m_base) * kChannels);
+        m_base = oldest;
+    }
+}
+
+void PcmSplitter::release(size_t reader) {
+    QMutexLocker locker(&m_mutex);
+    m_readers[reader].active = false;
+}
+
+size_t PcmSplitter::discard(size_t reader) {
+    QMutexLocker locker(&m_mutex);
+    pull();
+    Reader& state = m_readers[reader];
+    const size_t skipped = size_t(end() - state.position);
+    state.position = end();
+    return skipped;
+}
+
+quint64 PcmSplitter::dropped(size_t reader) {
+    QMutexLocker locker(&m_mutex);
+    pull();
+    return m_lost + m_readers[reader].lost;
+}
+
+quint64 PcmSplitter::position(size_t reader) {
+    QMutexLocker locker(&m_mutex);
+    return std::max(m_readers[reader].position, m_base);
+}
+
+size_t PcmSplitter::read(size_t reader, float* dst, size_t maxFrames) {
+    QMutexLocker locker(&m_mutex);
+    pull();
+    Reader& state = m_readers[reader];
+    const size_t frames = size_t(std::min<quint64>(maxFrames, end() - state.position));
+    std::memcpy(dst, m_buffer.data() + (state.position - m_base) * kChannels, frames * kChannels * sizeof(float));
+    state.position += frames;
+    return frames;
+}
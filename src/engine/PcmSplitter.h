@@ -0,0 +1,50 @@
+#pragma once
+#include <QMutex>
+#include <memory>
+#include <vector>
+#include "EncoderFeed.h"
+
+// One PcmSource read by several encoder feeds, each through a branch of
+// its own: what the source produces is kept in a shared buffer until every
+// branch has read it.
+//
+// Branches behave like the recorder tap towards their feed. An overflow of
+// the source counts as dropped on all of them; a branch that falls more
+// than kMaxLagSeconds behind the newest audio loses its oldest, so a
+// stalled encoder cannot make the buffer grow without bound.
+class PcmSplitter : public std::enable_shared_from_this<PcmSplitter> {
+public:
+    static constexpr double kMaxLagSeconds = 10.0;
+
+    explicit PcmSplitter(std::shared_ptr<PcmSource> source);
+
+    // A new reader, starting at the newest audio
+    std::shared_ptr<PcmSource> branch();
+
+private:
+    class Branch;
+    struct Reader {
+        quint64 position = 0;
+        quint64 lost = 0;           // Skipped for lagging too far behind
+        bool active = true;
+    };
+
+    // With m_mutex held: takes in what the source has
+    void pull();
+    quint64 end() const;
+    void release(size_t reader);
+    size_t discard(size_t reader);
+    quint64 dropped(size_t reader);
+    quint64 position(size_t reader);
+    size_t read(size_t reader, float* dst, size_t maxFrames);
+
+    std::shared_ptr<PcmSource> m_source;
+    QMutex m_mutex;
+    std::vector<float> m_buffer;    // Interleaved, from stream frame m_base
+    quint64 m_base = 0;
+    bool m_started = false;
+    quint64 m_sourceDropped = 0;
+    quint64 m_lost = 0;             // Source overflows, lost on every branch
+    std::vector<Reader> m_readers;
+    std::vector<float> m_chunk;
+};
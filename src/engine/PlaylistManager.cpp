@@ -1,5 +1,11 @@
 #include "PlaylistManager.h"
+#include "TrackAnalyzer.h"
 #include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QUrl>
+#include <algorithm>
 
 PlaylistManager::PlaylistManager(QObject* parent) : QObject(parent) {
     m_random = QRandomGenerator::securelySeeded();
@@ -14,6 +20,7 @@ void PlaylistManager::addFiles(const QStringList& filePaths) {
     }
     
     if (addedCount > 0) {
+        refreshUpcoming(true);
         emit playlistChanged();
         qDebug() << "📁 Added" << addedCount << "files to playlist";
     }
@@ -25,6 +32,8 @@ bool PlaylistManager::addFile(const QString& filePath) {
     // Avoid duplicates
     if (!m_playlist.contains(filePath)) {
         m_playlist.append(filePath);
+        // Analyse in the background so the data is cached before it plays
+        TrackAnalyzer::instance().enqueue(filePath);
         return true;
     }
     return false;
@@ -42,6 +51,7 @@ void PlaylistManager::removeFile(int index) {
             m_currentIndex--;
         }
         
+        refreshUpcoming(true);
         emit playlistChanged();
     }
 }
@@ -49,6 +59,7 @@ void PlaylistManager::removeFile(int index) {
 void PlaylistManager::clear() {
     m_playlist.clear();
     m_currentIndex = -1;
+    refreshUpcoming(true);
     emit playlistChanged();
 }
 
@@ -66,7 +77,9 @@ QString PlaylistManager::currentFile() const {
 void PlaylistManager::playAtIndex(int index) {
     if (index >= 0 && index < m_playlist.count()) {
         m_currentIndex = index;
+        m_shuffleOrder.removeAll(index);
         QString file = currentFile();
+        refreshUpcoming();
         emit currentTrackChanged(file);
         emit playbackStarted(file);
         qDebug() << "🎵 Playing:" << QFileInfo(file).fileName();
@@ -74,19 +87,51 @@ void PlaylistManager::playAtIndex(int index) {
 }
 
 void PlaylistManager::next() {
-    if (m_playlist.isEmpty()) return;
-    
-    int nextIndex;
-    if (m_shuffle) {
-        nextIndex = m_random.bounded(0, m_playlist.count());
-    } else {
-        nextIndex = m_currentIndex + 1;
-        if (nextIndex >= m_playlist.count()) {
-            nextIndex = 0;
+    const int nextIndex = upcomingIndex();
+    if (nextIndex < 0) return;
+    playAtIndex(nextIndex);
+}
+
+void PlaylistManager::advance() {
+    const int nextIndex = upcomingIndex();
+    if (nextIndex < 0) return;
+
+    m_currentIndex = nextIndex;
+    m_shuffleOrder.removeAll(nextIndex);
+    refreshUpcoming();
+    emit currentTrackChanged(currentFile());
+    qDebug() << "🎵 Playing:" << QFileInfo(currentFile()).fileName();
+}
+
+QString PlaylistManager::upcomingFile() const {
+    return m_upcoming;
+}
+
+int PlaylistManager::upcomingIndex() const {
+    if (m_playlist.isEmpty()) return -1;
+    if (m_shuffle && !m_shuffleOrder.isEmpty()) return m_shuffleOrder.first();
+    return (m_currentIndex + 1) % m_playlist.count();
+}
+
+void PlaylistManager::refreshUpcoming(bool reshuffle) {
+    if (reshuffle) m_shuffleOrder.clear();
+
+    // Start a new shuffle pass when the last one is used up. The current
+    // track goes to the back so it never plays twice in a row.
+    if (m_shuffle && m_shuffleOrder.isEmpty() && !m_playlist.isEmpty()) {
+        for (int i = 0; i < m_playlist.count(); ++i) {
+            if (i != m_currentIndex) m_shuffleOrder.append(i);
         }
+        std::shuffle(m_shuffleOrder.begin(), m_shuffleOrder.end(), m_random);
+        if (m_currentIndex >= 0) m_shuffleOrder.append(m_currentIndex);
+    }
+
+    const int index = upcomingIndex();
+    const QString upcoming = index >= 0 ? m_playlist[index] : QString();
+    if (upcoming != m_upcoming) {
+        m_upcoming = upcoming;
+        emit upcomingTrackChanged(m_upcoming);
     }
-    
-    playAtIndex(nextIndex);
 }
 
 void PlaylistManager::previous() {
@@ -105,10 +150,48 @@ bool PlaylistManager::shuffle() const {
 }
 
 void PlaylistManager::setShuffle(bool enable) {
+    if (enable == m_shuffle) return;
     m_shuffle = enable;
+    refreshUpcoming(true);
 }
 
-bool PlaylistManager::isValidAudioFile(const QString& filePath) const {
+bool PlaylistManager::isValidAudioFile(const QString& filePath) {
     QString extension = QFileInfo(filePath).suffix().toLower();
     return QStringList({"mp3", "wav", "flac", "ogg", "m4a", "aac"}).contains(extension);
-}
\ No newline at end of file
+}
+
+bool PlaylistManager::saveM3u(const QString& path) const {
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+    QTextStream stream(&out);
+    stream << "#EXTM3U\n";
+    for (const QString& filePath : m_playlist) stream << QFileInfo(filePath).absoluteFilePath() << "\n";
+    stream.flush();
+    return out.commit();
+}
+
+QStringList PlaylistManager::readPlaylist(const QString& path) {
+    QStringList tracks;
+    const QFileInfo info(path);
+    if (info.isDir()) {
+        QDir dir(path);
+        for (const QString& name : dir.entryList(QDir::Files, QDir::Name)) {
+            if (isValidAudioFile(name)) tracks << dir.absoluteFilePath(name);
+        }
+        return tracks;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return tracks;
+    // Entries are relative to the playlist's own directory
+    const QDir base = info.absoluteDir();
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        QString line = stream.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+        if (line.startsWith("file://")) line = QUrl(line).toLocalFile();
+        const QString filePath = QDir::cleanPath(base.absoluteFilePath(line));
+        if (isValidAudioFile(filePath) && !tracks.contains(filePath)) tracks << filePath;
+    }
+    return tracks;
+}
@@ -3,7 +3,8 @@
 #include <QStringList>
 #include <QDir>
 #include <QFileInfo>
-#include <QMediaPlayer>
+#include <QList>
+#include <QRandomGenerator>
 
 class PlaylistManager : public QObject {
     Q_OBJECT
@@ -11,7 +12,7 @@ public:
     explicit PlaylistManager(QObject* parent = nullptr);
     
     void addFiles(const QStringList& filePaths);
-    void addFile(const QString& filePath);
+    bool addFile(const QString& filePath);
     void removeFile(int index);
     void clear();
     
@@ -21,23 +22,41 @@ public:
     void playAtIndex(int index);
     void next();
     void previous();
+    // Makes the upcoming track current without starting playback; used when
+    // the audio engine has already moved on to it gaplessly.
+    void advance();
+
+    // The track next() will play. Known ahead of time (also in shuffle mode)
+    // so the audio engine can pre-roll it.
+    QString upcomingFile() const;
     bool shuffle() const;
     void setShuffle(bool enable);
     
     int count() const { return m_playlist.count(); }
     QStringList getPlaylist() const { return m_playlist; }
 
+    // Extended M3U with absolute paths (UTF-8, so .m3u8 is the natural name)
+    bool saveM3u(const QString& path) const;
+    // The audio files of an M3U/M3U8 playlist, or of a directory, without
+    // loading them into a playlist (and the analyzer)
+    static QStringList readPlaylist(const QString& path);
+    static bool isValidAudioFile(const QString& filePath);
+
 signals:
     void currentTrackChanged(const QString& filePath);
     void playlistChanged();
     void playbackStarted(const QString& filePath);
     void playbackFinished();
+    void upcomingTrackChanged(const QString& filePath);
 
 private:
     QStringList m_playlist;
     int m_currentIndex = -1;
     bool m_shuffle = false;
     QRandomGenerator m_random;
-    
-    bool isValidAudioFile(const QString& filePath) const;
+    QList<int> m_shuffleOrder;  // Rest of the current shuffle pass, front plays next
+    QString m_upcoming;
+
+    int upcomingIndex() const;
+    void refreshUpcoming(bool reshuffle = false);
 };
\ No newline at end of file
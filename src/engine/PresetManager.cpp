@@ -1,4 +1,6 @@
 #include "PresetManager.h"
+#include "../data/PresetCostIndex.h"
+#include "../data/SettingsManager.h"
 #include <QSettings>
 #include <QDebug>
 
@@ -7,10 +9,16 @@ PresetManager::PresetManager(QObject* parent) : QObject(parent) {
 }
 
 void PresetManager::setPresetDirectory(const QString& path) {
+    const SettingsManager& settings = SettingsManager::instance();
+    m_costLimitMs = settings.getPresetCostLimitMs();
+    m_excludeCostly = settings.getExcludeCostlyPresets();
+
     m_presetDirectory = path;
     scanPresets();
     validatePresetList();
+    chooseUpcoming();
     emit presetListChanged();
+    emit upcomingPresetChanged(upcomingPreset());
 }
 
 QString PresetManager::currentPreset() const {
@@ -23,15 +31,42 @@ QString PresetManager::currentPreset() const {
 QString PresetManager::nextPreset() {
     if (m_allPresets.isEmpty()) return QString();
     
-    int nextIndex = m_currentIndex + 1;
-    if (nextIndex >= m_allPresets.size()) nextIndex = 0;
-    
-    m_currentIndex = nextIndex;
+    m_currentIndex = m_upcomingIndex;
+    chooseUpcoming();
     QString preset = currentPreset();
     emit currentPresetChanged(preset);
+    emit upcomingPresetChanged(upcomingPreset());
     return preset;
 }
 
+QString PresetManager::upcomingPreset() const {
+    if (m_allPresets.isEmpty()) return QString();
+    return m_allPresets[m_upcomingIndex];
+}
+
+double PresetManager::selectionWeight(const QString& presetPath) const {
+    if (m_costLimitMs <= 0.0) return 1.0;
+    const std::optional<PresetCost> cost = PresetCostIndex::instance().lookup(presetPath);
+    if (!cost || cost->p95Ms <= m_costLimitMs) return 1.0;  // Unmeasured presets get the benefit of the doubt
+    return m_excludeCostly ? 0.0 : m_costLimitMs / cost->p95Ms;
+}
+
+void PresetManager::chooseUpcoming() {
+    // Decided once per step, so upcomingPreset() (what gets preloaded) is
+    // exactly what nextPreset() returns
+    const int count = m_allPresets.size();
+    m_upcomingIndex = count > 0 ? (m_currentIndex + 1) % count : 0;
+    for (int step = 1; step <= count; ++step) {
+        const int index = (m_currentIndex + step) % count;
+        const double weight = selectionWeight(m_allPresets[index]);
+        if (weight >= 1.0 || QRandomGenerator::global()->generateDouble() < weight) {
+            m_upcomingIndex = index;
+            return;
+        }
+    }
+    // Everything is over the limit: fall back to plain order
+}
+
 QString PresetManager::previousPreset() {
     if (m_allPresets.isEmpty()) return QString();
     
@@ -39,8 +74,10 @@ QString PresetManager::previousPreset() {
     if (prevIndex < 0) prevIndex = m_allPresets.size() - 1;
     
     m_currentIndex = prevIndex;
+    chooseUpcoming();
     QString preset = currentPreset();
     emit currentPresetChanged(preset);
+    emit upcomingPresetChanged(upcomingPreset());
     return preset;
 }
 
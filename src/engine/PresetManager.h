@@ -12,6 +12,8 @@ public:
     void setPresetDirectory(const QString& path);
     QString currentPreset() const;
     QString nextPreset();
+    // What nextPreset() is going to return, for preloading
+    QString upcomingPreset() const;
     QString previousPreset();
     QStringList getAllPresets() const;
     
@@ -30,6 +32,7 @@ public:
 
 signals:
     void currentPresetChanged(const QString& presetPath);
+    void upcomingPresetChanged(const QString& presetPath);
     void presetListChanged();
 
 private:
@@ -39,9 +42,16 @@ private:
     QStringList m_blacklist;
     QStringList m_quarantine;
     int m_currentIndex = 0;
+    int m_upcomingIndex = 0;
+    double m_costLimitMs = 0.0;     // From the settings, see selectionWeight()
+    bool m_excludeCostly = false;
     
     void loadLists();
     void saveLists();
     void scanPresets();
     void validatePresetList();
+    // Chance (0..1) that a preset is picked when its turn comes, from the
+    // measured cost in the PresetCostIndex
+    double selectionWeight(const QString& presetPath) const;
+    void chooseUpcoming();
 };
\ No newline at end of file
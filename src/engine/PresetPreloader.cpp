@@ -0,0 +1,134 @@
+#include "PresetPreloader.h"
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QDebug>
+#include <utility>
+
+void RenderStage::release(QSurface* surface) {
+    if (!context) return;
+    context->makeCurrent(surface);
+    engine.reset();
+    QOpenGLExtraFunctions* gl = context->extraFunctions();
+    gl->glDeleteFramebuffers(static_cast<GLsizei>(framebuffers.size()), framebuffers.data());
+    gl->glDeleteFramebuffers(1, &sceneFramebuffer);
+    gl->glDeleteFramebuffers(1, &recordFramebuffer);
+    gl->glDeleteQueries(static_cast<GLsizei>(timerQueries.size()), timerQueries.data());
+    framebuffers.fill(0);
+    sceneFramebuffer = 0;
+    recordFramebuffer = 0;
+    timerQueries.fill(0);
+    context->doneCurrent();
+    delete context;
+    context = nullptr;
+}
+
+void RenderStage::moveToThread(QThread* thread) {
+    context->moveToThread(thread);
+    if (engine) engine->moveToThread(thread);
+}
+
+PresetPreloader::PresetPreloader(QOpenGLContext* shareContext, QThread* consumer)
+    : m_consumer(consumer) {
+    // Contexts and surfaces are created on the GUI thread, then moved over
+    m_stage = std::make_unique<RenderStage>();
+    m_stage->context = new QOpenGLContext();
+    m_stage->context->setFormat(shareContext->format());
+    m_stage->context->setShareContext(shareContext);
+    if (!m_stage->context->create()) {
+        qWarning() << "❌ Could not create the preset preloader's GL context";
+    }
+    m_surface = new QOffscreenSurface();
+    m_surface->setFormat(m_stage->context->format());
+    m_surface->create();
+
+    m_thread.setObjectName("PresetPreload");
+    m_stage->moveToThread(&m_thread);
+    moveToThread(&m_thread);
+    m_thread.start(QThread::LowPriority);
+}
+
+PresetPreloader::~PresetPreloader() {
+    QMetaObject::invokeMethod(this, [this]() { shutdown(); }, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+    delete m_surface;
+}
+
+void PresetPreloader::shutdown() {
+    m_pendingPreset.clear();
+    if (m_stage) m_stage->release(m_surface);
+    m_stage.reset();
+}
+
+void PresetPreloader::request(const QString& presetPath, const QSize& size, const QSize& mesh, int fps) {
+    QMetaObject::invokeMethod(this, [this, presetPath, size, mesh, fps]() {
+        m_pendingPreset = presetPath;
+        m_pendingSize = size;
+        m_pendingMesh = mesh;
+        m_pendingFps = fps;
+        prepare();
+    }, Qt::QueuedConnection);
+}
+
+void PresetPreloader::adopt(RenderStage* stage) {
+    QMetaObject::invokeMethod(this, [this, stage]() {
+        if (m_stage) {
+            // Only one stage is ever standing by
+            stage->release(m_surface);
+            delete stage;
+            return;
+        }
+        m_stage.reset(stage);
+        prepare();
+    }, Qt::QueuedConnection);
+}
+
+void PresetPreloader::prepare() {
+    if (!m_stage || m_pendingPreset.isEmpty()) return;
+
+    const QString presetPath = std::exchange(m_pendingPreset, QString());
+    const QSize size = m_pendingSize.expandedTo(QSize(1, 1));
+    const QSize mesh = m_pendingMesh;
+    const int fps = m_pendingFps;
+    QElapsedTimer timer;
+    timer.start();
+
+    RenderStage& stage = *m_stage;
+    stage.context->makeCurrent(m_surface);
+    if (!stage.engine) stage.engine = std::make_unique<VizEngine>();
+
+    VizEngine& engine = *stage.engine;
+    if (engine.isInitialized()) {
+        // Match what the render thread uses now, so the swap costs nothing
+        if (stage.meshSize != mesh) engine.setMeshSize(mesh.width(), mesh.height());
+        if (stage.fps != fps) engine.setFPS(fps);
+        engine.loadPreset(presetPath);
+    } else if (!engine.initialize(presetPath, mesh.width(), mesh.height(), fps)) {
+        stage.context->doneCurrent();
+        return;
+    }
+    engine.resize(size.width(), size.height());
+    stage.engineSize = size;
+    stage.meshSize = mesh;
+    stage.fps = fps;
+
+    // Drivers defer part of shader compilation and linking to the first
+    // draw, so render one frame nobody sees and wait for it
+    {
+        QOpenGLFramebufferObject scratch(size, QOpenGLFramebufferObject::CombinedDepthStencil);
+        scratch.bind();
+        engine.renderFrame(scratch.handle());
+        scratch.release();
+        stage.context->extraFunctions()->glFinish();
+    }
+    stage.context->doneCurrent();
+    stage.preset = presetPath;
+
+    const qint64 prepareNs = timer.nsecsElapsed();
+    qDebug() << "⏩ Preloaded preset:" << QFileInfo(presetPath).fileName() << "in" << prepareNs / 1000000 << "ms";
+
+    m_stage->moveToThread(m_consumer);
+    emit prepared(m_stage.release());
+}
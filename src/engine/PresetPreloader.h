@@ -0,0 +1,85 @@
+#pragma once
+#include <QObject>
+#include <QThread>
+#include <QSize>
+#include <QString>
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <array>
+#include <memory>
+#include "VizEngine.h"
+
+// A projectM instance together with the GL context it was created in.
+// Container objects (VAOs, framebuffers) are not shared between contexts,
+// so an instance can only ever draw in its own context; stages therefore
+// move between threads as a whole, context included.
+struct RenderStage {
+    QOpenGLContext* context = nullptr;
+    std::unique_ptr<VizEngine> engine;
+    QString preset;                         // Preset the engine has loaded
+
+    QSize engineSize;                       // Window size projectM was last given
+    QSize meshSize;                         // Likewise the per-vertex mesh
+    int fps = 0;
+
+    // Framebuffers for the render targets, created in this context on demand
+    std::array<GLuint, 3> framebuffers{};
+    std::array<quint64, 3> attached{};      // Target serial attached to each
+    GLuint sceneFramebuffer = 0;            // For the scaled projectM scene
+    quint64 sceneAttached = 0;
+    GLuint recordFramebuffer = 0;           // For frames composed at the recording size
+    quint64 recordAttached = 0;
+
+    // GPU timer per render target, read back when the target comes round again
+    std::array<GLuint, 3> timerQueries{};
+    std::array<bool, 3> timerPending{};
+
+    // On the stage's thread: destroys the engine and framebuffers, then the
+    // context. surface only has to be compatible with the context.
+    void release(QSurface* surface);
+    // On the stage's thread, with the context not current anywhere
+    void moveToThread(QThread* thread);
+};
+
+// Prepares the preset that is likely to be shown next on a worker thread.
+//
+// The preloader owns a standby stage. For each request it loads the preset
+// into the standby engine (parsing the file and compiling its shaders) and
+// draws one throwaway frame so the driver finishes linking, then hands the
+// whole stage to the render thread. Switching to that preset is then a swap
+// of stages instead of a 100-400 ms load on the render path. The previous
+// stage comes back through adopt() and becomes the next standby.
+class PresetPreloader : public QObject {
+    Q_OBJECT
+public:
+    // GUI thread. consumer is the thread prepared stages are handed to.
+    PresetPreloader(QOpenGLContext* shareContext, QThread* consumer);
+    ~PresetPreloader();
+
+    QThread* workerThread() { return &m_thread; }
+
+    // Any thread: prepare presetPath at the given window size, mesh and
+    // frame rate as soon as the standby stage is free. A newer request
+    // replaces one that has not started yet.
+    void request(const QString& presetPath, const QSize& size, const QSize& mesh, int fps);
+    // Any thread: take a stage back. It must already live on workerThread().
+    void adopt(RenderStage* stage);
+
+signals:
+    // Preloader thread. The stage and its context already live on the
+    // consumer thread, and the receiver takes ownership.
+    void prepared(RenderStage* stage);
+
+private:
+    void prepare();
+    void shutdown();
+
+    QThread m_thread;
+    QThread* m_consumer;
+    QOffscreenSurface* m_surface;
+    std::unique_ptr<RenderStage> m_stage;  // Standby, while it is here
+    QString m_pendingPreset;
+    QSize m_pendingSize;
+    QSize m_pendingMesh;
+    int m_pendingFps = 60;
+};
@@ -0,0 +1,207 @@
+#include "PresetProfiler.h"
+#include "VizEngine.h"
+#include "PresetManager.h"
+#include "ShaderCache.h"
+#include "TrackDecoder.h"
+#include "../data/PresetCostIndex.h"
+#include "../data/SettingsManager.h"
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
+#include <QSurfaceFormat>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+constexpr int kSampleRate = 48000;
+constexpr int kChannels = 2;
+
+// Sorted frame times in, milliseconds out (nearest rank)
+double percentileMs(const std::vector<qint64>& sorted, double p) {
+    const size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1] / 1e6;
+}
+}
+
+PresetProfiler::PresetProfiler(const Options& options) : m_options(options) {
+    m_options.frames = std::max(1, m_options.frames);
+    m_options.fps = std::max(1, m_options.fps);
+    m_options.size = m_options.size.expandedTo(QSize(16, 16));
+}
+
+int PresetProfiler::run() {
+    PresetManager presets;
+    presets.setPresetDirectory(m_options.presetDirectory);
+    const QStringList paths = presets.getAllPresets();
+    if (paths.isEmpty()) {
+        qWarning() << "❌ No presets found in" << m_options.presetDirectory;
+        return 1;
+    }
+    if (!prepareAudio()) return 1;
+
+    // projectM 4 needs GL 3.3 core, which llvmpipe provides
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    QOpenGLContext context;
+    context.setFormat(format);
+    QOffscreenSurface surface;
+    if (!context.create()) {
+        qWarning() << "❌ Could not create an OpenGL 3.3 context";
+        return 1;
+    }
+    surface.setFormat(context.format());
+    surface.create();
+    if (!context.makeCurrent(&surface)) {
+        qWarning() << "❌ Could not make the OpenGL context current";
+        return 1;
+    }
+
+    QOpenGLExtraFunctions* gl = context.extraFunctions();
+    const QString renderer = QString::fromLatin1(reinterpret_cast<const char*>(gl->glGetString(GL_RENDERER)));
+    qInfo().noquote() << "🔬 Profiling" << paths.size() << "presets at"
+                      << QString("%1x%2").arg(m_options.size.width()).arg(m_options.size.height())
+                      << "for" << m_options.frames << "frames on" << renderer;
+
+    int failed = 0;
+    {
+        QOpenGLFramebufferObject target(m_options.size, QOpenGLFramebufferObject::CombinedDepthStencil);
+        const SettingsManager& settings = SettingsManager::instance();
+        VizEngine engine;
+        if (!engine.initialize(paths.first(), settings.getMeshX(), settings.getMeshY(), m_options.fps)) {
+            return 1;
+        }
+        engine.resize(m_options.size.width(), m_options.size.height());
+
+        PresetCostIndex& index = PresetCostIndex::instance();
+        for (const QString& path : paths) {
+            PresetCost cost;
+            cost.renderer = renderer;
+            if (!profile(engine, path, target.handle(), cost)) {
+                qWarning() << "⚠️ Could not load preset:" << QFileInfo(path).fileName();
+                ++failed;
+                continue;
+            }
+            index.store(path, cost);
+            qInfo().noquote() << QString("  %1  mean %2 ms  p95 %3 ms  p99 %4 ms  load %5 ms  shaders %6")
+                                     .arg(QFileInfo(path).fileName())
+                                     .arg(cost.meanMs, 0, 'f', 2)
+                                     .arg(cost.p95Ms, 0, 'f', 2)
+                                     .arg(cost.p99Ms, 0, 'f', 2)
+                                     .arg(cost.loadMs, 0, 'f', 1)
+                                     .arg(cost.shaderMs < 0 ? QString("n/a") : QString::number(cost.shaderMs, 'f', 1) + " ms");
+        }
+        // The engine owns GL objects, so it goes while the context is current
+    }
+    context.doneCurrent();
+
+    PresetCostIndex& index = PresetCostIndex::instance();
+    if (!index.save()) {
+        qWarning() << "❌ Could not write" << index.indexPath();
+        return 1;
+    }
+    qInfo().noquote() << QString("📊 Profiled %1 presets (%2 failed), index: %3")
+                             .arg(paths.size() - failed).arg(failed).arg(index.indexPath());
+    return failed == paths.size() ? 1 : 0;
+}
+
+bool PresetProfiler::profile(VizEngine& engine, const QString& presetPath, unsigned framebuffer, PresetCost& cost) {
+    QOpenGLExtraFunctions* gl = QOpenGLContext::currentContext()->extraFunctions();
+    const size_t framesPerVideoFrame = kSampleRate / m_options.fps;
+    const float* audio = m_pcm.data();
+
+    // Loading covers the first frame: drivers (and projectM) defer part of
+    // the shader work until something is drawn
+    const qint64 buildBefore = ShaderCache::instance().buildNs();
+    QElapsedTimer timer;
+    timer.start();
+    engine.loadPreset(presetPath);
+    if (engine.currentPreset() != presetPath) return false;
+    engine.addPcm(audio, framesPerVideoFrame);
+    engine.renderFrame(framebuffer);
+    gl->glFinish();
+    cost.loadMs = timer.nsecsElapsed() / 1e6;
+#ifdef VIBESYNC_PROJECTM_GL_LOADER
+    cost.shaderMs = (ShaderCache::instance().buildNs() - buildBefore) / 1e6;
+#else
+    Q_UNUSED(buildBefore);
+#endif
+
+    std::vector<qint64> times;
+    times.reserve(m_options.frames);
+    for (int frame = 1; frame <= m_options.frames; ++frame) {
+        engine.addPcm(audio + frame * framesPerVideoFrame * kChannels, framesPerVideoFrame);
+        timer.restart();
+        engine.renderFrame(framebuffer);
+        gl->glFinish();
+        times.push_back(timer.nsecsElapsed());
+    }
+
+    qint64 total = 0;
+    for (qint64 ns : times) total += ns;
+    std::sort(times.begin(), times.end());
+    cost.meanMs = total / 1e6 / times.size();
+    cost.p95Ms = percentileMs(times, 0.95);
+    cost.p99Ms = percentileMs(times, 0.99);
+    cost.frames = m_options.frames;
+    cost.width = m_options.size.width();
+    cost.height = m_options.size.height();
+    return true;
+}
+
+bool PresetProfiler::prepareAudio() {
+    // One video frame of audio for the load frame, then one per profiled frame
+    const size_t frames = static_cast<size_t>(m_options.frames + 1) * (kSampleRate / m_options.fps);
+    if (m_options.audioFile.isEmpty()) {
+        synthesizeAudio(frames);
+        return true;
+    }
+    return decodeAudio(frames);
+}
+
+bool PresetProfiler::decodeAudio(size_t frames) {
+    QString error;
+    if (!TrackDecoder::decodeFile(m_options.audioFile, m_pcm, frames, &error)) {
+        qWarning() << "❌ Could not decode" << m_options.audioFile << ":" << error;
+        return false;
+    }
+
+    // Loop a short file to cover the whole run
+    const size_t decoded = std::min(m_pcm.size(), frames * kChannels);
+    m_pcm.resize(frames * kChannels);
+    for (size_t i = decoded; i < m_pcm.size(); ++i) m_pcm[i] = m_pcm[i % decoded];
+    return true;
+}
+
+void PresetProfiler::synthesizeAudio(size_t frames) {
+    // A 120 BPM kick, noise hats on the off-beats and a slow sine sweep:
+    // enough to drive the bass/mid/treble inputs presets react to, and the
+    // same on every run
+    constexpr double kTwoPi = 2.0 * 3.14159265358979323846;
+    const size_t beatFrames = kSampleRate / 2;
+    std::minstd_rand noise(1);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+
+    m_pcm.resize(frames * kChannels);
+    double sweepPhase = 0.0;
+    for (size_t i = 0; i < frames; ++i) {
+        const double t = static_cast<double>(i) / kSampleRate;
+        const double beatT = static_cast<double>(i % beatFrames) / kSampleRate;
+        const double offBeatT = static_cast<double>((i + beatFrames / 2) % beatFrames) / kSampleRate;
+
+        const double kick = std::sin(kTwoPi * 55.0 * beatT) * std::exp(-beatT * 18.0);
+        const double hat = uniform(noise) * std::exp(-offBeatT * 60.0) * 0.25;
+        const double sweepHz = 200.0 + 1800.0 * (0.5 + 0.5 * std::sin(kTwoPi * t / 8.0));
+        sweepPhase += kTwoPi * sweepHz / kSampleRate;
+        const double sweep = std::sin(sweepPhase) * 0.2;
+
+        const float sample = static_cast<float>(std::clamp(0.6 * kick + hat + sweep, -1.0, 1.0));
+        m_pcm[i * kChannels] = sample;
+        m_pcm[i * kChannels + 1] = sample;
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <QSize>
+#include <QString>
+#include <vector>
+
+class VizEngine;
+struct PresetCost;
+
+// Headless measurement of what each preset costs to render.
+//
+// Renders every preset PresetManager finds in a directory for a fixed
+// number of frames into an offscreen framebuffer, waiting for each frame to
+// finish, and records the results in the PresetCostIndex. Audio is either a
+// synthetic beat-and-sweep signal or the start of a given file, so runs are
+// repeatable. Nothing needs a GPU: on Mesa llvmpipe the numbers are CPU
+// time, which is still good for ranking presets against each other.
+class PresetProfiler {
+public:
+    struct Options {
+        QString presetDirectory;
+        QString audioFile;          // Empty: synthetic audio
+        int frames = 300;
+        QSize size{1280, 720};
+        int fps = 60;
+    };
+
+    explicit PresetProfiler(const Options& options);
+
+    // Needs a QGuiApplication. Returns the process exit code.
+    int run();
+
+private:
+    bool prepareAudio();
+    bool decodeAudio(size_t frames);
+    void synthesizeAudio(size_t frames);
+    bool profile(VizEngine& engine, const QString& presetPath, unsigned framebuffer, PresetCost& cost);
+
+    Options m_options;
+    std::vector<float> m_pcm;       // Interleaved stereo, 48 kHz
+};
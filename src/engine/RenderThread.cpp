@@ -0,0 +1,520 @@
+#include "RenderThread.h"
+#include "VizEngine.h"
+#include "TextEngine.h"
+#include "SpectrumAnalyzer.h"
+#include "../core/PluginManager.h"
+#include "../core/PerformanceManager.h"
+#include <QCoreApplication>
+#include <QOpenGLPaintDevice>
+#include <QPainter>
+#include <QFileInfo>
+#include <QDebug>
+#include <algorithm>
+#include <chrono>
+
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+
+namespace {
+qint64 steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Color texture plus depth/stencil renderbuffer, both shared objects
+void allocateStorage(QOpenGLExtraFunctions* gl, GLuint& texture, GLuint& depthStencil, const QSize& size) {
+    gl->glDeleteTextures(1, &texture);
+    gl->glDeleteRenderbuffers(1, &depthStencil);
+
+    gl->glGenTextures(1, &texture);
+    gl->glBindTexture(GL_TEXTURE_2D, texture);
+    gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.width(), size.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    gl->glBindTexture(GL_TEXTURE_2D, 0);
+
+    gl->glGenRenderbuffers(1, &depthStencil);
+    gl->glBindRenderbuffer(GL_RENDERBUFFER, depthStencil);
+    gl->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size.width(), size.height());
+    gl->glBindRenderbuffer(GL_RENDERBUFFER, 0);
+}
+
+void attachStorage(QOpenGLExtraFunctions* gl, GLuint texture, GLuint depthStencil) {
+    gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    gl->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthStencil);
+}
+
+// QPainter may rebind the default framebuffer (e.g. after updating its glyph
+// cache); this puts the render target back
+class TargetPaintDevice : public QOpenGLPaintDevice {
+public:
+    TargetPaintDevice(const QSize& size, QOpenGLExtraFunctions* gl, GLuint framebuffer)
+        : QOpenGLPaintDevice(size), m_gl(gl), m_framebuffer(framebuffer) {}
+
+    void ensureActiveTarget() override { m_gl->glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer); }
+
+private:
+    QOpenGLExtraFunctions* m_gl;
+    GLuint m_framebuffer;
+};
+}
+
+RenderThread::RenderThread(QOpenGLContext* shareContext, TextEngine* textEngine)
+    : m_textEngine(textEngine),
+      m_readback([this](VideoFramePtr frame) { emit frameCaptured(frame); }) {
+    // Context and offscreen surface have to be created on the GUI thread
+    m_active = std::make_unique<RenderStage>();
+    m_active->context = new QOpenGLContext();
+    m_active->context->setFormat(shareContext->format());
+    m_active->context->setShareContext(shareContext);
+    if (!m_active->context->create()) {
+        qWarning() << "❌ Could not create the render thread's GL context";
+    }
+    m_surface = new QOffscreenSurface();
+    m_surface->setFormat(m_active->context->format());
+    m_surface->create();
+
+    m_thread.setObjectName("Render");
+    m_active->moveToThread(&m_thread);
+    moveToThread(&m_thread);
+
+    // Prepared stages arrive queued, already living on the render thread
+    m_preloader = std::make_unique<PresetPreloader>(shareContext, &m_thread);
+    connect(m_preloader.get(), &PresetPreloader::prepared, this, &RenderThread::onPrepared);
+
+    m_thread.start(QThread::HighPriority);
+    QMetaObject::invokeMethod(this, [this]() { initialize(); }, Qt::BlockingQueuedConnection);
+}
+
+RenderThread::~RenderThread() {
+    // GL resources must go with their context current, on its thread
+    QMetaObject::invokeMethod(this, [this]() { shutdown(); }, Qt::BlockingQueuedConnection);
+
+    // A stage the preloader finishes meanwhile is still queued to us; flush
+    // it so onPrepared() can release it
+    m_preloader.reset();
+    QMetaObject::invokeMethod(this, []() {}, Qt::BlockingQueuedConnection);
+
+    m_thread.quit();
+    m_thread.wait();
+    delete m_surface;
+}
+
+void RenderThread::initialize() {
+    m_active->context->makeCurrent(m_surface);
+    m_active->engine = std::make_unique<VizEngine>();
+
+    int index = 0;
+    m_targets.forEachSlot([&index](Target& target) { target.index = index++; });
+    m_pluginThrottle.start();
+
+    // GPU frame times need timer queries; without them CPU time stands in
+    QOpenGLContext* context = m_active->context;
+    m_getQueryObjectui64v = reinterpret_cast<decltype(m_getQueryObjectui64v)>(
+        context->getProcAddress("glGetQueryObjectui64v"));
+    m_gpuTimers = !context->isOpenGLES() && m_getQueryObjectui64v
+                  && (context->format().version() >= qMakePair(3, 3) || context->hasExtension("GL_ARB_timer_query"));
+}
+
+void RenderThread::shutdown() {
+    m_closing = true;
+    if (m_standby) m_standby->release(m_surface);
+    m_standby.reset();
+
+    m_active->context->makeCurrent(m_surface);
+    QOpenGLExtraFunctions* gl = m_active->context->extraFunctions();
+    m_targets.forEachSlot([gl](Target& target) {
+        if (target.fence) gl->glDeleteSync(target.fence);
+        if (target.released) gl->glDeleteSync(target.released);
+        gl->glDeleteTextures(1, &target.texture);
+        gl->glDeleteRenderbuffers(1, &target.depthStencil);
+        target = Target{};
+    });
+    releaseOffscreen(m_scene);
+    releaseOffscreen(m_record);
+    m_readback.release(gl);
+    m_active->release(m_surface);
+    m_active.reset();
+}
+
+void RenderThread::loadPreset(const QString& presetPath) {
+    const qint64 requestedNs = steadyNowNs();
+    QMetaObject::invokeMethod(this, [this, presetPath, requestedNs]() {
+        switchPreset(presetPath, requestedNs);
+    }, Qt::QueuedConnection);
+}
+
+void RenderThread::preloadPreset(const QString& presetPath) {
+    QMetaObject::invokeMethod(this, [this, presetPath]() {
+        m_preloadTarget = presetPath;
+        if (m_standby && m_standby->preset == presetPath) return;
+
+        // A standby prepared for another preset goes back to be reused
+        recycle(std::move(m_standby));
+        m_preloader->request(presetPath, m_scaler.apply(m_outputSize), m_meshGovernor.meshSize(), m_fps);
+    }, Qt::QueuedConnection);
+}
+
+void RenderThread::switchPreset(const QString& presetPath, qint64 requestedNs) {
+    const bool preloaded = m_standby && m_standby->preset == presetPath;
+    if (preloaded) {
+        // The prepared stage takes over and the old one becomes the standby
+        std::swap(m_active, m_standby);
+        recycle(std::move(m_standby));
+    } else {
+        // renderFrame() sizes the engine to the current render scale
+        m_active->context->makeCurrent(m_surface);
+        VizEngine& engine = *m_active->engine;
+        if (engine.isInitialized()) {
+            engine.loadPreset(presetPath);
+        } else {
+            const QSize mesh = m_meshGovernor.meshSize();
+            if (engine.initialize(presetPath, mesh.width(), mesh.height(), m_fps)) {
+                m_active->meshSize = mesh;
+                m_active->fps = m_fps;
+            }
+        }
+        m_active->preset = engine.currentPreset();
+        if (m_active->preset != presetPath) return;
+    }
+
+    m_switch = {presetPath, requestedNs, preloaded};
+    emit presetLoaded(presetPath);
+}
+
+void RenderThread::onPrepared(RenderStage* stage) {
+    std::unique_ptr<RenderStage> prepared(stage);
+    if (m_closing || prepared->preset != m_preloadTarget) {
+        // Outdated by a newer prediction (or we are going away)
+        recycle(std::move(prepared));
+        return;
+    }
+    recycle(std::move(m_standby));
+    m_standby = std::move(prepared);
+}
+
+void RenderThread::recycle(std::unique_ptr<RenderStage> stage) {
+    if (!stage) return;
+    if (m_closing) {
+        stage->release(m_surface);
+        return;
+    }
+    if (QOpenGLContext::currentContext() == stage->context) {
+        stage->context->doneCurrent();
+    }
+    stage->moveToThread(m_preloader->workerThread());
+    m_preloader->adopt(stage.release());
+}
+
+void RenderThread::resize(const QSize& pixelSize, qreal devicePixelRatio) {
+    QMetaObject::invokeMethod(this, [this, pixelSize, devicePixelRatio]() {
+        m_size = pixelSize.expandedTo(QSize(1, 1));
+        m_devicePixelRatio = devicePixelRatio;
+    }, Qt::QueuedConnection);
+}
+
+void RenderThread::requestFrame(const FrameScheduler::Frame& frame, const QSize& captureSize, int heldFrames) {
+    Request request;
+    request.frame = frame;
+    request.captureSize = captureSize;
+    request.heldFrames = heldFrames;
+    m_request.store(request);
+
+    // Coalesce: one queued render at a time, always of the newest request
+    if (!m_requestPosted.exchange(true, std::memory_order_acq_rel)) {
+        QMetaObject::invokeMethod(this, [this]() { renderFrame(); }, Qt::QueuedConnection);
+    }
+}
+
+void RenderThread::renderFrame() {
+    m_requestPosted.store(false, std::memory_order_release);
+    const Request request = m_request.load();
+    const qint64 start = steadyNowNs();
+
+    m_active->context->makeCurrent(m_surface);
+    QOpenGLExtraFunctions* gl = m_active->context->extraFunctions();
+    m_readback.collect(gl, false);
+
+    // The back target is ours alone, so it can be (re)created at will
+    Target& target = m_targets.back();
+    const GLuint framebuffer = bindTarget(target);
+    const qint64 gpuNs = restartGpuTimer(target.index);
+
+    // While recording, the frame is composed at the recording size and the
+    // window gets a scaled copy; otherwise the target is the output
+    RenderStage& stage = *m_active;
+    const bool capture = request.captureSize.isValid();
+    const QSize outputSize = capture ? request.captureSize : m_size;
+    m_outputSize = outputSize;
+    GLuint output = framebuffer;
+    if (capture) {
+        output = bindOffscreen(m_record, stage.recordFramebuffer, stage.recordAttached, outputSize);
+    } else {
+        releaseOffscreen(m_record);
+    }
+
+    // projectM draws at the scaled size, straight into the output at 1.0
+    m_scaler.setBudget(request.frame.budgetNs);
+    m_meshGovernor.setBudget(request.frame.budgetNs);
+    const QSize sceneSize = m_scaler.apply(outputSize);
+    GLuint sceneFramebuffer = output;
+    if (sceneSize != outputSize) {
+        sceneFramebuffer = bindOffscreen(m_scene, stage.sceneFramebuffer, stage.sceneAttached, sceneSize);
+    } else {
+        releaseOffscreen(m_scene);
+        gl->glBindFramebuffer(GL_FRAMEBUFFER, output);
+    }
+    gl->glViewport(0, 0, sceneSize.width(), sceneSize.height());
+    gl->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    VizEngine& engine = *stage.engine;
+    const QSize mesh = m_meshGovernor.meshSize();
+    if (engine.isInitialized()) {
+        if (stage.engineSize != sceneSize) {
+            engine.resize(sceneSize.width(), sceneSize.height());
+            stage.engineSize = sceneSize;
+        }
+        if (stage.meshSize != mesh) {
+            engine.setMeshSize(mesh.width(), mesh.height());
+            stage.meshSize = mesh;
+        }
+        if (stage.fps != m_fps) {
+            engine.setFPS(m_fps);
+            stage.fps = m_fps;
+        }
+    }
+    engine.consumeAudio(request.frame.streamFrame);
+    const qint64 warpStart = steadyNowNs();
+    engine.renderFrame(sceneFramebuffer);
+    const qint64 warpNs = steadyNowNs() - warpStart;
+
+    if (sceneFramebuffer != output) {
+        // Bilinear upscale into the full-size output
+        gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFramebuffer);
+        gl->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, output);
+        gl->glBlitFramebuffer(0, 0, sceneSize.width(), sceneSize.height(),
+                              0, 0, outputSize.width(), outputSize.height(), GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        gl->glBindFramebuffer(GL_FRAMEBUFFER, output);
+        gl->glViewport(0, 0, outputSize.width(), outputSize.height());
+    }
+
+    // One shared analysis frame per rendered frame for every consumer
+    const AnalysisFrame& analysis = SpectrumAnalyzer::instance().latest();
+    drawOverlay(analysis, output, outputSize);
+    publishAnalysis(analysis);
+
+    if (capture) {
+        m_readback.reservePool(request.heldFrames);
+        m_readback.capture(gl, output, outputSize, request.frame);
+        gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, output);
+        gl->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+        gl->glBlitFramebuffer(0, 0, outputSize.width(), outputSize.height(),
+                              0, 0, m_size.width(), m_size.height(), GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    }
+    if (m_gpuTimers) gl->glEndQuery(GL_TIME_ELAPSED);
+    gl->glBindFramebuffer(GL_FRAMEBUFFER, m_active->context->defaultFramebufferObject());
+
+    // The widget waits on this fence (on the GPU) before sampling the texture
+    target.fence = gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    gl->glFlush();
+    m_targets.publish();
+    reportSwitch();
+
+    const qint64 renderNs = steadyNowNs() - start;
+    adaptQuality(m_gpuTimers ? gpuNs : renderNs, warpNs);
+    emit frameReady(renderNs);
+}
+
+GLuint RenderThread::bindTarget(Target& target) {
+    RenderStage& stage = *m_active;
+    QOpenGLExtraFunctions* gl = stage.context->extraFunctions();
+
+    if (target.fence) {
+        gl->glDeleteSync(target.fence);
+        target.fence = nullptr;
+    }
+    // The widget may still be blitting this texture from when it was in front
+    if (target.released) {
+        gl->glWaitSync(target.released, 0, GL_TIMEOUT_IGNORED);
+        gl->glDeleteSync(target.released);
+        target.released = nullptr;
+    }
+    if (!target.texture || target.size != m_size) {
+        allocateStorage(gl, target.texture, target.depthStencil, m_size);
+        target.size = m_size;
+        target.serial = ++m_targetSerial;
+    }
+
+    // Framebuffers are per context, so each stage keeps its own set and
+    // re-attaches whenever a target's storage changed
+    GLuint& framebuffer = stage.framebuffers[target.index];
+    if (!framebuffer) gl->glGenFramebuffers(1, &framebuffer);
+    gl->glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    if (stage.attached[target.index] != target.serial) {
+        attachStorage(gl, target.texture, target.depthStencil);
+        stage.attached[target.index] = target.serial;
+    }
+    return framebuffer;
+}
+
+GLuint RenderThread::bindOffscreen(Offscreen& storage, GLuint& framebuffer, quint64& attached, const QSize& size) {
+    QOpenGLExtraFunctions* gl = m_active->context->extraFunctions();
+
+    if (!storage.texture || storage.size != size) {
+        allocateStorage(gl, storage.texture, storage.depthStencil, size);
+        storage.size = size;
+        storage.serial = ++m_targetSerial;
+    }
+    if (!framebuffer) gl->glGenFramebuffers(1, &framebuffer);
+    gl->glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    if (attached != storage.serial) {
+        attachStorage(gl, storage.texture, storage.depthStencil);
+        attached = storage.serial;
+    }
+    return framebuffer;
+}
+
+void RenderThread::releaseOffscreen(Offscreen& storage) {
+    if (!storage.texture) return;
+    QOpenGLExtraFunctions* gl = m_active->context->extraFunctions();
+    gl->glDeleteTextures(1, &storage.texture);
+    gl->glDeleteRenderbuffers(1, &storage.depthStencil);
+    storage = Offscreen{};
+}
+
+qint64 RenderThread::restartGpuTimer(int index) {
+    // Each target's timer is read when the target comes round again, two
+    // frames later, by which time the result is normally available
+    if (!m_gpuTimers) return -1;
+
+    RenderStage& stage = *m_active;
+    QOpenGLExtraFunctions* gl = stage.context->extraFunctions();
+    GLuint& query = stage.timerQueries[index];
+    qint64 elapsedNs = -1;
+    if (!query) {
+        gl->glGenQueries(1, &query);
+    } else if (stage.timerPending[index]) {
+        GLuint available = 0;
+        gl->glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            quint64 result = 0;
+            m_getQueryObjectui64v(query, GL_QUERY_RESULT, &result);
+            elapsedNs = static_cast<qint64>(result);
+        }
+    }
+    gl->glBeginQuery(GL_TIME_ELAPSED, query);
+    stage.timerPending[index] = true;
+    return elapsedNs;
+}
+
+void RenderThread::adaptQuality(qint64 frameNs, qint64 warpNs) {
+    // Whichever knob moves, the other one's samples are stale
+    const qint64 nowNs = steadyNowNs();
+    if (m_meshGovernor.addSample(warpNs, nowNs)) {
+        const QSize mesh = m_meshGovernor.meshSize();
+        qDebug() << "🕸️ Mesh governor ->" << mesh.width() << "x" << mesh.height()
+                 << "(warp" << warpNs / 1000 << "us)";
+        m_scaler.resetWindow();
+    }
+    if (frameNs >= 0 && m_scaler.addSample(frameNs, nowNs)) {
+        const QSize size = m_scaler.apply(m_size);
+        qDebug() << "📐 Render scale" << m_scaler.scale() << "->" << size.width() << "x" << size.height();
+        m_meshGovernor.resetWindow();
+        emit renderScaleChanged(m_scaler.scale());
+    }
+}
+
+void RenderThread::setScaleRange(double minScale, double maxScale) {
+    QMetaObject::invokeMethod(this, [this, minScale, maxScale]() {
+        m_scaler.setRange(minScale, maxScale);
+        emit renderScaleChanged(m_scaler.scale());
+    }, Qt::QueuedConnection);
+}
+
+void RenderThread::setMeshSize(const QSize& mesh) {
+    QMetaObject::invokeMethod(this, [this, mesh]() {
+        // renderFrame() hands the new size to projectM
+        m_meshGovernor.setMaximum(mesh);
+    }, Qt::QueuedConnection);
+}
+
+void RenderThread::setAdaptiveMesh(bool enabled) {
+    QMetaObject::invokeMethod(this, [this, enabled]() {
+        m_meshGovernor.setEnabled(enabled);
+    }, Qt::QueuedConnection);
+}
+
+void RenderThread::setFps(int fps) {
+    QMetaObject::invokeMethod(this, [this, fps]() {
+        m_fps = std::max(1, fps);
+    }, Qt::QueuedConnection);
+}
+
+void RenderThread::drawOverlay(const AnalysisFrame& analysis, GLuint framebuffer, const QSize& size) {
+    m_textEngine->setAudioLevel(std::max(analysis.rms[0], analysis.rms[1]) * 2.0f);
+
+    const BeatDetector& beats = SpectrumAnalyzer::instance().beats();
+    m_textEngine->setBeatPhase(static_cast<float>(beats.beatPhase()), beats.isLocked());
+
+    // Text is laid out in logical pixels, like the widget it ends up in. A
+    // recording gets the window's layout, scaled to its height.
+    const qreal devicePixelRatio = m_devicePixelRatio * size.height() / m_size.height();
+    TargetPaintDevice device(size, m_active->context->extraFunctions(), framebuffer);
+    device.setDevicePixelRatio(devicePixelRatio);
+    QPainter painter(&device);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+    m_textEngine->render(&painter, (QSizeF(size) / devicePixelRatio).toSize());
+    painter.end();
+}
+
+void RenderThread::publishAnalysis(const AnalysisFrame& analysis) {
+    // The plugin bus is synchronous and JSON-based, so cap it at ~20 Hz and
+    // run the handlers on the GUI thread, off the render path
+    if (analysis.sequence == m_lastPublishedAnalysis || m_pluginThrottle.elapsed() < 50) return;
+
+    m_lastPublishedAnalysis = analysis.sequence;
+    m_pluginThrottle.restart();
+    QMetaObject::invokeMethod(QCoreApplication::instance(), [json = SpectrumAnalyzer::toJson(analysis)]() {
+        PluginEventSystem::instance().triggerAudioEvent(json);
+    }, Qt::QueuedConnection);
+}
+
+void RenderThread::reportSwitch() {
+    if (m_switch.presetPath.isEmpty()) return;
+
+    // From the request to the first published frame that shows the preset
+    const QString presetPath = m_switch.presetPath;
+    const int latencyMs = static_cast<int>((steadyNowNs() - m_switch.requestedNs) / 1000000);
+    qDebug() << "🔀 Preset switch:" << QFileInfo(presetPath).fileName() << "in" << latencyMs << "ms"
+             << (m_switch.preloaded ? "(preloaded)" : "(loaded on demand)");
+    QMetaObject::invokeMethod(QCoreApplication::instance(), [presetPath, latencyMs]() {
+        PerformanceMonitor::instance().recordPresetMetrics(presetPath, latencyMs);
+    }, Qt::QueuedConnection);
+    m_switch = PendingSwitch{};
+}
+
+GLuint RenderThread::latestTexture(QSize* size) {
+    if (m_targets.update()) {
+        const Target& front = m_targets.front();
+        if (front.fence) {
+            QOpenGLContext::currentContext()->extraFunctions()->glWaitSync(front.fence, 0, GL_TIMEOUT_IGNORED);
+        }
+    }
+    const Target& front = m_targets.front();
+    if (size) *size = front.size;
+    return front.texture;
+}
+
+void RenderThread::releaseTexture() {
+    Target& front = m_targets.front();
+    QOpenGLExtraFunctions* gl = QOpenGLContext::currentContext()->extraFunctions();
+    // Only the last blit of a frame shown several times matters
+    if (front.released) gl->glDeleteSync(front.released);
+    front.released = gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Another context can only wait on a fence that has been flushed
+    gl->glFlush();
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include <QObject>
+#include <QThread>
+#include <QSize>
+#include <QElapsedTimer>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOffscreenSurface>
+#include <atomic>
+#include <memory>
+#include "../core/SeqLock.h"
+#include "../core/TripleBuffer.h"
+#include "FrameScheduler.h"
+#include "ResolutionScaler.h"
+#include "MeshGovernor.h"
+#include "FrameReadback.h"
+#include "PresetPreloader.h"
+
+class TextEngine;
+struct AnalysisFrame;
+
+// Renders projectM and the text overlay on a dedicated thread.
+//
+// The thread renders each frame into one of three textures shared with the
+// widget's context. Finished textures are handed over through a triple
+// buffer together with a GPU fence, so the widget only ever blits the latest
+// complete frame and nothing on the GUI thread (dialogs, playlist refreshes,
+// tag reads) can stall the visuals.
+//
+// Requests coalesce: if the thread is still busy when the next frame is
+// requested, only the newest request is rendered.
+//
+// The preset expected next is prepared ahead of time by a PresetPreloader;
+// when it is requested, the prepared stage simply takes over.
+//
+// projectM renders at a resolution chosen by a ResolutionScaler from the
+// measured GPU time per frame, into a scene texture that is upscaled
+// bilinearly into the output. The text overlay is always drawn at the full
+// output resolution.
+//
+// While recording, frames are composed at the recording size (projectM and
+// overlay alike) and the window gets a scaled copy. Frames for the recorder
+// are read back asynchronously through a ring of pixel buffer objects and
+// delivered a frame or two later.
+//
+// Before the resolution drops, a MeshGovernor coarsens projectM's per-vertex
+// mesh when the CPU time of its render call (mostly the warp equations)
+// takes too much of the frame budget.
+class RenderThread : public QObject {
+    Q_OBJECT
+public:
+    // GUI thread, with shareContext current or at least created
+    RenderThread(QOpenGLContext* shareContext, TextEngine* textEngine);
+    ~RenderThread();
+
+    // GUI thread; all of these are carried out on the render thread
+    void loadPreset(const QString& presetPath);
+    void preloadPreset(const QString& presetPath);
+    void resize(const QSize& pixelSize, qreal devicePixelRatio);
+    // Bounds for the per-axis render scale, 1.0 = native
+    void setScaleRange(double minScale, double maxScale);
+    // projectM's per-vertex mesh; with adaptive mesh on, the upper bound
+    void setMeshSize(const QSize& mesh);
+    void setAdaptiveMesh(bool enabled);
+    void setFps(int fps);
+    // With a valid captureSize the frame is also rendered at that size and
+    // delivered through frameCaptured(), whose receivers may hold on to up to
+    // heldFrames captured frames at once
+    void requestFrame(const FrameScheduler::Frame& frame, const QSize& captureSize = QSize(), int heldFrames = 0);
+
+    // GUI thread, with the widget's context current: the most recently
+    // finished frame. Returns 0 until the first frame is ready.
+    GLuint latestTexture(QSize* size = nullptr);
+    // GUI thread, after the last draw that samples latestTexture(): fences
+    // those draws so the render thread waits for them before reusing it
+    void releaseTexture();
+
+signals:
+    void frameReady(qint64 renderNs);
+    void frameCaptured(const VideoFramePtr& frame);   // Requested with a captureSize
+    void presetLoaded(const QString& presetPath);
+    void renderScaleChanged(double scale);
+
+private:
+    struct Request {
+        FrameScheduler::Frame frame;
+        QSize captureSize;
+        int heldFrames = 0;
+    };
+
+    // Textures and renderbuffers are shared by every context in the group;
+    // each stage attaches them to framebuffers of its own
+    struct Target {
+        GLuint texture = 0;
+        GLuint depthStencil = 0;
+        QSize size;
+        GLsync fence = nullptr;     // Rendering done; the widget waits on it
+        GLsync released = nullptr;  // Widget done sampling; the render thread waits on it
+        int index = 0;
+        quint64 serial = 0;     // Changes whenever the storage is recreated
+    };
+
+    // Texture plus depth/stencil renderbuffer for intermediate passes.
+    // Shared like the targets; each stage has its own framebuffer for it.
+    struct Offscreen {
+        GLuint texture = 0;
+        GLuint depthStencil = 0;
+        QSize size;
+        quint64 serial = 0;
+    };
+
+    // A preset switch, reported once its first frame is published
+    struct PendingSwitch {
+        QString presetPath;
+        qint64 requestedNs = 0;
+        bool preloaded = false;
+    };
+
+    // Render thread
+    void initialize();
+    void shutdown();
+    void switchPreset(const QString& presetPath, qint64 requestedNs);
+    void onPrepared(RenderStage* stage);
+    void recycle(std::unique_ptr<RenderStage> stage);
+    void renderFrame();
+    GLuint bindTarget(Target& target);
+    GLuint bindOffscreen(Offscreen& storage, GLuint& framebuffer, quint64& attached, const QSize& size);
+    void releaseOffscreen(Offscreen& storage);
+    qint64 restartGpuTimer(int index);
+    void adaptQuality(qint64 frameNs, qint64 warpNs);
+    void drawOverlay(const AnalysisFrame& analysis, GLuint framebuffer, const QSize& size);
+    void publishAnalysis(const AnalysisFrame& analysis);
+    void reportSwitch();
+
+    QThread m_thread;
+    QOffscreenSurface* m_surface = nullptr;
+    std::unique_ptr<RenderStage> m_active;
+    std::unique_ptr<RenderStage> m_standby;    // Prepared by the preloader, not yet shown
+    std::unique_ptr<PresetPreloader> m_preloader;
+    QString m_preloadTarget;
+    PendingSwitch m_switch;
+    bool m_closing = false;
+    TextEngine* m_textEngine;
+
+    QSize m_size{1, 1};
+    QSize m_outputSize{1, 1};   // Size the last frame was composed at
+    qreal m_devicePixelRatio = 1.0;
+    TripleBuffer<Target> m_targets;
+    quint64 m_targetSerial = 0;
+    ReadbackRing m_readback;
+
+    // Dynamic resolution: projectM draws into the scene at the scaled size
+    ResolutionScaler m_scaler;
+    Offscreen m_scene;
+    Offscreen m_record;         // Output at the recording size, while capturing
+    bool m_gpuTimers = false;   // GL_TIME_ELAPSED queries available
+    void (QOPENGLF_APIENTRYP m_getQueryObjectui64v)(GLuint, GLenum, quint64*) = nullptr;
+
+    MeshGovernor m_meshGovernor;
+    int m_fps = 60;
+
+    SeqLock<Request> m_request;
+    std::atomic<bool> m_requestPosted{false};
+
+    QElapsedTimer m_pluginThrottle;
+    quint64 m_lastPublishedAnalysis = 0;
+};
@@ -0,0 +1,209 @@
+#include "ReplayBuffer.h"
+
+#ifdef VIBESYNC_LIBAV_ENCODER
+
+#include <QDebug>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+namespace {
+constexpr AVRational kMicroseconds{1, 1000000};
+}
+
+ReplayBuffer::ReplayBuffer(double seconds, qint64 maxBytes)
+    : m_spanUs(static_cast<qint64>(seconds * 1e6)), m_maxBytes(maxBytes) {}
+
+ReplayBuffer::~ReplayBuffer() {
+    clear();
+    for (StreamInfo& stream : m_streams) avcodec_parameters_free(&stream.parameters);
+}
+
+void ReplayBuffer::setStreams(const AVStream* video, const AVStream* audio) {
+    QMutexLocker locker(&m_mutex);
+    clear();
+    for (StreamInfo& stream : m_streams) avcodec_parameters_free(&stream.parameters);
+    m_streams.clear();
+
+    // Indexed like the encoder's streams, so packets keep their stream_index
+    for (const AVStream* source : {video, audio}) {
+        if (!source) continue;
+        StreamInfo info;
+        info.parameters = avcodec_parameters_alloc();
+        avcodec_parameters_copy(info.parameters, source->codecpar);
+        info.timeBase = source->time_base;
+        if (m_streams.size() <= size_t(source->index)) m_streams.resize(source->index + 1);
+        m_streams[source->index] = info;
+    }
+}
+
+void ReplayBuffer::add(const AVPacket* packet) {
+    QMutexLocker locker(&m_mutex);
+    if (size_t(packet->stream_index) >= m_streams.size()) return;
+
+    const StreamInfo& stream = m_streams[packet->stream_index];
+    const bool video = stream.parameters->codec_type == AVMEDIA_TYPE_VIDEO;
+    const qint64 timestamp = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+    const qint64 us = av_rescale_q(timestamp, stream.timeBase, kMicroseconds);
+
+    if (video && (packet->flags & AV_PKT_FLAG_KEY)) {
+        Gop gop;
+        gop.startUs = us;
+        m_gops.push_back(std::move(gop));
+    }
+    // Nothing before the first keyframe is decodable
+    if (m_gops.empty()) return;
+
+    AVPacket* copy = av_packet_clone(packet);
+    if (!copy) return;
+    Gop& gop = m_gops.back();
+    gop.packets.push_back(copy);
+    gop.bytes += copy->size;
+    m_bytes += copy->size;
+    m_newestUs = std::max(m_newestUs, us);
+    evict();
+}
+
+void ReplayBuffer::evict() {
+    // The oldest GOP goes once the next one alone reaches back far enough
+    while (m_gops.size() > 1 && m_newestUs - m_gops[1].startUs >= m_spanUs) {
+        m_bytes -= m_gops.front().bytes;
+        for (AVPacket*& packet : m_gops.front().packets) av_packet_free(&packet);
+        m_gops.pop_front();
+    }
+    while (m_gops.size() > 1 && m_bytes > m_maxBytes) {
+        if (!m_capWarned) {
+            qWarning() << "⚠️ Replay buffer hit its" << m_maxBytes / (1024 * 1024) << "MB cap, holding"
+                       << (m_newestUs - m_gops[1].startUs) / 1e6 << "s";
+            m_capWarned = true;
+        }
+        m_bytes -= m_gops.front().bytes;
+        for (AVPacket*& packet : m_gops.front().packets) av_packet_free(&packet);
+        m_gops.pop_front();
+    }
+}
+
+void ReplayBuffer::clear() {
+    for (Gop& gop : m_gops) {
+        for (AVPacket*& packet : gop.packets) av_packet_free(&packet);
+    }
+    m_gops.clear();
+    m_bytes = 0;
+    m_newestUs = 0;
+}
+
+double ReplayBuffer::seconds() const {
+    QMutexLocker locker(&m_mutex);
+    return m_gops.empty() ? 0.0 : (m_newestUs - m_gops.front().startUs) / 1e6;
+}
+
+qint64 ReplayBuffer::bytes() const {
+    QMutexLocker locker(&m_mutex);
+    return m_bytes;
+}
+
+bool ReplayBuffer::save(const QString& path, QString* error) const {
+    // Take references to the packets and let the encoder carry on meanwhile
+    std::vector<AVPacket*> packets;
+    std::vector<StreamInfo> streams;
+    qint64 originUs = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_gops.empty()) {
+            *error = "The replay buffer is empty";
+            return false;
+        }
+        originUs = m_gops.front().startUs;
+        for (const Gop& gop : m_gops) {
+            for (const AVPacket* packet : gop.packets) packets.push_back(av_packet_clone(packet));
+        }
+        for (const StreamInfo& stream : m_streams) {
+            StreamInfo copy;
+            copy.parameters = avcodec_parameters_alloc();
+            if (stream.parameters) avcodec_parameters_copy(copy.parameters, stream.parameters);
+            copy.timeBase = stream.timeBase;
+            streams.push_back(copy);
+        }
+    }
+
+    auto failWith = [error](const QString& what, int result) {
+        char buffer[AV_ERROR_MAX_STRING_SIZE] = {};
+        if (result < 0) av_strerror(result, buffer, sizeof(buffer));
+        *error = result < 0 ? what + ": " + buffer : what;
+        return false;
+    };
+
+    const QByteArray file = path.toUtf8();
+    AVFormatContext* format = nullptr;
+    bool ok = true;
+    int result = avformat_alloc_output_context2(&format, nullptr, nullptr, file.constData());
+    if (result < 0 || !format) ok = failWith("No container for " + path, result);
+
+    std::vector<AVStream*> outputs;
+    for (size_t i = 0; ok && i < streams.size(); ++i) {
+        AVStream* output = avformat_new_stream(format, nullptr);
+        if (!output) {
+            ok = failWith("Could not add a stream", 0);
+            break;
+        }
+        avcodec_parameters_copy(output->codecpar, streams[i].parameters);
+        output->codecpar->codec_tag = 0;   // Let the muxer pick its own tag
+        output->time_base = streams[i].timeBase;
+        if (output->codecpar->codec_id == AV_CODEC_ID_FLAC) format->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+        outputs.push_back(output);
+    }
+    if (ok && !(format->oformat->flags & AVFMT_NOFILE)) {
+        result = avio_open(&format->pb, file.constData(), AVIO_FLAG_WRITE);
+        if (result < 0) ok = failWith("Could not create " + path, result);
+    }
+    if (ok) {
+        result = avformat_write_header(format, nullptr);
+        if (result < 0) ok = failWith("Could not write the header of " + path, result);
+    }
+
+    // The clip starts at zero; audio from before the first keyframe is cut
+    for (AVPacket*& packet : packets) {
+        if (ok) {
+            const StreamInfo& stream = streams[packet->stream_index];
+            const qint64 origin = av_rescale_q(originUs, kMicroseconds, stream.timeBase);
+            const qint64 timestamp = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+            if (timestamp >= origin) {
+                if (packet->pts != AV_NOPTS_VALUE) packet->pts -= origin;
+                if (packet->dts != AV_NOPTS_VALUE) packet->dts -= origin;
+                av_packet_rescale_ts(packet, stream.timeBase, outputs[packet->stream_index]->time_base);
+                result = av_interleaved_write_frame(format, packet);
+                if (result < 0) ok = failWith("Could not write to " + path, result);
+            }
+        }
+        av_packet_free(&packet);
+    }
+
+    if (ok) av_write_trailer(format);
+    if (format) {
+        if (format->pb && !(format->oformat->flags & AVFMT_NOFILE)) avio_closep(&format->pb);
+        avformat_free_context(format);
+    }
+    for (StreamInfo& stream : streams) avcodec_parameters_free(&stream.parameters);
+    return ok;
+}
+
+ReplayEncoder::ReplayEncoder(std::shared_ptr<ReplayBuffer> buffer, const QSize& size, int fps, const QString& audioCodec)
+    // The path only picks the container whose stream setup the clips will use
+    : LibavEncoder(audioCodec == "pcm" ? "replay.mov" : "replay.mp4", size, fps, audioCodec),
+      m_buffer(std::move(buffer)) {}
+
+bool ReplayEncoder::openOutput() {
+    m_buffer->setStreams(videoStream(), audioStream());
+    return true;
+}
+
+bool ReplayEncoder::writePacket(AVPacket* packet, AVStream* stream) {
+    Q_UNUSED(stream);
+    m_buffer->add(packet);
+    av_packet_unref(packet);
+    return true;
+}
+
+#endif
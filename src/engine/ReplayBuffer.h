@@ -0,0 +1,78 @@
+#pragma once
+#include "LibavEncoder.h"
+#include <QMutex>
+#include <deque>
+#include <memory>
+
+#ifdef VIBESYNC_LIBAV_ENCODER
+
+extern "C" {
+#include <libavutil/rational.h>
+}
+
+struct AVCodecParameters;
+
+// The last few seconds of encoded output, kept in memory for instant replay.
+//
+// Packets are grouped into GOPs, each starting at a video keyframe, and
+// whole GOPs are evicted from the front: once the rest still covers the
+// configured duration, and whenever the byte cap is exceeded. save() writes
+// what is held to a file without re-encoding, starting at the oldest
+// keyframe so the clip decodes from its first frame.
+//
+// add() comes from the encoder's writer thread, save() from any other.
+class ReplayBuffer {
+public:
+    ReplayBuffer(double seconds, qint64 maxBytes);
+    ~ReplayBuffer();
+
+    // Stream layout of the packets to come; call before add()
+    void setStreams(const AVStream* video, const AVStream* audio);
+    void add(const AVPacket* packet);
+
+    // Blocks for the length of the write; false with error set on failure
+    bool save(const QString& path, QString* error) const;
+
+    double seconds() const;     // Span currently held
+    qint64 bytes() const;
+
+private:
+    struct Gop {
+        std::vector<AVPacket*> packets;
+        qint64 startUs = 0;     // Keyframe decode time
+        qint64 bytes = 0;
+    };
+    struct StreamInfo {
+        AVCodecParameters* parameters = nullptr;
+        AVRational timeBase{0, 1};
+    };
+
+    void evict();
+    void clear();
+
+    const qint64 m_spanUs;
+    const qint64 m_maxBytes;
+
+    mutable QMutex m_mutex;
+    std::vector<StreamInfo> m_streams;
+    std::deque<Gop> m_gops;
+    qint64 m_bytes = 0;
+    qint64 m_newestUs = 0;
+    bool m_capWarned = false;
+};
+
+// LibavEncoder that fills a ReplayBuffer instead of writing a file
+class ReplayEncoder : public LibavEncoder {
+public:
+    ReplayEncoder(std::shared_ptr<ReplayBuffer> buffer, const QSize& size, int fps, const QString& audioCodec);
+
+protected:
+    bool openOutput() override;
+    bool writePacket(AVPacket* packet, AVStream* stream) override;
+    void closeOutput() override {}
+
+private:
+    std::shared_ptr<ReplayBuffer> m_buffer;
+};
+
+#endif
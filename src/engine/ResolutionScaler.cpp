@@ -0,0 +1,53 @@
+#include "ResolutionScaler.h"
+#include <algorithm>
+#include <cmath>
+
+ResolutionScaler::ResolutionScaler() : m_window(kWindowFrames, kCooldownNs) {}
+
+void ResolutionScaler::setRange(double minScale, double maxScale) {
+    m_minScale = std::clamp(minScale, kQuantum, 1.0);
+    m_maxScale = std::clamp(maxScale, m_minScale, 1.0);
+    m_scale = clampScale(m_scale);
+}
+
+void ResolutionScaler::setBudget(qint64 frameNs) {
+    if (frameNs <= 0 || frameNs == m_budgetNs) return;
+    m_budgetNs = frameNs;
+    resetWindow();
+}
+
+void ResolutionScaler::resetWindow() {
+    m_window.reset();
+}
+
+double ResolutionScaler::clampScale(double scale) const {
+    const double snapped = std::round(scale / kQuantum) * kQuantum;
+    return std::clamp(snapped, m_minScale, m_maxScale);
+}
+
+bool ResolutionScaler::addSample(qint64 frameNs, qint64 nowNs) {
+    if (!m_window.add(frameNs, nowNs)) return false;
+    const double load = static_cast<double>(m_window.p90()) / m_budgetNs;
+
+    // Cost follows the pixel count, i.e. the square of the scale
+    double next = m_scale;
+    if (load > kHighLoad) {
+        next = m_scale * std::sqrt(kTargetLoad / load);
+    } else if (load < kLowLoad) {
+        next = std::min(m_scale + kMaxStepUp, m_scale * std::sqrt(kTargetLoad / load));
+    }
+    next = clampScale(next);
+    if (std::abs(next - m_scale) < kQuantum / 2) return false;
+
+    // Samples taken at the old scale say nothing about the new one
+    m_scale = next;
+    m_window.changed(nowNs);
+    return true;
+}
+
+QSize ResolutionScaler::apply(const QSize& fullSize) const {
+    if (m_scale >= 1.0) return fullSize;
+    const int width = std::max(2, static_cast<int>(fullSize.width() * m_scale) & ~1);
+    const int height = std::max(2, static_cast<int>(fullSize.height() * m_scale) & ~1);
+    return QSize(width, height);
+}
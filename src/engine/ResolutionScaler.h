@@ -0,0 +1,49 @@
+#pragma once
+#include <QSize>
+#include <QtGlobal>
+#include "LoadWindow.h"
+
+// Chooses the resolution projectM renders at from measured frame times.
+//
+// The scale applies to each axis of the output size. Samples are collected
+// over a window of frames; once the window is full and the last change has
+// settled, the 90th percentile is compared with the frame budget. Above
+// kHighLoad the scale drops to bring the load back to kTargetLoad (cost is
+// taken to follow the pixel count); below kLowLoad it creeps back up. The gap
+// between the two thresholds and the cooldown keep it from oscillating.
+class ResolutionScaler {
+public:
+    static constexpr int kWindowFrames = 30;
+    static constexpr qint64 kCooldownNs = 500000000;   // Between changes
+    static constexpr double kHighLoad = 0.9;
+    static constexpr double kLowLoad = 0.6;
+    static constexpr double kTargetLoad = 0.75;
+    static constexpr double kMaxStepUp = 0.1;
+    static constexpr double kQuantum = 0.05;           // Scales snap to this grid
+
+    ResolutionScaler();
+
+    void setRange(double minScale, double maxScale);
+    // Time available per rendered frame
+    void setBudget(qint64 frameNs);
+
+    // Feeds the time one frame took. Returns true if the scale changed.
+    bool addSample(qint64 frameNs, qint64 nowNs);
+    // Drops collected samples, e.g. after another knob changed the load
+    void resetWindow();
+
+    double scale() const { return m_scale; }
+    qint64 budgetNs() const { return m_budgetNs; }
+    // fullSize scaled, in even pixels
+    QSize apply(const QSize& fullSize) const;
+
+private:
+    double clampScale(double scale) const;
+
+    double m_minScale = 0.5;
+    double m_maxScale = 1.0;
+    double m_scale = 1.0;
+    qint64 m_budgetNs = 16666667;
+
+    LoadWindow m_window;
+};
@@ -0,0 +1,172 @@
+#include "SegmentJoiner.h"
+
+#ifdef VIBESYNC_LIBAV_ENCODER
+
+#include "LibavEncoder.h"
+#include "AudioEngine.h"
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+namespace {
+constexpr int kSampleRate = AudioEngine::kTapSampleRate;
+constexpr int kChannels = AudioEngine::kTapChannels;
+
+struct InputCloser {
+    void operator()(AVFormatContext* format) const { avformat_close_input(&format); }
+};
+struct CodecFreer {
+    void operator()(AVCodecContext* codec) const { avcodec_free_context(&codec); }
+};
+struct FrameFreer {
+    void operator()(AVFrame* frame) const { av_frame_free(&frame); }
+};
+struct PacketFreer {
+    void operator()(AVPacket* packet) const { av_packet_free(&packet); }
+};
+struct ParametersFreer {
+    void operator()(AVCodecParameters* parameters) const { avcodec_parameters_free(&parameters); }
+};
+
+// Decoded samples back to the tap's interleaved float
+void toFloat(const AVFrame* frame, std::vector<float>& out) {
+    const int samples = frame->nb_samples;
+    out.resize(size_t(samples) * kChannels);
+    for (int i = 0; i < samples; ++i) {
+        for (int c = 0; c < kChannels; ++c) {
+            float& sample = out[size_t(i) * kChannels + c];
+            switch (frame->format) {
+            case AV_SAMPLE_FMT_S16:
+                sample = reinterpret_cast<const int16_t*>(frame->data[0])[i * kChannels + c] / 32768.0f;
+                break;
+            case AV_SAMPLE_FMT_S16P:
+                sample = reinterpret_cast<const int16_t*>(frame->data[c])[i] / 32768.0f;
+                break;
+            case AV_SAMPLE_FMT_S32:
+                sample = float(reinterpret_cast<const int32_t*>(frame->data[0])[i * kChannels + c] / 2147483648.0);
+                break;
+            case AV_SAMPLE_FMT_S32P:
+                sample = float(reinterpret_cast<const int32_t*>(frame->data[c])[i] / 2147483648.0);
+                break;
+            case AV_SAMPLE_FMT_FLT:
+                sample = reinterpret_cast<const float*>(frame->data[0])[i * kChannels + c];
+                break;
+            case AV_SAMPLE_FMT_FLTP:
+                sample = reinterpret_cast<const float*>(frame->data[c])[i];
+                break;
+            default:
+                sample = 0.0f;
+                break;
+            }
+        }
+    }
+}
+}
+
+SegmentJoiner::SegmentJoiner(const QString& outputPath, int fps, const QString& audioCodec)
+    : m_outputPath(outputPath), m_fps(std::max(1, fps)), m_audioCodec(audioCodec) {}
+
+bool SegmentJoiner::fail(const QString& what, int error) {
+    m_error = what;
+    if (error < 0) {
+        char buffer[AV_ERROR_MAX_STRING_SIZE] = {};
+        av_strerror(error, buffer, sizeof(buffer));
+        m_error += QString(": ") + buffer;
+    }
+    return false;
+}
+
+bool SegmentJoiner::join(const QList<Segment>& segments) {
+    if (segments.isEmpty()) return fail("No segments to join");
+
+    std::unique_ptr<LibavEncoder> output;
+    std::unique_ptr<AVCodecParameters, ParametersFreer> reference;
+    std::unique_ptr<AVPacket, PacketFreer> packet(av_packet_alloc());
+    std::unique_ptr<AVFrame, FrameFreer> decoded(av_frame_alloc());
+    std::vector<float> pcm;
+
+    for (const Segment& segment : segments) {
+        const QByteArray path = segment.path.toUtf8();
+        AVFormatContext* opened = nullptr;
+        int result = avformat_open_input(&opened, path.constData(), nullptr, nullptr);
+        if (result < 0) return fail("Could not open " + segment.path, result);
+        std::unique_ptr<AVFormatContext, InputCloser> input(opened);
+        result = avformat_find_stream_info(input.get(), nullptr);
+        if (result < 0) return fail("Could not read " + segment.path, result);
+
+        const int video = av_find_best_stream(input.get(), AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        const int audio = av_find_best_stream(input.get(), AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+        if (video < 0) return fail(segment.path + " has no video");
+        if (audio < 0) return fail(segment.path + " has no audio (segments need the in-process encoder)");
+        const AVCodecParameters* parameters = input->streams[video]->codecpar;
+
+        if (!reference) {
+            // The first segment's stream setup is the output's
+            output = std::make_unique<LibavEncoder>(m_outputPath, QSize(parameters->width, parameters->height), m_fps,
+                                                    m_audioCodec);
+            output->setVideoCopy(parameters);
+            if (!output->open()) return fail(output->errorString());
+            reference.reset(avcodec_parameters_alloc());
+            avcodec_parameters_copy(reference.get(), parameters);
+        } else if (parameters->codec_id != reference->codec_id || parameters->width != reference->width ||
+                   parameters->height != reference->height || parameters->extradata_size != reference->extradata_size ||
+                   (reference->extradata_size > 0 &&
+                    std::memcmp(parameters->extradata, reference->extradata, size_t(reference->extradata_size)) != 0)) {
+            return fail(segment.path + " was encoded differently from the first segment");
+        }
+
+        const AVCodecParameters* audioParameters = input->streams[audio]->codecpar;
+        const AVCodec* decoder = avcodec_find_decoder(audioParameters->codec_id);
+        if (!decoder) return fail("No decoder for the audio of " + segment.path);
+        std::unique_ptr<AVCodecContext, CodecFreer> audioCodec(avcodec_alloc_context3(decoder));
+        avcodec_parameters_to_context(audioCodec.get(), audioParameters);
+        result = avcodec_open2(audioCodec.get(), decoder, nullptr);
+        if (result < 0) return fail("Could not decode the audio of " + segment.path, result);
+        if (audioCodec->sample_rate != kSampleRate || audioCodec->ch_layout.nb_channels != kChannels) {
+            return fail(segment.path + " is not 48 kHz stereo");
+        }
+
+        // Counted by samples, not container timestamps: the segment's audio
+        // starts exactly at its first frame and runs without gaps
+        const AVRational videoBase = input->streams[video]->time_base;
+        quint64 audioFrame = quint64(segment.firstFrame) * kSampleRate / m_fps;
+        auto drain = [&]() {
+            while (avcodec_receive_frame(audioCodec.get(), decoded.get()) == 0) {
+                toFloat(decoded.get(), pcm);
+                const bool ok = output->writeAudio(pcm.data(), size_t(decoded->nb_samples), audioFrame);
+                audioFrame += quint64(decoded->nb_samples);
+                av_frame_unref(decoded.get());
+                if (!ok) return false;
+            }
+            return true;
+        };
+
+        while ((result = av_read_frame(input.get(), packet.get())) >= 0) {
+            bool ok = true;
+            if (packet->stream_index == video) {
+                ok = output->writeVideoPacket(packet.get(), videoBase, segment.firstFrame);
+            } else if (packet->stream_index == audio) {
+                ok = avcodec_send_packet(audioCodec.get(), packet.get()) >= 0 && drain();
+            }
+            av_packet_unref(packet.get());
+            if (!ok) return fail(output->errorString().isEmpty() ? "Could not join " + segment.path : output->errorString());
+        }
+        if (result != AVERROR_EOF) return fail("Could not read " + segment.path, result);
+        avcodec_send_packet(audioCodec.get(), nullptr);
+        if (!drain()) return fail(output->errorString());
+    }
+
+    output->close();
+    if (!output->errorString().isEmpty()) return fail(output->errorString());
+    qInfo().noquote() << "🧩 Joined" << segments.size() << "segments into" << m_outputPath;
+    return true;
+}
+
+#endif
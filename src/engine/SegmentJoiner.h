@@ -0,0 +1,37 @@
+#pragma once
+#include <QList>
+#include <QString>
+
+#ifdef VIBESYNC_LIBAV_ENCODER
+
+// Joins the segments of a segment-parallel render into one file.
+//
+// Video is copied packet for packet; every segment starts with a keyframe
+// of its own, so the seams fall on GOP boundaries and nothing is
+// re-encoded. The segments carry lossless (FLAC) audio, which is decoded
+// and encoded once, continuously, into the output's audio codec: encoding
+// each segment's audio separately would put an encoder delay, and an
+// audible click, at every seam.
+class SegmentJoiner {
+public:
+    struct Segment {
+        QString path;
+        qint64 firstFrame = 0;      // Video frame of the whole render it starts at
+    };
+
+    SegmentJoiner(const QString& outputPath, int fps, const QString& audioCodec);
+
+    // Segments in order. False with errorString() set on failure.
+    bool join(const QList<Segment>& segments);
+    QString errorString() const { return m_error; }
+
+private:
+    bool fail(const QString& what, int error = 0);
+
+    QString m_outputPath;
+    int m_fps;
+    QString m_audioCodec;
+    QString m_error;
+};
+
+#endif
@@ -0,0 +1,337 @@
+#include "ShaderCache.h"
+#include "../core/PathUtils.h"
+#include "../core/PerformanceManager.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QOpenGLContext>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+constexpr char kMagic[4] = {'V', 'S', 'P', '1'};
+constexpr int kMaxAttachedShaders = 8;
+
+// File layout: Header, then the program binary
+struct Header {
+    char magic[4];
+    quint32 format;     // GLenum from glGetProgramBinary
+    quint32 length;
+};
+
+// Driver entry points, resolved once through the current context
+struct RealGl {
+    void (QOPENGLF_APIENTRYP shaderSource)(GLuint, GLsizei, const GLchar* const*, const GLint*) = nullptr;
+    void (QOPENGLF_APIENTRYP compileShader)(GLuint) = nullptr;
+    void (QOPENGLF_APIENTRYP deleteShader)(GLuint) = nullptr;
+    void (QOPENGLF_APIENTRYP bindAttribLocation)(GLuint, GLuint, const GLchar*) = nullptr;
+    void (QOPENGLF_APIENTRYP linkProgram)(GLuint) = nullptr;
+    void (QOPENGLF_APIENTRYP deleteProgram)(GLuint) = nullptr;
+    void (QOPENGLF_APIENTRYP getAttachedShaders)(GLuint, GLsizei, GLsizei*, GLuint*) = nullptr;
+    void (QOPENGLF_APIENTRYP getProgramiv)(GLuint, GLenum, GLint*) = nullptr;
+    void (QOPENGLF_APIENTRYP programParameteri)(GLuint, GLenum, GLint) = nullptr;
+    void (QOPENGLF_APIENTRYP getProgramBinary)(GLuint, GLsizei, GLsizei*, GLenum*, void*) = nullptr;
+    void (QOPENGLF_APIENTRYP programBinary)(GLuint, GLenum, const void*, GLsizei) = nullptr;
+    void (QOPENGLF_APIENTRYP getIntegerv)(GLenum, GLint*) = nullptr;
+    const GLubyte* (QOPENGLF_APIENTRYP getString)(GLenum) = nullptr;
+};
+RealGl s_gl;
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+template<typename Fn>
+void resolveInto(QOpenGLContext* context, Fn& fn, const char* name) {
+    fn = reinterpret_cast<Fn>(context->getProcAddress(name));
+}
+}
+
+ShaderCache::ShaderCache() {
+    m_directory = PathUtils::getCachePath() + "/shaders";
+    QDir().mkpath(m_directory);
+
+    // Rebuild the LRU index from the files; mtime is the last use
+    const QFileInfoList files = QDir(m_directory).entryInfoList({"*.bin"}, QDir::Files);
+    for (const QFileInfo& file : files) {
+        Entry entry;
+        entry.size = file.size();
+        entry.lastUseMs = file.lastModified().toMSecsSinceEpoch();
+        m_entries.insert(file.completeBaseName().toLatin1(), entry);
+        m_totalBytes += entry.size;
+    }
+}
+
+void* ShaderCache::resolve(const char* name, void* userData) {
+    Q_UNUSED(userData);
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    if (!context) return nullptr;
+
+    ShaderCache& cache = instance();
+    if (cache.initialize()) {
+        if (std::strcmp(name, "glShaderSource") == 0) return reinterpret_cast<void*>(&ShaderCache::shaderSource);
+        if (std::strcmp(name, "glCompileShader") == 0) return reinterpret_cast<void*>(&ShaderCache::compileShader);
+        if (std::strcmp(name, "glDeleteShader") == 0) return reinterpret_cast<void*>(&ShaderCache::deleteShader);
+        if (std::strcmp(name, "glBindAttribLocation") == 0) return reinterpret_cast<void*>(&ShaderCache::bindAttribLocation);
+        if (std::strcmp(name, "glLinkProgram") == 0) return reinterpret_cast<void*>(&ShaderCache::linkProgram);
+        if (std::strcmp(name, "glDeleteProgram") == 0) return reinterpret_cast<void*>(&ShaderCache::deleteProgram);
+    }
+    return reinterpret_cast<void*>(context->getProcAddress(name));
+}
+
+bool ShaderCache::initialize() {
+    QMutexLocker locker(&m_mutex);
+    if (m_supported >= 0) return m_supported;
+
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    resolveInto(context, s_gl.shaderSource, "glShaderSource");
+    resolveInto(context, s_gl.compileShader, "glCompileShader");
+    resolveInto(context, s_gl.deleteShader, "glDeleteShader");
+    resolveInto(context, s_gl.bindAttribLocation, "glBindAttribLocation");
+    resolveInto(context, s_gl.linkProgram, "glLinkProgram");
+    resolveInto(context, s_gl.deleteProgram, "glDeleteProgram");
+    resolveInto(context, s_gl.getAttachedShaders, "glGetAttachedShaders");
+    resolveInto(context, s_gl.getProgramiv, "glGetProgramiv");
+    resolveInto(context, s_gl.programParameteri, "glProgramParameteri");
+    resolveInto(context, s_gl.getProgramBinary, "glGetProgramBinary");
+    resolveInto(context, s_gl.programBinary, "glProgramBinary");
+    resolveInto(context, s_gl.getIntegerv, "glGetIntegerv");
+    resolveInto(context, s_gl.getString, "glGetString");
+
+    GLint formats = 0;
+    if (s_gl.getIntegerv) s_gl.getIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    m_supported = formats > 0 && s_gl.shaderSource && s_gl.compileShader && s_gl.deleteShader && s_gl.bindAttribLocation
+                  && s_gl.linkProgram && s_gl.deleteProgram && s_gl.getAttachedShaders && s_gl.getProgramiv
+                  && s_gl.programParameteri && s_gl.getProgramBinary && s_gl.programBinary && s_gl.getString;
+    if (!m_supported) {
+        qDebug() << "⚠️ Shader cache disabled: the driver offers no program binary formats";
+        return false;
+    }
+
+    // A binary is only valid for the driver build that produced it
+    for (GLenum id : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        m_driverId += reinterpret_cast<const char*>(s_gl.getString(id));
+        m_driverId += '\n';
+    }
+    qDebug() << "🗄️ Shader cache:" << m_entries.size() << "programs," << m_totalBytes / 1024 << "KiB";
+    return true;
+}
+
+void ShaderCache::shaderSource(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths) {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (GLsizei i = 0; i < count; ++i) {
+        const qsizetype length = (lengths && lengths[i] >= 0) ? lengths[i] : qsizetype(std::strlen(strings[i]));
+        hash.addData(QByteArrayView(strings[i], length));
+    }
+
+    ShaderCache& cache = instance();
+    {
+        QMutexLocker locker(&cache.m_mutex);
+        cache.m_shaderHashes.insert(shader, hash.result());
+    }
+    s_gl.shaderSource(shader, count, strings, lengths);
+}
+
+void ShaderCache::compileShader(GLuint shader) {
+    QElapsedTimer timer;
+    timer.start();
+    s_gl.compileShader(shader);
+    instance().m_buildNs.fetch_add(timer.nsecsElapsed(), std::memory_order_relaxed);
+}
+
+void ShaderCache::deleteShader(GLuint shader) {
+    // Names are recycled, so forget the source with the object. A program
+    // linked after its shaders were deleted simply bypasses the cache.
+    ShaderCache& cache = instance();
+    {
+        QMutexLocker locker(&cache.m_mutex);
+        cache.m_shaderHashes.remove(shader);
+    }
+    s_gl.deleteShader(shader);
+}
+
+void ShaderCache::bindAttribLocation(GLuint program, GLuint index, const GLchar* name) {
+    ShaderCache& cache = instance();
+    {
+        QMutexLocker locker(&cache.m_mutex);
+        QByteArray& bindings = cache.m_attribBindings[program];
+        bindings += QByteArray::number(index) + '=' + name + ';';
+    }
+    s_gl.bindAttribLocation(program, index, name);
+}
+
+void ShaderCache::deleteProgram(GLuint program) {
+    ShaderCache& cache = instance();
+    {
+        QMutexLocker locker(&cache.m_mutex);
+        cache.m_attribBindings.remove(program);
+    }
+    s_gl.deleteProgram(program);
+}
+
+void ShaderCache::linkProgram(GLuint program) {
+    ShaderCache& cache = instance();
+    QElapsedTimer timer;
+    timer.start();
+    const QByteArray key = cache.programKey(program);
+    if (key.isEmpty()) {
+        s_gl.linkProgram(program);
+        cache.m_buildNs.fetch_add(timer.nsecsElapsed(), std::memory_order_relaxed);
+        return;
+    }
+
+    if (cache.loadBinary(program, key)) {
+        cache.m_hits.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        cache.m_misses.fetch_add(1, std::memory_order_relaxed);
+        s_gl.programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        s_gl.linkProgram(program);
+
+        GLint linked = GL_FALSE;
+        s_gl.getProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked) cache.storeBinary(program, key);
+    }
+    cache.m_buildNs.fetch_add(timer.nsecsElapsed(), std::memory_order_relaxed);
+    cache.report();
+}
+
+QByteArray ShaderCache::programKey(GLuint program) {
+    GLuint shaders[kMaxAttachedShaders];
+    GLsizei count = 0;
+    s_gl.getAttachedShaders(program, kMaxAttachedShaders, &count, shaders);
+
+    QMutexLocker locker(&m_mutex);
+    std::vector<QByteArray> sources;
+    for (GLsizei i = 0; i < count; ++i) {
+        const auto it = m_shaderHashes.constFind(shaders[i]);
+        if (it == m_shaderHashes.constEnd()) return QByteArray();  // Source unknown, don't guess
+        sources.push_back(*it);
+    }
+    if (sources.empty()) return QByteArray();
+
+    // Attachment order does not change the program
+    std::sort(sources.begin(), sources.end());
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(m_driverId);
+    for (const QByteArray& source : sources) hash.addData(source);
+    hash.addData(m_attribBindings.value(program));
+    return hash.result().toHex();
+}
+
+QString ShaderCache::entryPath(const QByteArray& key) const {
+    return m_directory + "/" + QString::fromLatin1(key) + ".bin";
+}
+
+bool ShaderCache::loadBinary(GLuint program, const QByteArray& key) {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_entries.contains(key)) return false;
+    }
+
+    QFile file(entryPath(key));
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    const QByteArray data = file.readAll();
+    file.close();
+
+    Header header{};
+    bool valid = data.size() >= qsizetype(sizeof(Header));
+    if (valid) {
+        std::memcpy(&header, data.constData(), sizeof(Header));
+        valid = std::memcmp(header.magic, kMagic, 4) == 0
+                && qsizetype(sizeof(Header)) + qsizetype(header.length) == data.size();
+    }
+
+    GLint linked = GL_FALSE;
+    if (valid) {
+        s_gl.programBinary(program, header.format, data.constData() + sizeof(Header), static_cast<GLsizei>(header.length));
+        s_gl.getProgramiv(program, GL_LINK_STATUS, &linked);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (!linked) {
+        // Stale or corrupt: forget it, the caller links from source
+        m_rejected.fetch_add(1, std::memory_order_relaxed);
+        m_totalBytes -= m_entries.take(key).size;
+        QFile::remove(entryPath(key));
+        return false;
+    }
+
+    const QDateTime now = QDateTime::currentDateTime();
+    m_entries[key].lastUseMs = now.toMSecsSinceEpoch();
+    QFile touched(entryPath(key));
+    if (touched.open(QIODevice::ReadWrite)) {
+        touched.setFileTime(now, QFileDevice::FileModificationTime);
+    }
+    return true;
+}
+
+void ShaderCache::storeBinary(GLuint program, const QByteArray& key) {
+    GLint length = 0;
+    s_gl.getProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    QByteArray data(qsizetype(sizeof(Header)) + length, Qt::Uninitialized);
+    GLsizei written = 0;
+    GLenum format = 0;
+    s_gl.getProgramBinary(program, length, &written, &format, data.data() + sizeof(Header));
+    if (written <= 0) return;
+    data.resize(qsizetype(sizeof(Header)) + written);
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, 4);
+    header.format = format;
+    header.length = static_cast<quint32>(written);
+    std::memcpy(data.data(), &header, sizeof(Header));
+
+    // Write to a temp file and rename, so a concurrent load never sees half
+    QSaveFile out(entryPath(key));
+    if (!out.open(QIODevice::WriteOnly)) return;
+    out.write(data);
+    if (!out.commit()) return;
+
+    QMutexLocker locker(&m_mutex);
+    Entry& entry = m_entries[key];
+    m_totalBytes += data.size() - entry.size;
+    entry.size = data.size();
+    entry.lastUseMs = QDateTime::currentMSecsSinceEpoch();
+    evict();
+}
+
+void ShaderCache::evict() {
+    // Caller holds m_mutex
+    while (m_totalBytes > m_budget && !m_entries.isEmpty()) {
+        auto oldest = m_entries.begin();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->lastUseMs < oldest->lastUseMs) oldest = it;
+        }
+        QFile::remove(entryPath(oldest.key()));
+        m_totalBytes -= oldest->size;
+        m_entries.erase(oldest);
+    }
+}
+
+void ShaderCache::setBudget(qint64 bytes) {
+    QMutexLocker locker(&m_mutex);
+    m_budget = bytes;
+    evict();
+}
+
+qint64 ShaderCache::sizeBytes() const {
+    QMutexLocker locker(&m_mutex);
+    return m_totalBytes;
+}
+
+void ShaderCache::report() {
+    PerformanceMonitor::instance().recordShaderCacheMetrics(hits(), misses(), sizeBytes());
+}
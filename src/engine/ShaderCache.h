@@ -0,0 +1,96 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <qopengl.h>
+#include <atomic>
+
+#if __has_include(<projectM-4/version.h>)
+#include <projectM-4/version.h>
+#endif
+
+// projectM resolves its GL entry points through a caller-supplied loader
+// since 4.2; older versions link GL directly and bypass the cache
+#if defined(PROJECTM_VERSION_MAJOR) && \
+    (PROJECTM_VERSION_MAJOR > 4 || (PROJECTM_VERSION_MAJOR == 4 && PROJECTM_VERSION_MINOR >= 2))
+#define VIBESYNC_PROJECTM_GL_LOADER 1
+#endif
+
+// On-disk cache of linked GL programs (glGetProgramBinary blobs).
+//
+// projectM compiles every preset's warp and composite shaders when the
+// preset loads, and on Mesa most of that time goes into linking. The cache
+// sits in projectM's GL loader: resolve() hands out the driver's entry points
+// except for a few program calls, which it wraps. glLinkProgram() hashes the
+// attached shader sources together with the driver identity and, on a hit,
+// loads the stored binary instead of linking. Misses link normally and store
+// the result. A binary the driver rejects (e.g. after a driver update) is
+// dropped and the program is linked as usual.
+//
+// Entries are evicted least recently used first once the cache exceeds its
+// size budget. Thread-safe: the render thread and the preset preloader
+// share one cache.
+class ShaderCache {
+public:
+    static ShaderCache& instance() {
+        static ShaderCache s;
+        return s;
+    }
+
+    static constexpr qint64 kDefaultBudgetBytes = qint64(256) << 20;
+
+    // projectM GL loader callback. Needs a current context; userData is unused.
+    static void* resolve(const char* name, void* userData);
+
+    void setBudget(qint64 bytes);
+    qint64 sizeBytes() const;
+    quint64 hits() const { return m_hits.load(std::memory_order_relaxed); }
+    quint64 misses() const { return m_misses.load(std::memory_order_relaxed); }
+    quint64 rejected() const { return m_rejected.load(std::memory_order_relaxed); }
+    // Total time spent in glCompileShader/glLinkProgram (including binary
+    // loads), for the preset profiler
+    qint64 buildNs() const { return m_buildNs.load(std::memory_order_relaxed); }
+
+    QString cacheDirectory() const { return m_directory; }
+
+private:
+    ShaderCache();
+
+    struct Entry {
+        qint64 size = 0;
+        qint64 lastUseMs = 0;
+    };
+
+    // Wrapped GL entry points
+    static void QOPENGLF_APIENTRY shaderSource(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths);
+    static void QOPENGLF_APIENTRY compileShader(GLuint shader);
+    static void QOPENGLF_APIENTRY deleteShader(GLuint shader);
+    static void QOPENGLF_APIENTRY bindAttribLocation(GLuint program, GLuint index, const GLchar* name);
+    static void QOPENGLF_APIENTRY linkProgram(GLuint program);
+    static void QOPENGLF_APIENTRY deleteProgram(GLuint program);
+
+    bool initialize();
+    QByteArray programKey(GLuint program);
+    bool loadBinary(GLuint program, const QByteArray& key);
+    void storeBinary(GLuint program, const QByteArray& key);
+    void evict();
+    void report();
+    QString entryPath(const QByteArray& key) const;
+
+    QString m_directory;
+
+    mutable QMutex m_mutex;
+    int m_supported = -1;                       // Unknown until the first resolve()
+    QByteArray m_driverId;
+    QHash<GLuint, QByteArray> m_shaderHashes;   // Per shader object, set by glShaderSource
+    QHash<GLuint, QByteArray> m_attribBindings; // Per program, set before linking
+    QHash<QByteArray, Entry> m_entries;
+    qint64 m_totalBytes = 0;
+    qint64 m_budget = kDefaultBudgetBytes;
+
+    std::atomic<quint64> m_hits{0};
+    std::atomic<quint64> m_misses{0};
+    std::atomic<quint64> m_rejected{0};
+    std::atomic<qint64> m_buildNs{0};
+};
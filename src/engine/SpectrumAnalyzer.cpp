@@ -0,0 +1,168 @@
+#include "SpectrumAnalyzer.h"
+#include "AudioEngine.h"
+#include "../core/SimdKernels.h"
+#include <QJsonArray>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+SpectrumAnalyzer::SpectrumAnalyzer() {
+    m_beats = std::make_unique<BeatDetector>(AudioEngine::kTapSampleRate);
+    allocate();
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer() {
+    stop();
+}
+
+void SpectrumAnalyzer::start() {
+    if (m_running.exchange(true)) return;
+
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName("SpectrumAnalyzer");
+    m_thread->start(QThread::HighPriority);
+    qDebug() << "📊 Spectrum analyzer started (FFT" << m_fftSize << "hop" << m_hopSize
+             << "kernels" << kernelName() << ")";
+}
+
+void SpectrumAnalyzer::stop() {
+    if (!m_running.exchange(false)) return;
+
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+bool SpectrumAnalyzer::setFftSize(int size) {
+    if (!Fft::isValidSize(static_cast<size_t>(size))) {
+        qWarning() << "⚠️ Invalid FFT size" << size << "- must be a power of two between 64 and 65536";
+        return false;
+    }
+    if (size == m_fftSize) return true;
+
+    const bool wasRunning = isRunning();
+    stop();
+    m_fftSize = size;
+    allocate();
+    if (wasRunning) start();
+    return true;
+}
+
+void SpectrumAnalyzer::allocate() {
+    // Hop of a quarter window (capped) keeps the update rate near 100 Hz
+    // at 48 kHz without re-analysing mostly identical windows.
+    m_hopSize = std::min(m_fftSize / 4, 512);
+
+    const size_t n = static_cast<size_t>(m_fftSize);
+    m_fft = std::make_unique<Fft>(n);
+    m_window.assign(n * AudioEngine::kTapChannels, 0.0f);
+    m_left.assign(n, 0.0f);
+    m_right.assign(n, 0.0f);
+    m_mono.assign(n, 0.0f);
+    m_chunk.assign(static_cast<size_t>(BeatDetector::kHopFrames) * AudioEngine::kTapChannels, 0.0f);
+    m_pendingFrames = 0;
+
+    // Log-spaced bands, each at least one bin wide
+    const float sampleRate = static_cast<float>(AudioEngine::kTapSampleRate);
+    const float maxHz = std::min(kMaxBandHz, sampleRate / 2.0f);
+    const int bins = static_cast<int>(m_fft->binCount());
+    m_bandBins.clear();
+    int first = std::max(1, static_cast<int>(kMinBandHz * m_fftSize / sampleRate));
+    for (int b = 0; b < kBandCount; ++b) {
+        const float edgeHz = kMinBandHz * std::pow(maxHz / kMinBandHz, float(b + 1) / kBandCount);
+        int last = static_cast<int>(std::lround(edgeHz * m_fftSize / sampleRate));
+        last = std::clamp(last, first + 1, bins);
+        m_bandBins.emplace_back(first, last);
+        first = std::min(last, bins - 1);
+    }
+
+    m_frames.forEachSlot([&](AnalysisFrame& frame) {
+        frame.sampleRate = AudioEngine::kTapSampleRate;
+        frame.fftSize = m_fftSize;
+        frame.magnitudes.assign(m_fft->binCount(), 0.0f);
+        frame.bands.assign(kBandCount, 0.0f);
+    });
+}
+
+const AnalysisFrame& SpectrumAnalyzer::latest() {
+    m_frames.update();
+    return m_frames.front();
+}
+
+QString SpectrumAnalyzer::kernelName() const {
+    return QString::fromLatin1(SimdKernels::get().name);
+}
+
+void SpectrumAnalyzer::run() {
+    const size_t channels = AudioEngine::kTapChannels;
+    const size_t windowFrames = static_cast<size_t>(m_fftSize);
+    const size_t hop = static_cast<size_t>(m_hopSize);
+    const size_t chunk = std::min(hop, static_cast<size_t>(BeatDetector::kHopFrames));
+    AudioEngine& audio = AudioEngine::instance();
+
+    while (m_running.load(std::memory_order_relaxed)) {
+        if (audio.pcmAvailable(PcmTap::Analyzer) < chunk) {
+            QThread::usleep(1000);
+            continue;
+        }
+
+        audio.readPcm(PcmTap::Analyzer, m_chunk.data(), chunk);
+        m_beats->process(m_chunk.data(), chunk);
+
+        // Slide the window and append the new audio at the end
+        const size_t keep = (windowFrames - chunk) * channels;
+        std::memmove(m_window.data(), m_window.data() + chunk * channels, keep * sizeof(float));
+        std::memcpy(m_window.data() + keep, m_chunk.data(), chunk * channels * sizeof(float));
+        m_streamFrame += chunk;
+
+        m_pendingFrames += chunk;
+        if (m_pendingFrames >= hop) {
+            m_pendingFrames = 0;
+            analyseWindow();
+        }
+    }
+}
+
+void SpectrumAnalyzer::analyseWindow() {
+    const SimdKernels& simd = SimdKernels::get();
+    const size_t n = static_cast<size_t>(m_fftSize);
+
+    for (size_t i = 0; i < n; ++i) {
+        m_left[i] = m_window[2 * i];
+        m_right[i] = m_window[2 * i + 1];
+        m_mono[i] = 0.5f * (m_left[i] + m_right[i]);
+    }
+
+    AnalysisFrame& frame = m_frames.back();
+    frame.sequence = ++m_sequence;
+    frame.streamFrame = m_streamFrame;
+    frame.rms[0] = std::sqrt(simd.sumSquares(m_left.data(), n) / n);
+    frame.rms[1] = std::sqrt(simd.sumSquares(m_right.data(), n) / n);
+    frame.peak[0] = simd.peakAbs(m_left.data(), n);
+    frame.peak[1] = simd.peakAbs(m_right.data(), n);
+
+    m_fft->transform(m_mono.data(), frame.magnitudes.data());
+
+    for (int b = 0; b < kBandCount; ++b) {
+        const auto [first, last] = m_bandBins[b];
+        const size_t width = static_cast<size_t>(last - first);
+        frame.bands[b] = simd.sumSquares(frame.magnitudes.data() + first, width) / width;
+    }
+
+    m_frames.publish();
+}
+
+QJsonObject SpectrumAnalyzer::toJson(const AnalysisFrame& frame) {
+    QJsonArray bands;
+    for (float energy : frame.bands) bands.append(energy);
+
+    QJsonObject obj;
+    obj["sequence"] = static_cast<qint64>(frame.sequence);
+    obj["sampleRate"] = frame.sampleRate;
+    obj["fftSize"] = frame.fftSize;
+    obj["rms"] = QJsonArray{frame.rms[0], frame.rms[1]};
+    obj["peak"] = QJsonArray{frame.peak[0], frame.peak[1]};
+    obj["bands"] = bands;
+    return obj;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <QObject>
+#include <QThread>
+#include <QJsonObject>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "../core/Fft.h"
+#include "../core/TripleBuffer.h"
+#include "BeatDetector.h"
+
+// One analysis result, shared by every consumer (overlays, plugins, recorder)
+struct AnalysisFrame {
+    quint64 sequence = 0;      // Increments with every published frame
+    quint64 streamFrame = 0;   // Tap frame index just past the analysed window
+    int sampleRate = 0;
+    int fftSize = 0;
+    std::vector<float> magnitudes; // fftSize / 2 + 1 bins of the mono mix
+    std::vector<float> bands;      // Log-spaced band energies
+    std::array<float, 2> rms{};    // Per channel, over the window
+    std::array<float, 2> peak{};
+};
+
+// Real-time spectrum analysis of the played audio.
+//
+// A worker thread drains AudioEngine's analyzer tap, runs a windowed FFT
+// every hop and publishes the result through a wait-free triple buffer.
+// All buffers are sized when the FFT size is set, never in the loop.
+//
+// The same thread feeds the BeatDetector in small chunks, so onset
+// detection is not held back by the (much longer) spectrum hop.
+class SpectrumAnalyzer : public QObject {
+    Q_OBJECT
+public:
+    static SpectrumAnalyzer& instance() {
+        static SpectrumAnalyzer s;
+        return s;
+    }
+
+    static constexpr int kBandCount = 32;
+    static constexpr int kDefaultFftSize = 2048;
+    static constexpr float kMinBandHz = 30.0f;
+    static constexpr float kMaxBandHz = 16000.0f;
+
+    void start();
+    void stop();
+    bool isRunning() const { return m_running.load(std::memory_order_relaxed); }
+
+    // Restarts the worker if it is running. Size must be a power of two.
+    // Call from the consumer thread, since the published frames are resized.
+    bool setFftSize(int size);
+    int fftSize() const { return m_fftSize; }
+    int hopSize() const { return m_hopSize; }
+
+    // Consumer side of the triple buffer: call from one thread only (the
+    // frame loop) and share the returned frame from there.
+    const AnalysisFrame& latest();
+
+    // Beat/tempo tracking on the same audio; its state is lock-free to read
+    BeatDetector& beats() { return *m_beats; }
+
+    QString kernelName() const;
+    static QJsonObject toJson(const AnalysisFrame& frame);
+
+private:
+    SpectrumAnalyzer();
+    ~SpectrumAnalyzer();
+
+    void allocate();
+    void run();
+    void analyseWindow();
+
+    QThread* m_thread = nullptr;
+    std::atomic<bool> m_running{false};
+
+    int m_fftSize = kDefaultFftSize;
+    int m_hopSize = kDefaultFftSize / 4;
+    quint64 m_streamFrame = 0;
+    quint64 m_sequence = 0;
+
+    std::unique_ptr<Fft> m_fft;
+    std::vector<float> m_window;   // Interleaved stereo, fftSize frames, oldest first
+    std::vector<float> m_left;
+    std::vector<float> m_right;
+    std::vector<float> m_mono;
+    std::vector<std::pair<int, int>> m_bandBins; // [first, last) bin per band
+    std::vector<float> m_chunk;    // Interleaved stereo read buffer
+    size_t m_pendingFrames = 0;    // Frames read since the last spectrum
+
+    std::unique_ptr<BeatDetector> m_beats;
+
+    TripleBuffer<AnalysisFrame> m_frames;
+};
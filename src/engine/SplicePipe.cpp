@@ -0,0 +1,94 @@
+#include "SplicePipe.h"
+
+#ifdef __linux__
+
+#include <QDebug>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+// Fewer, larger handoffs; the default 64 KiB wakes the reader every 16 pages.
+// Unprivileged processes get up to /proc/sys/fs/pipe-max-size (1 MiB by default).
+constexpr int kPipeBytes = 1 << 20;
+
+void ignoreSigpipe() {
+    // A dead encoder should fail the write with EPIPE, not kill the app
+    static const bool ignored = [] {
+        struct sigaction action {};
+        action.sa_handler = SIG_IGN;
+        return sigaction(SIGPIPE, &action, nullptr) == 0;
+    }();
+    Q_UNUSED(ignored);
+}
+}
+
+SplicePipe::~SplicePipe() {
+    closeReadEnd();
+    close();
+}
+
+bool SplicePipe::create() {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) return fail("pipe2");
+    m_read = fds[0];
+    m_write = fds[1];
+    fcntl(m_write, F_SETPIPE_SZ, kPipeBytes);  // Best effort, the default works too
+    ignoreSigpipe();
+    return true;
+}
+
+void SplicePipe::closeReadEnd() {
+    if (m_read >= 0) ::close(m_read);
+    m_read = -1;
+}
+
+void SplicePipe::close() {
+    if (m_write >= 0) ::close(m_write);
+    m_write = -1;
+}
+
+bool SplicePipe::write(const unsigned char* data, size_t size) {
+    if (m_write < 0) return fail("write after close");
+
+    // Asked every time: the reader may resize the pipe
+    const int capacity = fcntl(m_write, F_GETPIPE_SZ);
+    if (capacity <= 0) return fail("F_GETPIPE_SZ");
+    const size_t tail = std::min(size, size_t(capacity));
+
+    size_t spliced = size - tail;
+    while (spliced > 0) {
+        iovec chunk{const_cast<unsigned char*>(data), spliced};
+        const ssize_t result = vmsplice(m_write, &chunk, 1, 0);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            return fail("vmsplice");
+        }
+        data += result;
+        spliced -= size_t(result);
+    }
+
+    // The copied tail fills every slot of the pipe after the spliced pages
+    size_t copied = tail;
+    while (copied > 0) {
+        const ssize_t result = ::write(m_write, data, copied);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            return fail("write");
+        }
+        data += result;
+        copied -= size_t(result);
+    }
+    return true;
+}
+
+bool SplicePipe::fail(const QString& what) {
+    m_error = what + ": " + QString::fromLocal8Bit(strerror(errno));
+    return false;
+}
+
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+#include <QString>
+#include <cstddef>
+
+#ifdef __linux__
+
+// A pipe whose write end hands pages to the reader with vmsplice() instead
+// of copying them, for feeding whole frames to an encoder process's stdin.
+//
+// A spliced page stays referenced by the pipe until the reader has read it,
+// so a buffer cannot be reused the moment vmsplice() returns. write() copies
+// the last pipe-capacity bytes of every buffer with a plain write() instead:
+// when that returns, everything spliced before it has left the pipe and the
+// caller is free to overwrite the buffer. At 4K the copy is about 3% of a
+// BGRA frame. This relies on the reader read()ing the pipe, as ffmpeg does,
+// rather than splicing the pages onwards.
+class SplicePipe {
+public:
+    SplicePipe() = default;
+    ~SplicePipe();
+    SplicePipe(const SplicePipe&) = delete;
+    SplicePipe& operator=(const SplicePipe&) = delete;
+
+    bool create();
+    // For the child's stdin; both ends are close-on-exec
+    int readFd() const { return m_read; }
+    // Once the child has its copy
+    void closeReadEnd();
+
+    // Blocks until all of data is in the pipe; the buffer may be reused after
+    bool write(const unsigned char* data, size_t size);
+    // EOF for the reader
+    void close();
+
+    QString errorString() const { return m_error; }
+
+private:
+    bool fail(const QString& what);
+
+    int m_read = -1;
+    int m_write = -1;
+    QString m_error;
+};
+
+#endif
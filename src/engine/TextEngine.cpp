@@ -57,10 +57,13 @@ void TextEngine::render(QPainter* painter, const QSize& viewport) {
         float drawScale = 1.0f;
 
         if (el.enableBreathing) {
-            float breath = (std::sin(time + (x * 0.01f)) + 1.0f) * 0.5f;
+            // Peaks on the beat when the tracker is locked
+            float breath = m_beatLocked
+                ? (std::cos(6.2831853f * m_beatPhase) + 1.0f) * 0.5f
+                : (std::sin(time + (x * 0.01f)) + 1.0f) * 0.5f;
             int alpha = 180 + (int)(breath * 75); // 180-255
             finalColor.setAlpha(std::min(255, alpha));
-            drawScale = 1.0f + (breath * 0.02f);
+            drawScale = 1.0f + (breath * 0.02f) + (m_audioLevel * 0.05f);
         }
 
         painter->setPen(finalColor);
@@ -3,6 +3,7 @@
 #include <QPainter>
 #include <QMap>
 #include <QMutex>
+#include <algorithm>
 
 struct TextElement {
     QString id;           // Unique ID (e.g., "watermark", "artist")
@@ -42,9 +43,18 @@ public:
     void setGlobalScale(float scale) { m_globalScale = scale; }
     void setDpiAwareness(bool enable) { m_dpiAware = enable; }
 
+    // 0..1 loudness from the shared analysis frame, drives the breathing depth
+    void setAudioLevel(float level) { m_audioLevel = std::clamp(level, 0.0f, 1.0f); }
+
+    // When locked, breathing follows the beat instead of wall-clock time
+    void setBeatPhase(float phase, bool locked) { m_beatPhase = phase; m_beatLocked = locked; }
+
 private:
     QMap<QString, TextElement> m_elements;
     float m_globalScale = 1.0f;
     bool m_dpiAware = true;
+    float m_audioLevel = 0.0f;
+    float m_beatPhase = 0.0f;
+    bool m_beatLocked = false;
     QMutex m_mutex;
 };
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include "TrackAnalyzer.h"
+#include <QAudioFormat>
+#include <QFileInfo>
+#include <QUrl>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr int kHopFrames = TrackAnalyzer::kSampleRate * TrackAnalyzer::kEnvelopeHopMs / 1000;
+
+// BS.1770 gating: 400 ms blocks (4 hops) with 75% overlap
+constexpr int kBlockHops = 4;
+constexpr double kAbsoluteGateLufs = -70.0;
+constexpr double kRelativeGateLu = -10.0;
+
+// Section detection on the envelope
+constexpr int kSectionWindowHops = 80;     // 8 s either side of a candidate
+constexpr float kSectionMinChangeDb = 3.0f;
+constexpr int kSectionMinGapHops = 150;    // 15 s
+
+double blockLoudness(double meanSquareSum) {
+    return -0.691 + 10.0 * std::log10(std::max(meanSquareSum, 1e-12));
+}
+}
+
+TrackAnalyzer::TrackAnalyzer() {
+    m_thread.setObjectName("TrackAnalyzer");
+    moveToThread(&m_thread);
+    m_thread.start(QThread::LowPriority);
+}
+
+TrackAnalyzer::~TrackAnalyzer() {
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void TrackAnalyzer::enqueue(const QString& trackPath) {
+    QMetaObject::invokeMethod(this, [this, trackPath]() { addToQueue(trackPath, false); }, Qt::QueuedConnection);
+}
+
+void TrackAnalyzer::prioritize(const QString& trackPath) {
+    QMetaObject::invokeMethod(this, [this, trackPath]() { addToQueue(trackPath, true); }, Qt::QueuedConnection);
+}
+
+void TrackAnalyzer::addToQueue(const QString& trackPath, bool front) {
+    if (trackPath == m_current || AnalysisCache::instance().contains(trackPath)) return;
+
+    m_queue.removeAll(trackPath);
+    if (front) m_queue.prepend(trackPath);
+    else m_queue.append(trackPath);
+
+    if (m_current.isEmpty()) startNext();
+}
+
+void TrackAnalyzer::startNext() {
+    m_current.clear();
+    if (m_queue.isEmpty()) return;
+    m_current = m_queue.takeFirst();
+
+    if (!m_decoder) {
+        QAudioFormat format;
+        format.setSampleFormat(QAudioFormat::Float);
+        format.setChannelCount(2);
+        format.setSampleRate(kSampleRate);
+
+        m_decoder = new QAudioDecoder(this);
+        m_decoder->setAudioFormat(format);
+        connect(m_decoder, &QAudioDecoder::bufferReady, this, &TrackAnalyzer::onBufferReady);
+        connect(m_decoder, &QAudioDecoder::finished, this, &TrackAnalyzer::onFinished);
+        connect(m_decoder, qOverload<QAudioDecoder::Error>(&QAudioDecoder::error), this, &TrackAnalyzer::onError);
+    }
+
+    // Fresh offline tracker; beats are collected straight from the signal
+    m_beats = std::make_unique<BeatDetector>(kSampleRate);
+    connect(m_beats.get(), &BeatDetector::beat, this, [this](quint64, double) {
+        m_result.beatsMs.append(static_cast<quint32>(m_beats->lastBeatFrame() * 1000.0 / kSampleRate));
+    }, Qt::DirectConnection);
+
+    m_result = TrackAnalysis{};
+    m_result.envelopeHopMs = kEnvelopeHopMs;
+    m_frames = 0;
+
+    // K-weighting coefficients for 48 kHz (BS.1770-4, table 1 and 2)
+    for (int ch = 0; ch < 2; ++ch) {
+        m_shelf[ch] = Biquad{1.53512485958697, -2.69169618940638, 1.19839281085285,
+                             -1.69065929318241, 0.73248077421585};
+        m_highPass[ch] = Biquad{1.0, -2.0, 1.0, -1.99004745483398, 0.99007225036621};
+    }
+    m_weightedSum = {};
+    m_envelopeSum = 0.0;
+    m_hopFill = 0;
+    m_hopLoudness.clear();
+    m_hopDb.clear();
+
+    m_decoder->setSource(QUrl::fromLocalFile(m_current));
+    m_decoder->start();
+}
+
+void TrackAnalyzer::onBufferReady() {
+    const QAudioBuffer buffer = m_decoder->read();
+    if (!buffer.isValid()) return;
+
+    const QAudioFormat format = buffer.format();
+    if (format.sampleFormat() != QAudioFormat::Float || format.channelCount() != 2 ||
+        format.sampleRate() != kSampleRate) {
+        const QString track = m_current;
+        m_decoder->stop();
+        emit analysisFailed(track, "decoder did not convert to float stereo 48 kHz");
+        startNext();
+        return;
+    }
+
+    process(buffer.constData<float>(), static_cast<size_t>(buffer.frameCount()));
+}
+
+void TrackAnalyzer::process(const float* stereo, size_t frames) {
+    m_beats->process(stereo, frames);
+
+    for (size_t i = 0; i < frames; ++i) {
+        const double left = stereo[2 * i];
+        const double right = stereo[2 * i + 1];
+
+        const double wl = m_highPass[0].run(m_shelf[0].run(left));
+        const double wr = m_highPass[1].run(m_shelf[1].run(right));
+        m_weightedSum[0] += wl * wl;
+        m_weightedSum[1] += wr * wr;
+
+        const double mono = 0.5 * (left + right);
+        m_envelopeSum += mono * mono;
+
+        if (++m_hopFill == kHopFrames) closeEnvelopeHop();
+    }
+    m_frames += frames;
+}
+
+void TrackAnalyzer::closeEnvelopeHop() {
+    m_hopLoudness.push_back((m_weightedSum[0] + m_weightedSum[1]) / kHopFrames);
+
+    const double rms = std::sqrt(m_envelopeSum / kHopFrames);
+    const float db = std::max(kEnvelopeFloorDb, static_cast<float>(20.0 * std::log10(std::max(rms, 1e-9))));
+    m_hopDb.push_back(db);
+    m_result.envelope.append(static_cast<quint8>(std::lround((db - kEnvelopeFloorDb) / -kEnvelopeFloorDb * 255.0f)));
+
+    m_weightedSum = {};
+    m_envelopeSum = 0.0;
+    m_hopFill = 0;
+}
+
+void TrackAnalyzer::onFinished() {
+    if (m_current.isEmpty()) return;
+    finishTrack();
+    startNext();
+}
+
+void TrackAnalyzer::onError(QAudioDecoder::Error) {
+    if (m_current.isEmpty()) return;
+    const QString track = m_current;
+    const QString reason = m_decoder->errorString();
+    m_decoder->stop();
+    qWarning() << "⚠️ Track analysis failed for" << QFileInfo(track).fileName() << ":" << reason;
+    emit analysisFailed(track, reason);
+    startNext();
+}
+
+void TrackAnalyzer::finishTrack() {
+    m_result.durationMs = static_cast<qint64>(m_frames * 1000 / kSampleRate);
+    m_result.loudnessLufs = integratedLoudness();
+    m_result.sectionsMs = findSections();
+
+    // Prefer the tracker's final tempo; fall back to the median beat interval
+    m_result.bpm = static_cast<float>(m_beats->bpm());
+    if (m_result.bpm <= 0.0f && m_result.beatsMs.size() >= 2) {
+        std::vector<quint32> intervals;
+        for (qsizetype i = 1; i < m_result.beatsMs.size(); ++i) {
+            intervals.push_back(m_result.beatsMs[i] - m_result.beatsMs[i - 1]);
+        }
+        std::nth_element(intervals.begin(), intervals.begin() + intervals.size() / 2, intervals.end());
+        const quint32 median = intervals[intervals.size() / 2];
+        if (median > 0) m_result.bpm = 60000.0f / median;
+    }
+    m_beats.reset();
+
+    const QString track = m_current;
+    if (!AnalysisCache::instance().store(track, m_result)) {
+        emit analysisFailed(track, "could not write cache entry");
+        return;
+    }
+
+    qDebug() << "🔎 Analysed" << QFileInfo(track).fileName() << "-" << m_result.bpm << "BPM,"
+             << m_result.loudnessLufs << "LUFS," << m_result.beatsMs.size() << "beats,"
+             << m_result.sectionsMs.size() << "sections";
+    emit analysisReady(track);
+}
+
+float TrackAnalyzer::integratedLoudness() const {
+    std::vector<double> blocks;
+    for (size_t i = 0; i + kBlockHops <= m_hopLoudness.size(); ++i) {
+        double sum = 0.0;
+        for (int h = 0; h < kBlockHops; ++h) sum += m_hopLoudness[i + h];
+        blocks.push_back(sum / kBlockHops);
+    }
+
+    // Two-pass gating: absolute, then relative to the absolute-gated level
+    auto gatedMean = [&](double gateLufs) {
+        double sum = 0.0;
+        size_t count = 0;
+        for (double block : blocks) {
+            if (blockLoudness(block) > gateLufs) {
+                sum += block;
+                ++count;
+            }
+        }
+        return count ? sum / count : 0.0;
+    };
+
+    const double absoluteMean = gatedMean(kAbsoluteGateLufs);
+    if (absoluteMean <= 0.0) return static_cast<float>(kAbsoluteGateLufs);
+    const double relativeMean = gatedMean(blockLoudness(absoluteMean) + kRelativeGateLu);
+    if (relativeMean <= 0.0) return static_cast<float>(kAbsoluteGateLufs);
+    return static_cast<float>(blockLoudness(relativeMean));
+}
+
+QVector<quint32> TrackAnalyzer::findSections() const {
+    QVector<quint32> sections;
+    const int hops = static_cast<int>(m_hopDb.size());
+    if (hops < 2 * kSectionWindowHops) return sections;
+
+    // Prefix sums make each before/after window mean O(1)
+    std::vector<double> prefix(hops + 1, 0.0);
+    for (int i = 0; i < hops; ++i) prefix[i + 1] = prefix[i] + m_hopDb[i];
+    auto mean = [&](int from, int to) { return (prefix[to] - prefix[from]) / (to - from); };
+
+    std::vector<float> novelty(hops, 0.0f);
+    for (int i = kSectionWindowHops; i <= hops - kSectionWindowHops; ++i) {
+        novelty[i] = static_cast<float>(std::abs(mean(i, i + kSectionWindowHops) - mean(i - kSectionWindowHops, i)));
+    }
+
+    // Take the strongest peaks first, then drop any that crowd a stronger one
+    std::vector<int> candidates;
+    for (int i = 1; i + 1 < hops; ++i) {
+        if (novelty[i] >= kSectionMinChangeDb && novelty[i] >= novelty[i - 1] && novelty[i] > novelty[i + 1]) {
+            candidates.push_back(i);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [&](int a, int b) { return novelty[a] > novelty[b]; });
+
+    std::vector<int> chosen;
+    for (int c : candidates) {
+        const bool clear = std::none_of(chosen.begin(), chosen.end(),
+                                        [c](int s) { return std::abs(s - c) < kSectionMinGapHops; });
+        if (clear) chosen.push_back(c);
+    }
+    std::sort(chosen.begin(), chosen.end());
+    for (int hop : chosen) sections.append(static_cast<quint32>(hop * kEnvelopeHopMs));
+    return sections;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <QObject>
+#include <QThread>
+#include <QStringList>
+#include <QAudioDecoder>
+#include <array>
+#include <memory>
+#include <vector>
+#include "../data/AnalysisCache.h"
+#include "BeatDetector.h"
+
+// Background analysis of queued tracks into the AnalysisCache.
+//
+// Tracks are decoded with QAudioDecoder on a low-priority worker thread as
+// fast as the decoder allows, so a whole track is analysed in a fraction of
+// its play time. Per track we compute:
+//   - the beat grid, from an offline BeatDetector run
+//   - integrated loudness (ITU-R BS.1770 K-weighting with gating)
+//   - an RMS energy envelope at 100 ms resolution
+//   - section boundaries, from large sustained changes in the envelope
+//
+// Tracks that already have a valid cache entry are skipped.
+class TrackAnalyzer : public QObject {
+    Q_OBJECT
+public:
+    static TrackAnalyzer& instance() {
+        static TrackAnalyzer s;
+        return s;
+    }
+
+    static constexpr int kSampleRate = 48000;
+    static constexpr int kEnvelopeHopMs = 100;
+    static constexpr float kEnvelopeFloorDb = -60.0f;
+
+    // Any thread. Queues the track unless it is already cached or queued.
+    void enqueue(const QString& trackPath);
+    // Any thread. Moves the track to the front of the queue.
+    void prioritize(const QString& trackPath);
+
+signals:
+    void analysisReady(const QString& trackPath);
+    void analysisFailed(const QString& trackPath, const QString& reason);
+
+private:
+    TrackAnalyzer();
+    ~TrackAnalyzer();
+
+    // Worker thread
+    void addToQueue(const QString& trackPath, bool front);
+    void startNext();
+    void onBufferReady();
+    void onFinished();
+    void onError(QAudioDecoder::Error error);
+    void process(const float* stereo, size_t frames);
+    void closeEnvelopeHop();
+    void finishTrack();
+    float integratedLoudness() const;
+    QVector<quint32> findSections() const;
+
+    // Direct-form I biquad, one per channel per stage
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+        double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+        double run(double x) {
+            const double y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+            x2 = x1; x1 = x;
+            y2 = y1; y1 = y;
+            return y;
+        }
+    };
+
+    QThread m_thread;
+    QAudioDecoder* m_decoder = nullptr;
+
+    QStringList m_queue;
+    QString m_current;
+
+    // Per-track state, reset in startNext()
+    std::unique_ptr<BeatDetector> m_beats;
+    TrackAnalysis m_result;
+    quint64 m_frames = 0;
+    std::array<Biquad, 2> m_shelf{};     // K-weighting stage 1 (high shelf)
+    std::array<Biquad, 2> m_highPass{};  // K-weighting stage 2 (RLB high-pass)
+    std::array<double, 2> m_weightedSum{};
+    double m_envelopeSum = 0.0;
+    int m_hopFill = 0;
+    std::vector<double> m_hopLoudness;   // Per 100 ms: sum of channel mean squares (K-weighted)
+    std::vector<float> m_hopDb;          // Per 100 ms: unweighted RMS in dBFS
+};
@@ -0,0 +1,214 @@
+#include "TrackDecoder.h"
+#include <QAudioFormat>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QUrl>
+#include <QDebug>
+#include <algorithm>
+
+TrackDecoder::TrackDecoder(QObject* parent)
+    : QObject(parent)
+    , m_ring(static_cast<size_t>(kBufferSeconds) * kSampleRate * kChannels) {
+    QAudioFormat format;
+    format.setSampleFormat(QAudioFormat::Float);
+    format.setChannelCount(kChannels);
+    format.setSampleRate(kSampleRate);
+
+    m_decoder = new QAudioDecoder(this);
+    m_decoder->setAudioFormat(format);
+    connect(m_decoder, &QAudioDecoder::bufferReady, this, &TrackDecoder::pump);
+    connect(m_decoder, &QAudioDecoder::finished, this, [this]() {
+        m_decoderDone = true;
+        pump();
+    });
+    connect(m_decoder, qOverload<QAudioDecoder::Error>(&QAudioDecoder::error), this, [this](QAudioDecoder::Error) {
+        const quint32 generation = m_generation.load(std::memory_order_relaxed);
+        qWarning() << "⚠️ Decoder error:" << m_decoder->errorString();
+        emit failed(generation, m_decoder->errorString());
+        // Let the output move on as if the track had ended
+        m_decoder->stop();
+        m_pending = QAudioBuffer();
+        finish();
+    });
+    connect(m_decoder, &QAudioDecoder::durationChanged, this, [this](qint64 duration) {
+        m_durationMs.store(duration, std::memory_order_relaxed);
+        emit durationChanged(m_generation.load(std::memory_order_relaxed), duration);
+    });
+
+    // Retries the write while the ring is full or the reader has not flushed yet
+    m_retryTimer = new QTimer(this);
+    m_retryTimer->setSingleShot(true);
+    m_retryTimer->setInterval(10);
+    connect(m_retryTimer, &QTimer::timeout, this, &TrackDecoder::pump);
+}
+
+void TrackDecoder::open(const QString& filePath, qint64 startMs, quint32 generation) {
+    m_decoder->stop();
+    m_retryTimer->stop();
+    m_pending = QAudioBuffer();
+    m_pendingOffset = 0;
+    m_decoderDone = false;
+
+    // QAudioDecoder cannot seek, so an offset is reached by decoding and
+    // dropping frames. That is still much faster than real time.
+    const quint64 startFrame = static_cast<quint64>(std::max<qint64>(0, startMs)) * kSampleRate / 1000;
+    m_skipFrames = startFrame;
+    m_startFrame.store(startFrame, std::memory_order_relaxed);
+    m_durationMs.store(0, std::memory_order_relaxed);
+    m_finished.store(false, std::memory_order_relaxed);
+    // Publishing the generation last tells the reader to drop the old data
+    m_generation.store(generation, std::memory_order_release);
+
+    m_decoder->setSource(QUrl::fromLocalFile(filePath));
+    m_decoder->start();
+}
+
+void TrackDecoder::close(quint32 generation) {
+    m_decoder->stop();
+    m_retryTimer->stop();
+    m_pending = QAudioBuffer();
+    m_decoderDone = true;
+    m_finished.store(false, std::memory_order_relaxed);
+    m_generation.store(generation, std::memory_order_release);
+}
+
+bool TrackDecoder::flushed() const {
+    return m_readerGeneration.load(std::memory_order_acquire) == m_generation.load(std::memory_order_relaxed);
+}
+
+void TrackDecoder::pump() {
+    while (true) {
+        if (!m_pending.isValid()) {
+            if (!m_decoder->bufferAvailable()) break;
+            m_pending = m_decoder->read();
+            m_pendingOffset = 0;
+            if (!m_pending.isValid()) continue;
+
+            const QAudioFormat format = m_pending.format();
+            if (format.sampleFormat() != QAudioFormat::Float || format.channelCount() != kChannels ||
+                format.sampleRate() != kSampleRate) {
+                emit failed(m_generation.load(std::memory_order_relaxed),
+                            "decoder did not convert to float stereo 48 kHz");
+                m_decoder->stop();
+                m_pending = QAudioBuffer();
+                finish();
+                return;
+            }
+        }
+
+        const float* samples = m_pending.constData<float>();
+        const qsizetype frames = m_pending.frameCount();
+
+        if (m_skipFrames > 0) {
+            const qsizetype skip = static_cast<qsizetype>(std::min<quint64>(m_skipFrames, frames - m_pendingOffset));
+            m_pendingOffset += skip;
+            m_skipFrames -= static_cast<quint64>(skip);
+        }
+
+        if (m_pendingOffset < frames) {
+            // Nothing is written until the reader has dropped the previous track
+            if (!flushed()) {
+                m_retryTimer->start();
+                return;
+            }
+            const size_t room = m_ring.writeAvailable() / kChannels;
+            const size_t n = std::min(room, static_cast<size_t>(frames - m_pendingOffset));
+            m_ring.write(samples + m_pendingOffset * kChannels, n * kChannels);
+            m_pendingOffset += static_cast<qsizetype>(n);
+            if (m_pendingOffset < frames) {
+                m_retryTimer->start();
+                return;
+            }
+        }
+        m_pending = QAudioBuffer();
+    }
+
+    if (m_decoderDone && !m_finished.load(std::memory_order_relaxed)) finish();
+}
+
+void TrackDecoder::finish() {
+    m_decoderDone = true;
+    m_finished.store(true, std::memory_order_release);
+    emit decodingFinished(m_generation.load(std::memory_order_relaxed));
+}
+
+void TrackDecoder::acknowledge() {
+    const quint32 generation = m_generation.load(std::memory_order_acquire);
+    if (m_readerGeneration.load(std::memory_order_relaxed) == generation) return;
+
+    m_ring.discard(m_ring.readAvailable());
+    m_framesRead.store(0, std::memory_order_relaxed);
+    m_readerGeneration.store(generation, std::memory_order_release);
+}
+
+size_t TrackDecoder::read(float* dst, size_t maxFrames) {
+    if (m_readerGeneration.load(std::memory_order_relaxed) != m_generation.load(std::memory_order_acquire)) {
+        return 0;
+    }
+    const size_t frames = std::min(maxFrames, m_ring.readAvailable() / kChannels);
+    const size_t n = m_ring.read(dst, frames * kChannels) / kChannels;
+    m_framesRead.fetch_add(n, std::memory_order_relaxed);
+    return n;
+}
+
+bool TrackDecoder::isReady() const {
+    const quint32 generation = m_generation.load(std::memory_order_acquire);
+    if (generation == 0 || m_readerGeneration.load(std::memory_order_relaxed) != generation) return false;
+    return m_ring.readAvailable() > 0 || m_finished.load(std::memory_order_acquire);
+}
+
+bool TrackDecoder::atEnd() const {
+    const quint32 generation = m_generation.load(std::memory_order_acquire);
+    if (m_readerGeneration.load(std::memory_order_relaxed) != generation) return false;
+    return m_finished.load(std::memory_order_acquire) && m_ring.readAvailable() == 0;
+}
+
+bool TrackDecoder::decodeFile(const QString& filePath, std::vector<float>& pcm, size_t maxFrames, QString* error,
+                              quint64 skipFrames) {
+    QAudioFormat format;
+    format.setSampleRate(kSampleRate);
+    format.setChannelCount(kChannels);
+    format.setSampleFormat(QAudioFormat::Float);
+
+    QAudioDecoder decoder;
+    decoder.setAudioFormat(format);
+    decoder.setSource(QUrl::fromLocalFile(QFileInfo(filePath).absoluteFilePath()));
+
+    QEventLoop loop;
+    QString failure;
+    pcm.clear();
+    QObject::connect(&decoder, &QAudioDecoder::bufferReady, &loop, [&]() {
+        const QAudioBuffer buffer = decoder.read();
+        const QAudioFormat bufferFormat = buffer.format();
+        if (bufferFormat.sampleFormat() != QAudioFormat::Float || bufferFormat.channelCount() != kChannels ||
+            bufferFormat.sampleRate() != kSampleRate) {
+            failure = "decoder did not convert to float stereo 48 kHz";
+            loop.quit();
+            return;
+        }
+        const float* data = buffer.constData<float>();
+        size_t available = size_t(buffer.frameCount());
+        // No seeking in QAudioDecoder; what comes before the start is decoded and dropped
+        const size_t skip = size_t(std::min<quint64>(skipFrames, available));
+        skipFrames -= skip;
+        data += skip * kChannels;
+        available -= skip;
+        const size_t frames = std::min(available, maxFrames - pcm.size() / kChannels);
+        pcm.insert(pcm.end(), data, data + frames * kChannels);
+        if (pcm.size() >= maxFrames * kChannels) loop.quit();
+    });
+    QObject::connect(&decoder, &QAudioDecoder::finished, &loop, &QEventLoop::quit);
+    QObject::connect(&decoder, qOverload<QAudioDecoder::Error>(&QAudioDecoder::error), &loop, [&]() {
+        failure = decoder.errorString();
+        loop.quit();
+    });
+    decoder.start();
+    loop.exec();
+    decoder.stop();
+
+    if (pcm.empty() || !failure.isEmpty()) {
+        *error = failure.isEmpty() ? QString("no audio decoded") : failure;
+        return false;
+    }
+    return true;
+}
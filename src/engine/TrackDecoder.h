@@ -0,0 +1,81 @@
+#pragma once
+#include <QObject>
+#include <QAudioDecoder>
+#include <QAudioBuffer>
+#include <QTimer>
+#include <atomic>
+#include <vector>
+#include "../core/SpscRingBuffer.h"
+
+// Decodes one track ahead of the audio output into a bounded ring.
+//
+// open()/close() run on the decoder's own thread. The audio output thread is
+// the single reader. Each open() carries a generation number chosen by the
+// caller; the reader discards whatever belongs to an older generation before
+// it reads, and the writer holds new data back until that has happened, so
+// the ring never mixes two tracks.
+//
+// Decoding runs ahead by at most kBufferSeconds and then blocks on the ring,
+// which is what lets AudioEngine pre-roll the next track while the current
+// one is still playing its tail.
+class TrackDecoder : public QObject {
+    Q_OBJECT
+public:
+    explicit TrackDecoder(QObject* parent = nullptr);
+
+    static constexpr int kChannels = 2;
+    static constexpr int kSampleRate = 48000;
+    static constexpr int kBufferSeconds = 8;
+
+    // Decodes filePath in one go into interleaved stereo at kSampleRate,
+    // skipping the first skipFrames and stopping after maxFrames. Runs a
+    // local event loop, so any thread with none running. False with error
+    // set if nothing could be decoded.
+    static bool decodeFile(const QString& filePath, std::vector<float>& pcm, size_t maxFrames, QString* error,
+                           quint64 skipFrames = 0);
+
+    // Decoder thread (invoke queued)
+    void open(const QString& filePath, qint64 startMs, quint32 generation);
+    void close(quint32 generation);
+
+    // Audio thread. acknowledge() must run every cycle, even while the
+    // decoder is not being read, or a newly opened track never starts.
+    void acknowledge();
+    size_t read(float* dst, size_t maxFrames);
+    bool isReady() const;   // Has data (or is finished) for its current generation
+    bool atEnd() const;     // Finished decoding and fully read
+
+    // Any thread
+    quint32 generation() const { return m_generation.load(std::memory_order_acquire); }
+    quint64 startFrame() const { return m_startFrame.load(std::memory_order_relaxed); }
+    quint64 framesRead() const { return m_framesRead.load(std::memory_order_relaxed); }
+    qint64 durationMs() const { return m_durationMs.load(std::memory_order_relaxed); }
+    bool isDecodingFinished() const { return m_finished.load(std::memory_order_acquire); }
+
+signals:
+    void decodingFinished(quint32 generation);
+    void durationChanged(quint32 generation, qint64 durationMs);
+    void failed(quint32 generation, const QString& reason);
+
+private:
+    void pump();
+    void finish();
+    bool flushed() const;
+
+    QAudioDecoder* m_decoder = nullptr;
+    QTimer* m_retryTimer = nullptr;
+    SpscRingBuffer<float> m_ring;
+
+    // Writer state (decoder thread)
+    QAudioBuffer m_pending;          // Decoded but not yet written
+    qsizetype m_pendingOffset = 0;   // Frames of m_pending already written
+    quint64 m_skipFrames = 0;        // Still to drop when opened at an offset
+    bool m_decoderDone = false;
+
+    std::atomic<quint32> m_generation{0};
+    std::atomic<quint32> m_readerGeneration{0};
+    std::atomic<bool> m_finished{false};
+    std::atomic<quint64> m_startFrame{0};
+    std::atomic<quint64> m_framesRead{0};
+    std::atomic<qint64> m_durationMs{0};
+};
@@ -1,56 +1,270 @@
 #include "VideoRecorder.h"
 #include "../core/StringUtils.h"
+#include "LibavEncoder.h"
+#include "ReplayBuffer.h"
+#include "FrameScaler.h"
+#include "PcmSplitter.h"
+#include "../data/SettingsManager.h"
+#include <QFileInfo>
 #include <QStandardPaths>
+#include <QtConcurrent>
 #include <QDebug>
+#include <algorithm>
 
-VideoRecorder::VideoRecorder(QObject* parent) : QObject(parent) {
-    m_ffmpeg = new QProcess(this);
-    m_cmdTemplate = "ffmpeg -y -f rawvideo -vcodec rawvideo -pix_fmt bgra -s {WIDTH}x{HEIGHT} -r {FPS} -i - -c:v libx264 -preset ultrafast -crf 18 {OUTPUT}";
+VideoRecorder::VideoRecorder(QObject* parent) : QObject(parent), m_feed(masterFeed()) {
+    m_cmdTemplate = "ffmpeg -y -f rawvideo -vcodec rawvideo -pix_fmt {PIX_FMT} -s {WIDTH}x{HEIGHT} -r {FPS} -i - -c:v libx264 -preset ultrafast -crf 18 -colorspace bt709 -color_primaries bt709 -color_trc bt709 -color_range tv {OUTPUT}";
 }
 
-bool VideoRecorder::start(const QString& songTitle) {
-    if (m_isRecording) return false;
-
+QString VideoRecorder::outputPath(const QString& songTitle, const QString& extension) const {
     // USE UTILITY
     QString safeTitle = StringUtils::safeFilename(songTitle); 
     if (safeTitle.isEmpty()) safeTitle = "UnknownTrack";
-    
+
     QString timestamp = QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss");
-    QString filename = QString("%1/%2_%3.mp4").arg(QStandardPaths::writableLocation(QStandardPaths::MoviesLocation), safeTitle, timestamp);
+    return QString("%1/%2_%3.%4").arg(QStandardPaths::writableLocation(QStandardPaths::MoviesLocation), safeTitle, timestamp, extension);
+}
+
+void VideoRecorder::configure() {
+    // The renderer composes frames at exactly this size; encoders want it even
+    const SettingsManager& settings = SettingsManager::instance();
+    const QSize size = settings.getRecordingSize();
+    m_size = QSize(std::max(2, size.width() & ~1), std::max(2, size.height() & ~1));
+    m_fps = std::max(1, settings.getRecordingFps());
+    // Every queued frame holds a pooled readback buffer; the pool grows to
+    // match (framesHeld()), within reason
+    m_queueFrames = std::clamp(settings.getRecordingQueueFrames(), 1, 30);
+    m_policy = EncoderFeed::policyFromString(settings.getRecordingFullQueuePolicy());
+    m_renditions = settings.getRecordingRenditions();
+}
+
+bool VideoRecorder::start(const QString& songTitle) {
+    if (m_isRecording) return false;
+
+    // MP4 has no place for plain PCM; QuickTime does
+    const QString audioCodec = SettingsManager::instance().getRecordingAudioCodec();
+    configure();
+    return open(outputPath(songTitle, audioCodec == "pcm" ? "mov" : "mp4"), nullptr);
+}
+
+bool VideoRecorder::startRender(const QString& path, const QSize& size, int fps, std::shared_ptr<PcmSource> audio,
+                                const QString& audioCodec, const QList<QSize>& renditions) {
+    if (m_isRecording) return false;
+
+    configure();
+    m_renditions = renditions;
+    m_size = QSize(std::max(2, size.width() & ~1), std::max(2, size.height() & ~1));
+    m_fps = std::max(1, fps);
+    // Rendering waits for the encoder instead of losing frames
+    m_queueFrames = ReadbackRing::kPoolFrames - 2;
+    m_policy = EncoderFeed::Policy::Block;
+    return open(path, std::move(audio), audioCodec);
+}
+
+bool VideoRecorder::open(const QString& filename, std::shared_ptr<PcmSource> audioSource, const QString& codec) {
+    // Renditions a crop of the master can give without scaling up
+    QList<QSize> renditions;
+    for (const QSize& requested : std::as_const(m_renditions)) {
+        const QSize size(std::max(2, requested.width() & ~1), std::max(2, requested.height() & ~1));
+        if (size == m_size || renditions.contains(size)) continue;
+        if (size.width() > m_size.width() || size.height() > m_size.height()) {
+            qWarning() << "⚠️ Skipping rendition" << size << "larger than the recording" << m_size;
+            continue;
+        }
+        renditions << size;
+    }
+
+    // Every feed reads the audio through a branch of its own
+    std::shared_ptr<PcmSplitter> splitter;
+    if (!renditions.isEmpty()) {
+        splitter = std::make_shared<PcmSplitter>(audioSource ? std::move(audioSource) : EncoderFeed::recorderTap());
+        audioSource = splitter->branch();
+    }
+    m_feed = masterFeed();
+    m_renditionFeeds.clear();
+    if (!startFeed(*m_feed, filename, m_size, std::move(audioSource), codec)) return false;
+
+    for (const QSize& size : std::as_const(renditions)) {
+        const QFileInfo master(filename);
+        const QString path = master.dir().filePath(QString("%1_%2x%3.%4").arg(master.completeBaseName())
+                                                       .arg(size.width()).arg(size.height()).arg(master.suffix()));
+        auto feed = std::make_shared<EncoderFeed>();
+        if (startFeed(*feed, path, size, splitter->branch(), codec)) {
+            qDebug() << "🎬 Rendition" << size << "to" << path;
+            m_renditionFeeds.push_back(std::move(feed));
+        } else {
+            qWarning() << "⚠️ Rendition" << size << "did not start; recording without it";
+        }
+    }
+    publishOutputs();
+    m_isRecording = true;
+    return true;
+}
+
+bool VideoRecorder::startFeed(EncoderFeed& feed, const QString& filename, const QSize& size,
+                              std::shared_ptr<PcmSource> audioSource, const QString& codec) {
+    const SettingsManager& settings = SettingsManager::instance();
+    const QString audioCodec = codec.isEmpty() ? settings.getRecordingAudioCodec() : codec;
+    // Renditions get the master frames and scale them on their own writer thread
+    auto scaled = [this, &size](std::unique_ptr<FrameEncoder> encoder) -> std::unique_ptr<FrameEncoder> {
+        if (size == m_size) return encoder;
+        return std::make_unique<ScaledEncoder>(std::move(encoder), size);
+    };
 
     // Setup FFmpeg with template
-    QStringList args;
     // Parse template for placeholders
     QString cmd = m_cmdTemplate;
     cmd.replace("{OUTPUT}", filename);
-    cmd.replace("{WIDTH}", "1920");
-    cmd.replace("{HEIGHT}", "1080");
-    cmd.replace("{FPS}", "60");
-    
+    cmd.replace("{WIDTH}", QString::number(size.width()));
+    cmd.replace("{HEIGHT}", QString::number(size.height()));
+    cmd.replace("{FPS}", QString::number(m_fps));
+    // Templates that ask for {PIX_FMT} get I420 from our converter; older
+    // ones spelling out bgra still get the captured pixels as they are
+    const ProcessEncoder::Input input = cmd.contains("{PIX_FMT}") ? ProcessEncoder::Input::I420
+                                                                  : ProcessEncoder::Input::Bgra;
+    cmd.replace("{PIX_FMT}", "yuv420p");
+
+#ifdef VIBESYNC_LIBAV_ENCODER
+    if (!codec.isEmpty() || settings.getRecordingBackend() == "libav") {
+        const QString audio = audioCodec == "none" ? QString() : audioCodec;
+        if (feed.start(scaled(std::make_unique<LibavEncoder>(filename, size, m_fps, audio)), m_queueFrames, m_policy,
+                       audioSource)) {
+            return true;
+        }
+        // A codec asked for explicitly is not one the command can give
+        if (!codec.isEmpty()) return false;
+        qWarning() << "⚠️ In-process encoder unavailable, falling back to the ffmpeg command";
+    }
+#else
+    Q_UNUSED(audioSource);
+    if (!codec.isEmpty() && codec != "none") {
+        qWarning() << "❌ Encoding" << codec << "audio needs the in-process encoder, which this build lacks";
+        return false;
+    }
+#endif
+
+    // The pipe carries a single stream, so these recordings stay silent
+    if (audioCodec != "none") qDebug() << "🎬 Recording through the ffmpeg command: video only";
+
     // Split command into arguments
     QStringList argParts = cmd.split(" ", Qt::SkipEmptyParts);
     if (!argParts.isEmpty()) {
         QString program = argParts.takeFirst();
-        m_ffmpeg->start(program, argParts);
-        m_isRecording = m_ffmpeg->waitForStarted();
-        return m_isRecording;
+        return feed.start(scaled(std::make_unique<ProcessEncoder>(program, argParts, input)), m_queueFrames, m_policy);
     }
     
     return false;
 }
 
+bool VideoRecorder::startReplayBuffer() {
+    if (m_isRecording) return false;
+#ifdef VIBESYNC_LIBAV_ENCODER
+    const SettingsManager& settings = SettingsManager::instance();
+    configure();
+    const QString audioCodec = settings.getRecordingAudioCodec();
+    const double seconds = std::max(1.0, settings.getReplaySeconds());
+    const qint64 maxBytes = qint64(std::max(16, settings.getReplayMaxMegabytes())) * 1024 * 1024;
+
+    // Clips come at the recording size only
+    m_feed = masterFeed();
+    m_renditionFeeds.clear();
+    auto replay = std::make_shared<ReplayBuffer>(seconds, maxBytes);
+    const QString audio = audioCodec == "none" ? QString() : audioCodec;
+    // Dropping frames would leave holes in every clip; duplicates are harmless
+    if (!m_feed->start(std::make_unique<ReplayEncoder>(replay, m_size, m_fps, audio), m_queueFrames,
+                       EncoderFeed::Policy::DuplicateLast)) {
+        return false;
+    }
+    m_replay = std::move(replay);
+    publishOutputs();
+    m_isRecording = true;
+    qDebug() << "⏪ Replay buffer running:" << seconds << "s, at most" << maxBytes / (1024 * 1024) << "MB";
+    return true;
+#else
+    qWarning() << "⚠️ The replay buffer needs the in-process encoder (built without FFmpeg libraries)";
+    return false;
+#endif
+}
+
+void VideoRecorder::saveReplay(const QString& songTitle) {
+#ifdef VIBESYNC_LIBAV_ENCODER
+    if (!m_replay) return;
+    const QString extension = SettingsManager::instance().getRecordingAudioCodec() == "pcm" ? "mov" : "mp4";
+    const QString path = outputPath(songTitle + "_replay", extension);
+
+    // Muxing a few hundred MB takes a moment; the buffer keeps filling meanwhile
+    std::shared_ptr<ReplayBuffer> replay = m_replay;
+    QtConcurrent::run([this, replay, path]() {
+        QString error;
+        const double seconds = replay->seconds();
+        const bool ok = replay->save(path, &error);
+        if (ok) qDebug() << "⏪ Saved" << seconds << "s replay to" << path;
+        else qWarning() << "❌ Could not save the replay:" << error;
+        QMetaObject::invokeMethod(this, [this, path, ok]() { emit replaySaved(path, ok); }, Qt::QueuedConnection);
+    });
+#else
+    Q_UNUSED(songTitle);
+#endif
+}
+
 void VideoRecorder::stop() {
     if (!m_isRecording) return;
-    m_ffmpeg->closeWriteChannel(); // Tells ffmpeg EOF
-    m_ffmpeg->waitForFinished();
     m_isRecording = false;
+    // A frame the render thread is pushing right now lands in a stopping
+    // feed, which ignores it
+    m_outputs.store(nullptr, std::memory_order_release);
+    m_feed->stop(); // Drains the queue, then finalizes the file
+    for (auto& feed : m_renditionFeeds) feed->stop();
+    m_replay.reset();
+    const EncoderFeed::Stats stats = m_feed->stats();
+    qDebug() << "🎬 Recording stopped:" << stats.written << "frames written," << stats.dropped << "dropped,"
+             << stats.duplicated << "duplicated," << stats.audioLost << "audio frames lost";
+    for (const EncoderFeed::Stats& rendition : renditionStats()) {
+        qDebug() << "🎬   rendition:" << rendition.written << "frames written," << rendition.dropped << "dropped,"
+                 << rendition.duplicated << "duplicated";
+    }
 }
 
-void VideoRecorder::writeFrame(const QImage& img) {
-    if (!m_isRecording) return;
-    // Ensure size matches
-    QImage scaled = img.scaled(1920, 1080, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-    // Convert to format expected by ffmpeg
-    QImage raw = scaled.convertToFormat(QImage::Format_ARGB32);
-    m_ffmpeg->write((const char*)raw.bits(), raw.sizeInBytes());
-}
\ No newline at end of file
+void VideoRecorder::onEncoderFailed(const QString& error) {
+    // Stale if that recording was stopped, and maybe another started, meanwhile
+    if (!hasFailed()) return;
+    stop();
+    emit recordingFailed(error);
+}
+
+int VideoRecorder::framesHeld() const {
+    return int(1 + m_renditionFeeds.size()) * (m_queueFrames + 1);
+}
+
+std::vector<EncoderFeed::Stats> VideoRecorder::renditionStats() const {
+    std::vector<EncoderFeed::Stats> stats;
+    for (const auto& feed : m_renditionFeeds) stats.push_back(feed->stats());
+    return stats;
+}
+
+void VideoRecorder::writeFrame(const VideoFramePtr& frame) {
+    const std::shared_ptr<const Outputs> outputs = m_outputs.load(std::memory_order_acquire);
+    if (!outputs) return;
+    // Frames requested before recording started (or at another size) are
+    // still in flight for a moment; they don't belong in this stream
+    if (frame->size != outputs->size) return;
+    // Each rendition queues the same frame; its own queue absorbs (or drops
+    // for) a slow encoder without holding up the others
+    for (const auto& feed : outputs->feeds) feed->push(frame);
+}
+
+std::shared_ptr<EncoderFeed> VideoRecorder::masterFeed() {
+    auto feed = std::make_shared<EncoderFeed>();
+    // Renditions just stop on their own; the recording goes on without them
+    feed->setFailureHandler([this](const QString& error) {
+        QMetaObject::invokeMethod(this, [this, error]() { onEncoderFailed(error); }, Qt::QueuedConnection);
+    });
+    return feed;
+}
+
+void VideoRecorder::publishOutputs() {
+    auto outputs = std::make_shared<Outputs>();
+    outputs->size = m_size;
+    outputs->feeds.push_back(m_feed);
+    outputs->feeds.insert(outputs->feeds.end(), m_renditionFeeds.begin(), m_renditionFeeds.end());
+    m_outputs.store(std::move(outputs), std::memory_order_release);
+}
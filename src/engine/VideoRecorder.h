@@ -1,24 +1,96 @@
 #pragma once
 #include <QObject>
-#include <QProcess>
 #include <QImage>
 #include <QDateTime>
 #include <QDir>
+#include "EncoderFeed.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class ReplayBuffer;
 
 class VideoRecorder : public QObject {
     Q_OBJECT
 public:
     explicit VideoRecorder(QObject* parent = nullptr);
     bool start(const QString& songTitle);
+    // Offline rendering: encodes to path at the given format with audio from
+    // source, and writeFrame() waits for the encoder rather than drop frames.
+    // An explicit audioCodec also means the in-process encoder, whatever the
+    // backend setting; empty takes both from the settings. renditions as
+    // for recordings, where they come from the settings.
+    bool startRender(const QString& path, const QSize& size, int fps, std::shared_ptr<PcmSource> audio,
+                     const QString& audioCodec = QString(), const QList<QSize>& renditions = {});
     void stop();
-    void writeFrame(const QImage& img);
+    // BGRA frame from the render thread's readback ring. Any thread; queues
+    // the frame for the encoder feed's writer thread.
+    void writeFrame(const VideoFramePtr& frame);
     bool isRecording() const { return m_isRecording; }
+    // The recording's encoder died; stop() is due (recordingFailed() follows
+    // when there is an event loop)
+    bool hasFailed() const { return m_isRecording && !m_feed->isRunning(); }
+    // Of the current or last recording
+    EncoderFeed::Stats stats() const { return m_feed->stats(); }
+    std::vector<EncoderFeed::Stats> renditionStats() const;
+
+    // Replay buffer mode: encodes into memory, keeping the last
+    // recording/replay_seconds, until saveReplay() writes them to a file
+    // (in the background; replaySaved() follows). Stopped by stop(), like a
+    // recording. Needs the in-process encoder.
+    bool startReplayBuffer();
+    bool isReplayBuffer() const { return m_replay != nullptr; }
+    void saveReplay(const QString& songTitle);
+    // Output format, from the settings when recording started
+    QSize frameSize() const { return m_size; }
+    int fps() const { return m_fps; }
+    // Readback frames the outputs may hold at once: every queue full and
+    // every writer thread with one in hand. The readback pool needs more.
+    int framesHeld() const;
     
     void setCommandTemplate(const QString& cmd) { m_cmdTemplate = cmd; }
     QString getCommandTemplate() const { return m_cmdTemplate; }
 
+signals:
+    void replaySaved(const QString& path, bool ok);
+    // The encoder stopped taking frames; the recording is already stopped
+    void recordingFailed(const QString& error);
+
 private:
-    QProcess* m_ffmpeg = nullptr;
-    bool m_isRecording = false;
+    QString outputPath(const QString& songTitle, const QString& extension) const;
+    // Size, fps, queue depth, policy and renditions from the settings
+    void configure();
+    // Starts the feeds with the configured format, one for the file and one
+    // per rendition (next to it, named after its size); audio null for the
+    // recorder tap, audioCodec empty for the settings' codec and backend
+    bool open(const QString& filename, std::shared_ptr<PcmSource> audio, const QString& audioCodec = QString());
+    // One output at size, scaled from the frames at m_size when it differs
+    bool startFeed(EncoderFeed& feed, const QString& filename, const QSize& size, std::shared_ptr<PcmSource> audio,
+                   const QString& audioCodec);
+    void onEncoderFailed(const QString& error);
+    // A new feed for the recording itself, reporting its failure
+    std::shared_ptr<EncoderFeed> masterFeed();
+    // Hands writeFrame() the outputs of the recording that just started
+    void publishOutputs();
+
+    // What writeFrame() pushes to. Replaced as a whole, never changed, so
+    // the render thread can keep using one while the GUI thread stops the
+    // recording or starts the next.
+    struct Outputs {
+        QSize size;
+        std::vector<std::shared_ptr<EncoderFeed>> feeds;    // The master first
+    };
+
+    std::shared_ptr<EncoderFeed> m_feed;
+    // Extra outputs from the same readback, each with its own queue and writer thread
+    std::vector<std::shared_ptr<EncoderFeed>> m_renditionFeeds;
+    std::atomic<std::shared_ptr<const Outputs>> m_outputs;
+    QList<QSize> m_renditions;
+    std::shared_ptr<ReplayBuffer> m_replay;
+    std::atomic<bool> m_isRecording{false};
     QString m_cmdTemplate;
+    QSize m_size{1920, 1080};
+    int m_fps = 60;
+    int m_queueFrames = 4;
+    EncoderFeed::Policy m_policy = EncoderFeed::Policy::DuplicateLast;
 };
\ No newline at end of file
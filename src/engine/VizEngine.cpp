@@ -1,5 +1,11 @@
 #include "VizEngine.h"
+#include "AudioEngine.h"
+#include "SpectrumAnalyzer.h"
+#include "ShaderCache.h"
 #include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
 
 VizEngine::VizEngine(QObject* parent) : QObject(parent) {}
 
@@ -17,31 +23,44 @@ void VizEngine::cleanup() {
 }
 
 void VizEngine::loadPreset(const QString& presetPath) {
-    if (m_handle && QFile::exists(presetPath)) {
-        projectm_load_preset_data(m_handle, presetPath.toStdString().c_str(), nullptr);
-        m_currentPreset = presetPath;
+    if (m_handle && applyPreset(presetPath)) {
         emit presetLoaded(presetPath);
         qDebug() << "👁️ Loaded preset:" << QFileInfo(presetPath).fileName();
     }
 }
 
+bool VizEngine::applyPreset(const QString& presetPath) {
+    // projectm_load_preset_data() takes the preset text, not a file name
+    QFile file(presetPath);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    const QByteArray data = file.readAll();
+
+    projectm_load_preset_data(m_handle, data.constData(), false);
+    m_currentPreset = presetPath;
+    return true;
+}
+
 void VizEngine::setMeshSize(int x, int y) {
     if (m_handle) {
-        // Note: This might require reinitialization for full effect
+        // projectM rebuilds the warp grid in place; the handle stays
+        projectm_set_mesh_size(m_handle, x, y);
         qDebug() << "🔧 Mesh size changed to" << x << "x" << y;
     }
 }
 
 void VizEngine::setFPS(int fps) {
     if (m_handle) {
+        projectm_set_fps(m_handle, fps);
         qDebug() << "🎯 FPS changed to" << fps;
     }
 }
 
 void VizEngine::setBeatSensitivity(float sensitivity) {
+    SpectrumAnalyzer::instance().beats().setSensitivity(sensitivity);
     if (m_handle) {
-        qDebug() << "🎵 Beat sensitivity changed to" << sensitivity;
+        projectm_set_beat_sensitivity(m_handle, sensitivity);
     }
+    qDebug() << "🎵 Beat sensitivity changed to" << sensitivity;
 }
 
 void VizEngine::setSmoothDuration(float duration) {
@@ -50,8 +69,69 @@ void VizEngine::setSmoothDuration(float duration) {
     }
 }
 
+void VizEngine::consumeAudio(quint64 untilStreamFrame) {
+    if (!m_handle) return;
+
+    // Feed what the audio thread produced up to the given output frame (the
+    // one audible when this frame is shown); anything later stays queued for
+    // the next frame. The ring is lock-free, so this never waits.
+    AudioEngine& audio = AudioEngine::instance();
+    const size_t maxFrames = m_pcmScratch.size() / AudioEngine::kTapChannels;
+    while (true) {
+        const quint64 position = audio.pcmReadPosition(PcmTap::Visualizer);
+        if (position >= untilStreamFrame) break;
+
+        const size_t want = static_cast<size_t>(std::min<quint64>(maxFrames, untilStreamFrame - position));
+        const size_t frames = audio.readPcm(PcmTap::Visualizer, m_pcmScratch.data(), want);
+        if (frames == 0) break;
+        projectm_pcm_add_float(m_handle, m_pcmScratch.data(), static_cast<unsigned int>(frames), PROJECTM_STEREO);
+    }
+}
+
+void VizEngine::addPcm(const float* stereo, size_t frames) {
+    if (!m_handle) return;
+    projectm_pcm_add_float(m_handle, stereo, static_cast<unsigned int>(frames), PROJECTM_STEREO);
+}
+
+void VizEngine::renderFrame(GLuint framebuffer) {
+    if (!m_handle) return;
+#if PROJECTM_VERSION_MAJOR > 4 || (PROJECTM_VERSION_MAJOR == 4 && PROJECTM_VERSION_MINOR >= 1)
+    projectm_opengl_render_frame_fbo(m_handle, framebuffer);
+#else
+    // Older projectM always draws to the default framebuffer
+    Q_UNUSED(framebuffer);
+    projectm_opengl_render_frame(m_handle);
+#endif
+}
+
+bool VizEngine::setFrameTime(double seconds) {
+    if (!m_handle) return false;
+#if PROJECTM_VERSION_MAJOR > 4 || (PROJECTM_VERSION_MAJOR == 4 && PROJECTM_VERSION_MINOR >= 1)
+    projectm_set_frame_time(m_handle, seconds);
+    return true;
+#else
+    Q_UNUSED(seconds);
+    return false;
+#endif
+}
+
+void VizEngine::resize(int width, int height) {
+    if (m_handle) {
+        projectm_set_window_size(m_handle, width, height);
+    }
+}
+
 bool VizEngine::setupProjectM(const QString& presetPath, int meshX, int meshY, int fps) {
     if (QFile::exists(presetPath)) {
+#ifdef VIBESYNC_PROJECTM_GL_LOADER
+        // GL calls go through the shader cache, which skips relinking
+        // programs it has seen before
+        m_handle = projectm_create_with_opengl_load_proc(&ShaderCache::resolve, nullptr);
+        if (m_handle) {
+            projectm_set_mesh_size(m_handle, meshX, meshY);
+            projectm_set_fps(m_handle, fps);
+        }
+#else
         projectm_settings settings{};
         settings.meshX = meshX;
         settings.meshY = meshY;
@@ -59,9 +139,11 @@ bool VizEngine::setupProjectM(const QString& presetPath, int meshX, int meshY, i
         settings.textureSize = 2048;
         
         m_handle = projectm_create(&settings);
+#endif
         if (m_handle) {
-            projectm_load_preset_data(m_handle, presetPath.toStdString().c_str(), nullptr);
-            m_currentPreset = presetPath;
+            // One projectM PCM window worth of stereo frames per drain step
+            m_pcmScratch.assign(projectm_pcm_get_max_samples() * AudioEngine::kTapChannels, 0.0f);
+            applyPreset(presetPath);
             qDebug() << "🎨 ProjectM initialized successfully";
             return true;
         }
@@ -1,5 +1,8 @@
 #pragma once
 #include <QObject>
+#include <qopengl.h>
+#include <limits>
+#include <vector>
 #include <projectM-4/projectM.h>
 
 class VizEngine : public QObject {
@@ -18,6 +21,19 @@ public:
     void setFPS(int fps);
     void setBeatSensitivity(float sensitivity);
     void setSmoothDuration(float duration);
+
+    // Per-frame entry points, called with the GL context current.
+    // consumeAudio() feeds the visualizer tap up to (not including) the
+    // given output stream frame; by default everything available.
+    void consumeAudio(quint64 untilStreamFrame = std::numeric_limits<quint64>::max());
+    // Feeds interleaved stereo samples directly, bypassing the audio engine
+    void addPcm(const float* stereo, size_t frames);
+    // Renders into the given framebuffer object (0 = the default one)
+    void renderFrame(GLuint framebuffer = 0);
+    // Time the next frames are rendered at, instead of the wall clock, for
+    // repeatable offline renders. False when projectM is too old for it.
+    bool setFrameTime(double seconds);
+    void resize(int width, int height);
     
     bool isInitialized() const { return m_handle != nullptr; }
 
@@ -29,7 +45,9 @@ private:
     projectm_handle m_handle = nullptr;
     QString m_presetPath;
     QString m_currentPreset;
+    std::vector<float> m_pcmScratch; // Sized once, reused every frame
     
+    bool applyPreset(const QString& presetPath);
     bool setupProjectM(const QString& presetPath, int meshX, int meshY, int fps);
     void cleanupProjectM();
 };
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include "YuvConverter.h"
+#include "../core/PixelKernels.h"
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <numeric>
+
+namespace {
+// Below this many row pairs per band the hand-off costs more than it saves
+constexpr int kMinPairsPerBand = 32;
+}
+
+void YuvConverter::convert(const VideoFrame& frame, Layout layout, const Planes& planes) {
+    const PixelKernels& kernels = PixelKernels::get();
+    const int width = frame.size.width();
+    const int height = frame.size.height();
+    const int pairs = (height + 1) / 2;
+    const int chromaStep = layout == Layout::Nv12 ? 2 : 1;
+    uint8_t* const u = planes.data[1];
+    uint8_t* const v = layout == Layout::Nv12 ? planes.data[1] + 1 : planes.data[2];
+    const int uStride = planes.stride[1];
+    const int vStride = layout == Layout::Nv12 ? planes.stride[1] : planes.stride[2];
+
+    auto convertPairs = [&](int first, int last) {
+        for (int pair = first; pair < last; ++pair) {
+            const int row0 = pair * 2;
+            const int row1 = std::min(row0 + 1, height - 1);  // An odd last row pairs with itself
+            kernels.bgraToYuv420(frame.pixels.data() + size_t(row0) * frame.stride,
+                                 frame.pixels.data() + size_t(row1) * frame.stride, width,
+                                 planes.data[0] + size_t(row0) * planes.stride[0],
+                                 planes.data[0] + size_t(row1) * planes.stride[0],
+                                 u + size_t(pair) * uStride, v + size_t(pair) * vStride, chromaStep);
+        }
+    };
+
+    const int bands = std::clamp(pairs / kMinPairsPerBand, 1, QThread::idealThreadCount());
+    if (bands == 1) {
+        convertPairs(0, pairs);
+        return;
+    }
+    std::vector<int> indices(bands);
+    std::iota(indices.begin(), indices.end(), 0);
+    QtConcurrent::blockingMap(indices, [&](int band) {
+        convertPairs(pairs * band / bands, pairs * (band + 1) / bands);
+    });
+}
+
+void YuvConverter::convertI420(const VideoFrame& frame, std::vector<uchar>& out) {
+    const int width = frame.size.width();
+    const int height = frame.size.height();
+    const int chromaWidth = (width + 1) / 2;
+    const size_t lumaBytes = size_t(width) * height;
+    const size_t chromaBytes = size_t(chromaWidth) * ((height + 1) / 2);
+    out.resize(lumaBytes + 2 * chromaBytes);
+
+    Planes planes;
+    planes.data[0] = out.data();
+    planes.data[1] = out.data() + lumaBytes;
+    planes.data[2] = out.data() + lumaBytes + chromaBytes;
+    planes.stride[0] = width;
+    planes.stride[1] = chromaWidth;
+    planes.stride[2] = chromaWidth;
+    convert(frame, Layout::I420, planes);
+}
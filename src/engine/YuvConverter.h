@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "FrameReadback.h"
+
+// BGRA frames to 4:2:0 YUV for the encoder (BT.709, limited range).
+//
+// Rows are split into bands converted in parallel on the global thread
+// pool with the best PixelKernels implementation, so a 1080p frame takes a
+// fraction of a millisecond and none of it lands on the encoder itself.
+class YuvConverter {
+public:
+    enum class Layout { I420, Nv12 };
+
+    // Destination planes; for Nv12 only the first two are used
+    struct Planes {
+        uint8_t* data[3] = {};
+        int stride[3] = {};
+    };
+
+    // Blocks until the whole frame is converted
+    static void convert(const VideoFrame& frame, Layout layout, const Planes& planes);
+
+    // Packed I420 (ffmpeg's "yuv420p" rawvideo): Y, then U, then V
+    static void convertI420(const VideoFrame& frame, std::vector<uchar>& out);
+};
@@ -1,6 +1,20 @@
 #include <iostream>
 #include <string>
 #include <memory>
+#include <cstdlib>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "core/Fft.h"
+
+#ifdef QT_CORE_LIB
+#include "data/SettingsManager.h"
+#include "engine/PresetProfiler.h"
+#include "engine/OfflineRenderer.h"
+#include "engine/BatchRenderer.h"
+#include <QCoreApplication>
+#include <QGuiApplication>
+#endif
 
 // Version info
 #define VERSION "1.0.0"
@@ -43,6 +57,41 @@ void printHelp() {
     std::cout << "  -v, --version      Show version information" << std::endl;
     std::cout << "  --check-deps       Check system dependencies" << std::endl;
     std::cout << "  --build-info       Show detailed build information" << std::endl;
+    std::cout << "  --fft-size N       Spectrum analyzer FFT size (power of two, 64-65536)" << std::endl;
+    std::cout << "  --profile-presets DIR" << std::endl;
+    std::cout << "                     Render every preset in DIR offscreen and record its cost" << std::endl;
+    std::cout << "                     in the preset cost index, then exit" << std::endl;
+    std::cout << "  --profile-frames N Frames rendered per preset (default 300)" << std::endl;
+    std::cout << "  --profile-size WxH Profiling resolution (default 1280x720)" << std::endl;
+    std::cout << "  --profile-audio FILE" << std::endl;
+    std::cout << "                     Drive presets with FILE instead of synthetic audio" << std::endl;
+    std::cout << "  --render TRACK     Render TRACK to a video file as fast as possible, then exit" << std::endl;
+    std::cout << "  --out FILE         Video file written by --render or --render-segmented" << std::endl;
+    std::cout << "  --render-preset FILE" << std::endl;
+    std::cout << "                     Preset to render with (default: first of the preset directory)" << std::endl;
+    std::cout << "  --render-size WxH  Video size (default: the recording size setting)" << std::endl;
+    std::cout << "  --render-fps N     Video frame rate (default: the recording fps setting)" << std::endl;
+    std::cout << "  --render-start-frame N, --render-frame-count N" << std::endl;
+    std::cout << "                     Render only these frames of TRACK, timed as in the whole render" << std::endl;
+    std::cout << "  --render-preroll S Seconds rendered but not encoded before the first frame (default 8" << std::endl;
+    std::cout << "                     with --render-segmented, else 0)" << std::endl;
+    std::cout << "  --render-audio CODEC" << std::endl;
+    std::cout << "                     Audio codec of the video: aac, flac, pcm or none (default: the" << std::endl;
+    std::cout << "                     recording setting)" << std::endl;
+    std::cout << "  --render-renditions WxH[,WxH...]" << std::endl;
+    std::cout << "                     Also encode these sizes, centre-cropped to their aspect ratio" << std::endl;
+    std::cout << "                     (\"none\" for none; default: the recording setting)" << std::endl;
+    std::cout << "  --render-segmented TRACK" << std::endl;
+    std::cout << "                     Render one long TRACK in segments on parallel worker processes" << std::endl;
+    std::cout << "                     and join them; rerun to resume (needs the in-process encoder)" << std::endl;
+    std::cout << "  --render-batch PLAYLIST" << std::endl;
+    std::cout << "                     Render every track of an M3U playlist (or a folder) with" << std::endl;
+    std::cout << "                     parallel worker processes; rerun to resume an interrupted batch" << std::endl;
+    std::cout << "  --out-dir DIR      Where --render-batch writes videos and its job journal" << std::endl;
+    std::cout << "  --jobs N           Worker processes (default: one per 4 CPUs)" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Profiling and rendering need no GPU: with LIBGL_ALWAYS_SOFTWARE=1 they run on" << std::endl;
+    std::cout << "Mesa llvmpipe. Without a display they use the offscreen platform (under xvfb-run in CI)." << std::endl;
     std::cout << std::endl;
     std::cout << "This is a minimal build to test compilation." << std::endl;
     std::cout << "Full GUI application requires Qt6 and additional dependencies." << std::endl;
@@ -112,7 +161,38 @@ void checkDependencies() {
     std::cout << std::endl;
 }
 
+bool parseSize(const std::string& text, int& width, int& height) {
+    const size_t x = text.find('x');
+    if (x == std::string::npos) return false;
+    width = std::atoi(text.substr(0, x).c_str());
+    height = std::atoi(text.substr(x + 1).c_str());
+    return width >= 16 && height >= 16 && width <= 16384 && height <= 16384;
+}
+
 int main(int argc, char* argv[]) {
+    int fftSize = 0;
+    std::string profileDir;
+    std::string profileAudio;
+    int profileFrames = 300;
+    int profileWidth = 1280;
+    int profileHeight = 720;
+    std::string renderTrack;
+    std::string renderOut;
+    std::string renderPreset;
+    int renderFps = 0;          // 0: from the settings
+    int renderWidth = 0;
+    int renderHeight = 0;
+    std::string batchPlaylist;
+    std::string batchOutDir;
+    int batchJobs = 0;          // 0: from the CPU count
+    long long renderStartFrame = 0;
+    long long renderFrameCount = -1;    // -1: to the end
+    double renderPreroll = -1.0;        // Negative: the mode's default
+    std::string renderAudio;
+    std::string segmentTrack;
+    std::vector<std::pair<int, int>> renderRenditions;
+    std::string renditionsArg;          // Empty: from the settings
+
     // Check for help or version flags
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
@@ -130,8 +210,200 @@ int main(int argc, char* argv[]) {
             printVersion();
             checkDependencies();
             return 0;
+        } else if (arg == "--fft-size") {
+            if (i + 1 >= argc) {
+                std::cerr << "--fft-size requires a value" << std::endl;
+                return 1;
+            }
+            fftSize = std::atoi(argv[++i]);
+            if (fftSize <= 0 || !Fft::isValidSize(size_t(fftSize))) {
+                std::cerr << "Invalid FFT size: " << fftSize << " (must be a power of two between 64 and 65536)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--profile-presets" || arg == "--profile-audio" ||
+                   arg == "--profile-frames" || arg == "--profile-size") {
+            if (i + 1 >= argc) {
+                std::cerr << arg << " requires a value" << std::endl;
+                return 1;
+            }
+            const std::string value = argv[++i];
+            if (arg == "--profile-presets") {
+                profileDir = value;
+            } else if (arg == "--profile-audio") {
+                profileAudio = value;
+            } else if (arg == "--profile-frames") {
+                profileFrames = std::atoi(value.c_str());
+                if (profileFrames < 1) {
+                    std::cerr << "Invalid frame count: " << value << std::endl;
+                    return 1;
+                }
+            } else if (!parseSize(value, profileWidth, profileHeight)) {
+                std::cerr << "Invalid size: " << value << " (expected WxH, e.g. 1280x720)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--render" || arg == "--out" || arg == "--render-preset" ||
+                   arg == "--render-size" || arg == "--render-fps" ||
+                   arg == "--render-batch" || arg == "--out-dir" || arg == "--jobs" ||
+                   arg == "--render-start-frame" || arg == "--render-frame-count" ||
+                   arg == "--render-preroll" || arg == "--render-audio" || arg == "--render-segmented" ||
+                   arg == "--render-renditions") {
+            if (i + 1 >= argc) {
+                std::cerr << arg << " requires a value" << std::endl;
+                return 1;
+            }
+            const std::string value = argv[++i];
+            if (arg == "--render") {
+                renderTrack = value;
+            } else if (arg == "--out") {
+                renderOut = value;
+            } else if (arg == "--render-preset") {
+                renderPreset = value;
+            } else if (arg == "--render-batch") {
+                batchPlaylist = value;
+            } else if (arg == "--render-segmented") {
+                segmentTrack = value;
+            } else if (arg == "--render-renditions") {
+                renditionsArg = value;
+                renderRenditions.clear();
+                size_t begin = 0;
+                while (value != "none" && begin <= value.size()) {
+                    const size_t comma = std::min(value.find(',', begin), value.size());
+                    const std::string item = value.substr(begin, comma - begin);
+                    int width = 0;
+                    int height = 0;
+                    if (!parseSize(item, width, height)) {
+                        std::cerr << "Invalid rendition size: " << item << " (expected WxH, e.g. 1280x720)" << std::endl;
+                        return 1;
+                    }
+                    renderRenditions.emplace_back(width, height);
+                    begin = comma + 1;
+                }
+            } else if (arg == "--render-audio") {
+                if (value != "aac" && value != "flac" && value != "pcm" && value != "none") {
+                    std::cerr << "Invalid audio codec: " << value << " (aac, flac, pcm or none)" << std::endl;
+                    return 1;
+                }
+                renderAudio = value;
+            } else if (arg == "--render-start-frame" || arg == "--render-frame-count") {
+                const long long frames = std::atoll(value.c_str());
+                if (frames < (arg == "--render-start-frame" ? 0 : 1)) {
+                    std::cerr << "Invalid frame number: " << value << std::endl;
+                    return 1;
+                }
+                (arg == "--render-start-frame" ? renderStartFrame : renderFrameCount) = frames;
+            } else if (arg == "--render-preroll") {
+                renderPreroll = std::atof(value.c_str());
+                if (renderPreroll < 0.0 || renderPreroll > 600.0) {
+                    std::cerr << "Invalid pre-roll: " << value << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--out-dir") {
+                batchOutDir = value;
+            } else if (arg == "--jobs") {
+                batchJobs = std::atoi(value.c_str());
+                if (batchJobs < 1) {
+                    std::cerr << "Invalid job count: " << value << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--render-fps") {
+                renderFps = std::atoi(value.c_str());
+                if (renderFps < 1 || renderFps > 240) {
+                    std::cerr << "Invalid frame rate: " << value << std::endl;
+                    return 1;
+                }
+            } else if (!parseSize(value, renderWidth, renderHeight)) {
+                std::cerr << "Invalid size: " << value << " (expected WxH, e.g. 1920x1080)" << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    if (!renderTrack.empty() && !segmentTrack.empty()) {
+        std::cerr << "--render and --render-segmented are separate modes" << std::endl;
+        return 1;
+    }
+    if ((renderTrack.empty() && segmentTrack.empty()) != renderOut.empty()) {
+        std::cerr << "--render (or --render-segmented) and --out go together" << std::endl;
+        return 1;
+    }
+    if (batchPlaylist.empty() != batchOutDir.empty()) {
+        std::cerr << "--render-batch and --out-dir go together" << std::endl;
+        return 1;
+    }
+
+#ifdef QT_CORE_LIB
+    if (fftSize > 0) {
+        SettingsManager::instance().setFftSize(fftSize);
+    }
+
+    // Headless: CI machines and render boxes have no display, and offscreen
+    // surfaces are all we need
+    const bool headless = !profileDir.empty() || !renderTrack.empty() || !batchPlaylist.empty() || !segmentTrack.empty();
+    if (headless && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM") && qEnvironmentVariableIsEmpty("DISPLAY")
+        && qEnvironmentVariableIsEmpty("WAYLAND_DISPLAY")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    if (!batchPlaylist.empty() || !segmentTrack.empty()) {
+        // The scheduler draws nothing; the workers it starts are --render runs
+        QCoreApplication app(argc, argv);
+
+        BatchRenderer::Options options;
+        options.playlistPath = QString::fromStdString(batchPlaylist);
+        options.outputDirectory = QString::fromStdString(batchOutDir);
+        options.segmentTrack = QString::fromStdString(segmentTrack);
+        options.segmentOutput = QString::fromStdString(renderOut);
+        if (renderPreroll >= 0.0) options.prerollSeconds = renderPreroll;
+        options.workers = batchJobs;
+        options.presetPath = QString::fromStdString(renderPreset);
+        if (renderWidth > 0) options.size = QSize(renderWidth, renderHeight);
+        options.fps = renderFps;
+        return BatchRenderer(options).run();
+    }
+
+    if (!renderTrack.empty()) {
+        QGuiApplication app(argc, argv);
+
+        const SettingsManager& settings = SettingsManager::instance();
+        OfflineRenderer::Options options;
+        options.trackPath = QString::fromStdString(renderTrack);
+        options.outputPath = QString::fromStdString(renderOut);
+        options.presetPath = QString::fromStdString(renderPreset);
+        options.size = renderWidth > 0 ? QSize(renderWidth, renderHeight) : settings.getRecordingSize();
+        options.fps = renderFps > 0 ? renderFps : settings.getRecordingFps();
+        options.audioCodec = QString::fromStdString(renderAudio);
+        options.startFrame = renderStartFrame;
+        options.frameCount = renderFrameCount;
+        options.prerollSeconds = std::max(0.0, renderPreroll);
+        if (!renditionsArg.empty()) {
+            for (const auto& [width, height] : renderRenditions) options.renditions << QSize(width, height);
+        } else {
+            options.renditions = settings.getRecordingRenditions();
         }
+        return OfflineRenderer(options).run();
     }
+
+    if (!profileDir.empty()) {
+        QGuiApplication app(argc, argv);
+
+        PresetProfiler::Options options;
+        options.presetDirectory = QString::fromStdString(profileDir);
+        options.audioFile = QString::fromStdString(profileAudio);
+        options.frames = profileFrames;
+        options.size = QSize(profileWidth, profileHeight);
+        options.fps = SettingsManager::instance().getFPS();
+        return PresetProfiler(options).run();
+    }
+#else
+    if (!profileDir.empty()) {
+        std::cerr << "--profile-presets requires a build with Qt6 and ProjectM" << std::endl;
+        return 1;
+    }
+    if (!renderTrack.empty() || !batchPlaylist.empty() || !segmentTrack.empty()) {
+        std::cerr << "--render, --render-batch and --render-segmented require a build with Qt6 and ProjectM" << std::endl;
+        return 1;
+    }
+#endif
     
     // Default execution
     printVersion();
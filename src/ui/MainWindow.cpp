@@ -7,6 +7,8 @@
 #include "widgets/DebugConsole.h"
 #include "dialogs/SettingsDialog.h"
 #include "../engine/AudioEngine.h"
+#include "../engine/SpectrumAnalyzer.h"
+#include "../engine/TrackAnalyzer.h"
 #include "../engine/PresetManager.h"
 #include "../engine/PlaylistManager.h"
 #include "../engine/VideoRecorder.h"
@@ -22,6 +24,8 @@
 #include <QFileDialog>
 #include <QDebug>
 #include <QSettings>
+#include <algorithm>
+#include <cmath>
 
 MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
     resize(1280, 800);
@@ -42,6 +46,9 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
     
     m_viz->setRecorder(m_recorder);
 
+    SpectrumAnalyzer::instance().setFftSize(settings.getFftSize());
+    SpectrumAnalyzer::instance().start();
+
     setupUI();
     setupConnections();
 
@@ -75,8 +82,8 @@ void MainWindow::setupUI() {
     m_btnQuarantine->setStyleSheet("background-color: #550000; color: #ffaaaa; border: 1px solid red;");
     m_chkLock = new QCheckBox("Lock Preset", this);
 
-    m_btnRecord = new QPushButton("Start Recording", this);
-    m_btnRecord->setStyleSheet("background-color: #004400; color: #aaffaa;");
+    m_btnRecord = new QPushButton(this);
+    setRecordButton(false);
 
     ctrlLayout->addWidget(new QLabel("<b>Visualizer</b>"));
     ctrlLayout->addWidget(m_lblPreset);
@@ -109,10 +116,32 @@ void MainWindow::setupConnections() {
     connect(m_menu, &AppMenuBar::showSettingsRequested, this, &MainWindow::onShowSettings);
     connect(m_menu, &AppMenuBar::openFilesRequested, this, &MainWindow::onOpenFiles);
     connect(m_menu, &AppMenuBar::openFolderRequested, this, &MainWindow::onOpenFolder);
+    connect(m_menu, &AppMenuBar::savePlaylistRequested, this, &MainWindow::onSavePlaylist);
+    connect(m_menu, &AppMenuBar::replayBufferToggled, this, &MainWindow::onReplayBufferToggled);
+    connect(m_menu, &AppMenuBar::saveReplayRequested, this, &MainWindow::onSaveReplay);
+    m_menu->setSaveReplayShortcut(QKeySequence(SettingsManager::instance().getReplayHotkey()));
 
     // Playlist connections
     connect(m_playlistMgr, &PlaylistManager::currentTrackChanged, this, &MainWindow::onCurrentTrackChanged);
     connect(m_playlistMgr, &PlaylistManager::playlistChanged, this, &MainWindow::onPlaylistChanged);
+    connect(m_playlistMgr, &PlaylistManager::playbackStarted, this, [](const QString& filePath) {
+        if (AudioEngine::instance().loadFile(filePath)) {
+            AudioEngine::instance().play();
+        }
+    });
+
+    // Gapless playback: the engine pre-rolls whatever the playlist will play
+    // next and reports when it has moved on to it
+    AudioEngine& audio = AudioEngine::instance();
+    connect(m_playlistMgr, &PlaylistManager::upcomingTrackChanged, &audio, &AudioEngine::setNextFile);
+    connect(&audio, &AudioEngine::trackTransition, m_playlistMgr, &PlaylistManager::advance);
+    connect(&audio, &AudioEngine::playbackFinished, m_playlistMgr, &PlaylistManager::next);
+    connect(&TrackAnalyzer::instance(), &TrackAnalyzer::analysisReady, this, [this](const QString& filePath) {
+        // Picks up the analysis when the track finished analysing mid-play
+        if (filePath == m_playlistMgr->currentFile() && !m_trackAnalysis) {
+            m_trackAnalysis = AnalysisCache::instance().lookup(filePath);
+        }
+    });
 
     // Preset connections
     connect(m_presetMgr, &PresetManager::currentPresetChanged, this, [this](const QString& presetPath) {
@@ -128,6 +157,8 @@ void MainWindow::setupConnections() {
         
         qDebug() << "👁️ Loaded Preset:" << fi.fileName();
     });
+    connect(m_presetMgr, &PresetManager::upcomingPresetChanged, m_viz, &VisualizerView::preloadPreset);
+    m_viz->preloadPreset(m_presetMgr->upcomingPreset());
 
     // Control connections
     connect(m_btnNextPreset, &QPushButton::clicked, this, &MainWindow::onNextPreset);
@@ -136,15 +167,20 @@ void MainWindow::setupConnections() {
     connect(m_btnBlack, &QPushButton::clicked, this, &MainWindow::onToggleBlacklist);
     connect(m_btnQuarantine, &QPushButton::clicked, this, &MainWindow::onQuarantinePreset);
     connect(m_btnRecord, &QPushButton::clicked, this, &MainWindow::onRecordToggle);
-
-    // Auto-advance presets every 15 seconds (if not locked)
-    QTimer* presetTimer = new QTimer(this);
-    connect(presetTimer, &QTimer::timeout, [this]() {
-        if(!m_chkLock->isChecked()) {
-            onNextPreset();
-        }
+    // The recorder has already stopped and logged why; with a broken
+    // encoder setup the replay buffer is not restarted either
+    connect(m_recorder, &VideoRecorder::recordingFailed, this, [this]() {
+        setRecordButton(false);
+        m_replayWanted = false;
+        m_menu->setReplayBufferChecked(false);
     });
-    presetTimer->start(15000);
+
+    // Auto-advance presets every 15 seconds (if not locked). While the beat
+    // tracker has a tempo, the switch is held until the next beat.
+    m_presetTimer = new QTimer(this);
+    connect(m_presetTimer, &QTimer::timeout, this, &MainWindow::onPresetTimer);
+    m_presetTimer->start(kPresetIntervalMs);
+    connect(&SpectrumAnalyzer::instance().beats(), &BeatDetector::beat, this, &MainWindow::onBeat);
 
     // Load initial preset
     QTimer::singleShot(1000, this, [this]() {
@@ -160,6 +196,7 @@ void MainWindow::onShowSettings() {
         m_viz->textEngine()->setGlobalScale(settings.getGlobalScale());
         m_viz->textEngine()->setVisible("watermark", settings.getShowWatermark());
         m_viz->textEngine()->updateText("watermark", settings.getWatermarkText());
+        m_viz->applySettings();
         
         qDebug() << "⚙️ Settings applied. Some changes may require restart.";
     }
@@ -189,24 +226,70 @@ void MainWindow::onOpenFolder() {
     }
 }
 
-void MainWindow::onNextPreset() {
-    QString preset = m_presetMgr->nextPreset();
-    if(!preset.isEmpty()) {
-        m_viz->loadPreset(preset);
-        QFileInfo fi(preset);
-        m_lblPreset->setText(fi.fileName());
+void MainWindow::onSavePlaylist() {
+    // Also the input of vibe-sync --render-batch
+    QString path = QFileDialog::getSaveFileName(this, "Save Playlist", QDir::homePath() + "/playlist.m3u8",
+        "Playlists (*.m3u8 *.m3u)");
+    if (path.isEmpty()) return;
+    if (m_playlistMgr->saveM3u(path)) qDebug() << "💾 Saved playlist:" << path;
+    else qWarning() << "❌ Could not save playlist:" << path;
+}
+
+void MainWindow::onPresetTimer() {
+    if (m_chkLock->isChecked()) return;
+
+    if (!m_presetDue && SpectrumAnalyzer::instance().beats().isLocked()) {
+        // Wait for the music; fall back to switching anyway if no beat comes
+        m_presetDue = true;
+        m_presetTimer->start(kBeatWaitTimeoutMs);
+        return;
     }
+    onNextPreset();
 }
 
-void MainWindow::onPrevPreset() {
-    QString preset = m_presetMgr->previousPreset();
-    if(!preset.isEmpty()) {
-        m_viz->loadPreset(preset);
-        QFileInfo fi(preset);
-        m_lblPreset->setText(fi.fileName());
+void MainWindow::onBeat(quint64 index, double bpm) {
+    if (!m_presetDue) return;
+    if (m_chkLock->isChecked()) {
+        // Locked while the switch waited for its beat: call it off, and
+        // start a full interval once the lock is released
+        m_presetDue = false;
+        m_presetTimer->start(kPresetIntervalMs);
+        return;
+    }
+
+    // The detector counts from wherever it locked, so its index has no bar phase.
+    // With a cached beat grid, bars are counted from the track's first grid beat instead
+    quint64 phase = index;
+    if (m_trackAnalysis && !m_trackAnalysis->beatsMs().empty() && bpm > 0.0) {
+        const auto grid = m_trackAnalysis->beatsMs();
+        const double positionMs = AudioEngine::instance().positionMs();
+        auto it = std::lower_bound(grid.begin(), grid.end(), positionMs,
+                                   [](quint32 beatMs, double ms) { return beatMs < ms; });
+        if (it == grid.end() || (it != grid.begin() && positionMs - *(it - 1) < *it - positionMs)) --it;
+        // A grid beat further than a quarter beat away means the grid doesn't fit here
+        if (std::abs(*it - positionMs) < 15000.0 / bpm) {
+            phase = quint64(it - grid.begin());
+        }
+    }
+    // Without a grid this is just every 4th beat, not necessarily a bar line
+    if (phase % 4 == 0) {
+        onNextPreset();
     }
 }
 
+void MainWindow::onNextPreset() {
+    m_presetDue = false;
+    if (m_presetTimer) m_presetTimer->start(kPresetIntervalMs);
+
+    // currentPresetChanged loads it and updates the labels
+    m_presetMgr->nextPreset();
+}
+
+void MainWindow::onPrevPreset() {
+    // currentPresetChanged loads it and updates the labels
+    m_presetMgr->previousPreset();
+}
+
 void MainWindow::onToggleFavorite() {
     QString current = m_presetMgr->currentPreset();
     if(!current.isEmpty()) {
@@ -228,28 +311,58 @@ void MainWindow::onQuarantinePreset() {
     onNextPreset(); // Move to next preset
 }
 
+QString MainWindow::recordingTitle() const {
+    QString title = m_playlistMgr->currentFile();
+    if (title.isEmpty()) title = "VisualizerCapture";
+    else title = QFileInfo(title).completeBaseName();
+    return title;
+}
+
+void MainWindow::setRecordButton(bool recording) {
+    m_btnRecord->setText(recording ? "⏹️ Stop Recording" : "Start Recording");
+    m_btnRecord->setStyleSheet(recording ? "background-color: #aa0000; color: white;"
+                                         : "background-color: #004400; color: #aaffaa;");
+}
+
 void MainWindow::onRecordToggle() {
-    if (!m_recorder->isRecording()) {
-        QString title = m_playlistMgr->currentFile();
-        if (title.isEmpty()) title = "VisualizerCapture";
-        else title = QFileInfo(title).completeBaseName();
-        
-        if (m_recorder->start(title)) {
-            m_btnRecord->setText("⏹️ Stop Recording");
-            m_btnRecord->setStyleSheet("background-color: #aa0000; color: white;");
+    if (!m_recorder->isRecording() || m_recorder->isReplayBuffer()) {
+        // One encoder at a time: the replay buffer pauses for the recording
+        if (m_recorder->isReplayBuffer()) {
+            m_recorder->stop();
+            m_menu->setReplayBufferChecked(false);
         }
+        if (m_recorder->start(recordingTitle())) setRecordButton(true);
     } else {
         m_recorder->stop();
-        m_btnRecord->setText("Start Recording");
-        m_btnRecord->setStyleSheet("background-color: #004400; color: #aaffaa;");
+        setRecordButton(false);
+        if (m_replayWanted) onReplayBufferToggled(true);
+    }
+}
+
+void MainWindow::onReplayBufferToggled(bool enabled) {
+    m_replayWanted = enabled;
+    if (enabled) {
+        // Picked up again when the recording stops
+        if (!m_recorder->isRecording()) m_recorder->startReplayBuffer();
+    } else if (m_recorder->isReplayBuffer()) {
+        m_recorder->stop();
     }
+    m_menu->setReplayBufferChecked(m_recorder->isReplayBuffer());
+}
+
+void MainWindow::onSaveReplay() {
+    m_recorder->saveReplay(recordingTitle());
 }
 
 void MainWindow::onCurrentTrackChanged(const QString& filePath) {
-    if(AudioEngine::instance().loadFile(filePath)) {
-        AudioEngine::instance().play();
+    // Cached analysis seeds the beat tracker so it is locked from the first frame
+    m_trackAnalysis = AnalysisCache::instance().lookup(filePath);
+    if (m_trackAnalysis) {
+        SpectrumAnalyzer::instance().beats().setTempoHint(m_trackAnalysis->bpm());
+    } else {
+        TrackAnalyzer::instance().prioritize(filePath);
     }
-    
+
     auto info = TextFormatter::parse(filePath);
     
     // Update the "metadata" element in TextEngine
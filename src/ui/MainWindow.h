@@ -6,6 +6,8 @@
 #include <QCheckBox>
 #include <QTimer>
 #include <QFileInfo>
+#include <memory>
+#include "../data/AnalysisCache.h"
 
 class PlaylistManager;
 class PresetManager;
@@ -22,18 +24,28 @@ private slots:
     void onShowSettings();
     void onOpenFiles();
     void onOpenFolder();
+    void onSavePlaylist();
     void onNextPreset();
+    void onPresetTimer();
+    void onBeat(quint64 index, double bpm);
     void onPrevPreset();
     void onToggleFavorite();
     void onToggleBlacklist();
     void onQuarantinePreset();
     void onRecordToggle();
+    void onReplayBufferToggled(bool enabled);
+    void onSaveReplay();
     void onCurrentTrackChanged(const QString& filePath);
     void onPlaylistChanged();
 
 private:
+    static constexpr int kPresetIntervalMs = 15000;
+    static constexpr int kBeatWaitTimeoutMs = 4000;
+
     void setupUI();
     void setupConnections();
+    QString recordingTitle() const;
+    void setRecordButton(bool recording);
     
     // Core components
     PlaylistManager* m_playlistMgr = nullptr;
@@ -50,5 +62,13 @@ private:
     QPushButton* m_btnBlack = nullptr;
     QPushButton* m_btnQuarantine = nullptr;
     QPushButton* m_btnRecord = nullptr;
+    bool m_replayWanted = false;        // Resume the replay buffer after a recording
     QCheckBox* m_chkLock = nullptr;
+
+    // Preset auto-advance
+    QTimer* m_presetTimer = nullptr;
+    bool m_presetDue = false;
+
+    // Offline analysis of the current track, if cached
+    std::shared_ptr<const CachedTrackAnalysis> m_trackAnalysis;
 };
\ No newline at end of file
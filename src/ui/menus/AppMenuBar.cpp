@@ -9,6 +9,9 @@ AppMenuBar::AppMenuBar(QWidget* parent) : QMenuBar(parent) {
     
     m_openFolderAction = fileMenu->addAction("Add Folder...");
     connect(m_openFolderAction, &QAction::triggered, this, &AppMenuBar::onOpenFolder);
+
+    m_savePlaylistAction = fileMenu->addAction("Save Playlist...");
+    connect(m_savePlaylistAction, &QAction::triggered, this, &AppMenuBar::savePlaylistRequested);
     
     fileMenu->addSeparator();
     
@@ -20,6 +23,17 @@ AppMenuBar::AppMenuBar(QWidget* parent) : QMenuBar(parent) {
     m_quitAction = fileMenu->addAction("Quit");
     connect(m_quitAction, &QAction::triggered, this, &AppMenuBar::onQuit);
 
+    // Recording Menu
+    QMenu* recordingMenu = addMenu("Recording");
+
+    m_replayBufferAction = recordingMenu->addAction("Replay Buffer");
+    m_replayBufferAction->setCheckable(true);
+    connect(m_replayBufferAction, &QAction::toggled, this, &AppMenuBar::replayBufferToggled);
+
+    m_saveReplayAction = recordingMenu->addAction("Save Replay");
+    m_saveReplayAction->setEnabled(false);
+    connect(m_saveReplayAction, &QAction::triggered, this, &AppMenuBar::saveReplayRequested);
+
     // View Menu (optional)
     QMenu* viewMenu = addMenu("View");
     // Add view-related actions here
@@ -30,6 +44,19 @@ AppMenuBar::AppMenuBar(QWidget* parent) : QMenuBar(parent) {
     // Connect about action to show about dialog
 }
 
+void AppMenuBar::setReplayBufferChecked(bool checked) {
+    // Reflects the recorder's state without asking it to change again
+    const QSignalBlocker blocker(m_replayBufferAction);
+    m_replayBufferAction->setChecked(checked);
+    m_saveReplayAction->setEnabled(checked);
+}
+
+void AppMenuBar::setSaveReplayShortcut(const QKeySequence& keys) {
+    m_saveReplayAction->setShortcut(keys);
+    // Works while the visualizer is fullscreen and the menu bar hidden
+    m_saveReplayAction->setShortcutContext(Qt::ApplicationShortcut);
+}
+
 void AppMenuBar::onOpenFiles() {
     emit openFilesRequested();
 }
@@ -7,11 +7,17 @@ class AppMenuBar : public QMenuBar {
 public:
     explicit AppMenuBar(QWidget* parent = nullptr);
 
+    void setReplayBufferChecked(bool checked);
+    void setSaveReplayShortcut(const QKeySequence& keys);
+
 signals:
     void openFilesRequested();
     void openFolderRequested();
+    void savePlaylistRequested();
     void showSettingsRequested();
     void quitRequested();
+    void replayBufferToggled(bool enabled);
+    void saveReplayRequested();
 
 private slots:
     void onOpenFiles();
@@ -22,6 +28,9 @@ private slots:
 private:
     QAction* m_openFilesAction = nullptr;
     QAction* m_openFolderAction = nullptr;
+    QAction* m_savePlaylistAction = nullptr;
     QAction* m_settingsAction = nullptr;
     QAction* m_quitAction = nullptr;
+    QAction* m_replayBufferAction = nullptr;
+    QAction* m_saveReplayAction = nullptr;
 };
\ No newline at end of file
@@ -1,9 +1,27 @@
 #include "VisualizerView.h"
+#include "../../engine/AudioEngine.h"
+#include "../../core/PerformanceManager.h"
+#include "../../data/SettingsManager.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QScreen>
+#include <QSurfaceFormat>
 
 VisualizerView::VisualizerView(QWidget* parent) : QOpenGLWidget(parent) {
-    m_timer = new QTimer(this);
-    connect(m_timer, &QTimer::timeout, this, QOverload<>::of(&VisualizerView::update));
-    m_timer->start(16);
+    // Paced by vsync feedback: every swap schedules the next paint
+    QSurfaceFormat fmt = format();
+    fmt.setSwapInterval(1);
+    setFormat(fmt);
+
+    m_scheduler.setMaxFps(SettingsManager::instance().getFPS());
+    m_scheduler.setPipelineDepth(1);  // Rendered off-thread, shown by the next paint
+    connect(this, &QOpenGLWidget::frameSwapped, this, &VisualizerView::onFrameSwapped);
+
+    m_wakeTimer = new QTimer(this);
+    m_wakeTimer->setSingleShot(true);
+    m_wakeTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_wakeTimer, &QTimer::timeout, this, QOverload<>::of(&VisualizerView::update));
+    m_statsTimer.start();
     
     m_textEngine = new TextEngine(this);
     
@@ -28,49 +46,144 @@ VisualizerView::VisualizerView(QWidget* parent) : QOpenGLWidget(parent) {
 }
 
 VisualizerView::~VisualizerView() {
-    if (m_handle) {
-        projectm_destroy(m_handle);
-    }
+    // The render thread's context shares with ours, so stop it first
+    makeCurrent();
+    m_renderer.reset();
+    m_blitter.destroy();
+    doneCurrent();
 }
 
 void VisualizerView::initializeGL() {
     initializeOpenGLFunctions();
-    
-    // Note: ProjectM initialization should be done with proper settings
-    // This is a placeholder - actual initialization should happen when a preset is loaded
+    m_blitter.create();
+
+    if (QScreen* screen = this->screen()) {
+        m_scheduler.setNominalRefreshRate(screen->refreshRate());
+        connect(screen, &QScreen::refreshRateChanged, this, [this](qreal hz) {
+            m_scheduler.setNominalRefreshRate(hz);
+        });
+    }
+
+    m_renderer = std::make_unique<RenderThread>(context(), m_textEngine);
+    m_renderer->resize(size() * devicePixelRatioF(), devicePixelRatioF());
+
+    // Show each finished frame on the next vsync
+    connect(m_renderer.get(), &RenderThread::frameReady, this, [this](qint64 renderNs) {
+        m_scheduler.recordRenderTime(renderNs);
+        update();
+    });
+    // Straight from the render thread into the encoder queue: a full queue
+    // then applies its policy there instead of piling up queued signals here
+    connect(m_renderer.get(), &RenderThread::frameCaptured, this, [this](const VideoFramePtr& frame) {
+        if (m_recorder && m_recorder->isRecording()) m_recorder->writeFrame(frame);
+    }, Qt::DirectConnection);
+
+    applySettings();
+    connect(m_renderer.get(), &RenderThread::renderScaleChanged, this, [this](double scale) {
+        m_renderScale = scale;
+        const FrameScheduler::Stats stats = m_scheduler.stats();
+        PerformanceMonitor::instance().recordVideoMetrics(qRound(stats.renderFps), renderPixels(), stats.meanRenderMs);
+    });
+
+    if (!m_pendingPreset.isEmpty()) {
+        m_renderer->loadPreset(m_pendingPreset);
+        m_pendingPreset.clear();
+    }
+    if (!m_pendingPreload.isEmpty()) {
+        m_renderer->preloadPreset(m_pendingPreload);
+        m_pendingPreload.clear();
+    }
+}
+
+void VisualizerView::applySettings() {
+    const SettingsManager& settings = SettingsManager::instance();
+    m_scheduler.setMaxFps(settings.getFPS());
+    if (!m_renderer) return;  // initializeGL() applies them
+
+    m_renderer->setFps(settings.getFPS());
+    m_renderer->setMeshSize(QSize(settings.getMeshX(), settings.getMeshY()));
+    m_renderer->setAdaptiveMesh(settings.getAdaptiveMesh());
+    m_renderer->setScaleRange(settings.getRenderScaleMin(), settings.getRenderScaleMax());
 }
 
 void VisualizerView::resizeGL(int w, int h) {
-    if (m_handle) {
-        projectm_reset_textures(m_handle);
-    }
+    const qreal dpr = devicePixelRatioF();
+    m_renderer->resize(QSize(qRound(w * dpr), qRound(h * dpr)), dpr);
 }
 
 void VisualizerView::paintGL() {
+    m_scheduler.setIdle(!AudioEngine::instance().isPlaying());
+    const FrameScheduler::Frame frame = m_scheduler.beginFrame();
+    if (frame.render) {
+        const bool recording = m_recorder && m_recorder->isRecording();
+        m_renderer->requestFrame(frame, recording ? m_recorder->frameSize() : QSize(),
+                                 recording ? m_recorder->framesHeld() : 0);
+    }
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    
-    if (m_handle) {
-        projectm_opengl_render_frame(m_handle);
+    const GLuint texture = m_renderer->latestTexture();
+    if (texture == 0) return;
+
+    m_blitter.bind();
+    const QRect viewport(QPoint(0, 0), size() * devicePixelRatioF());
+    m_blitter.blit(texture, QOpenGLTextureBlitter::targetTransform(viewport, viewport),
+                   QOpenGLTextureBlitter::OriginBottomLeft);
+    m_blitter.release();
+    m_renderer->releaseTexture();
+}
+
+void VisualizerView::onFrameSwapped() {
+    m_scheduler.frameSwapped();
+    reportFrameStats();
+
+    // Wake on the next vsync while frames are due soon; otherwise sleep until
+    // shortly before the next one instead of waking on every vsync
+    const qint64 waitNs = m_scheduler.nanosUntilNextFrame();
+    if (waitNs > static_cast<qint64>(m_scheduler.refreshPeriodMs() * 1.5e6)) {
+        m_wakeTimer->start(static_cast<int>(waitNs / 1000000));
+    } else {
+        update();
     }
+}
 
-    // RENDER TEXT ENGINE
-    QPainter painter(this);
-    painter.setRenderHint(QPainter::Antialiasing);
-    painter.setRenderHint(QPainter::TextAntialiasing);
-    
-    // Pass the current viewport size for scaling calculations
-    m_textEngine->render(&painter, size());
-    
-    painter.end();
+void VisualizerView::reportFrameStats() {
+    if (m_statsTimer.elapsed() < kStatsIntervalMs) return;
+    m_statsTimer.restart();
 
-    if (m_recorder && m_recorder->isRecording()) {
-        m_recorder->writeFrame(grabFramebuffer());
+    const FrameScheduler::Stats stats = m_scheduler.stats();
+    if (AudioEngine::instance().isPlaying()) {
+        PerformanceMonitor::instance().recordVideoMetrics(qRound(stats.renderFps), renderPixels(), stats.meanRenderMs);
     }
+    qDebug() << "🎞️ Frames:" << qRound(stats.renderFps) << "fps on" << qRound(stats.refreshHz) << "Hz (1/"
+             << m_scheduler.divisor() << ")," << stats.repeated << "repeated," << stats.missedVsyncs
+             << "missed vsyncs, p99 swap" << m_scheduler.intervalPercentileMs(99.0) << "ms, render"
+             << stats.meanRenderMs << "ms at" << qRound(m_renderScale * 100) << "% scale";
+    m_scheduler.resetStats();
 }
 
 void VisualizerView::loadPreset(const QString& path) {
-    if (QFile::exists(path)) {
-        // For now, just store the path. Full ProjectM integration would go here
-        qDebug() << "📁 Loading preset:" << QFileInfo(path).fileName();
+    if (!QFile::exists(path)) return;
+
+    qDebug() << "📁 Loading preset:" << QFileInfo(path).fileName();
+    if (m_renderer) {
+        m_renderer->loadPreset(path);
+    } else {
+        m_pendingPreset = path;
+    }
+}
+
+void VisualizerView::preloadPreset(const QString& path) {
+    if (!QFile::exists(path)) return;
+
+    if (m_renderer) {
+        m_renderer->preloadPreset(path);
+    } else {
+        m_pendingPreload = path;
     }
-}
\ No newline at end of file
+}
+
+int VisualizerView::renderPixels() const {
+    // Pixels projectM actually renders after dynamic resolution scaling
+    const qreal scale = devicePixelRatioF() * m_renderScale;
+    return qRound(width() * scale) * qRound(height() * scale);
+}
@@ -1,10 +1,17 @@
 #pragma once
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions>
-#include <projectM-4/projectM.h>
+#include <QOpenGLTextureBlitter>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <memory>
+#include "../../engine/RenderThread.h"
 #include "../../engine/TextEngine.h"
 #include "../../engine/VideoRecorder.h"
+#include "../../engine/FrameScheduler.h"
 
+// Presents the frames produced by the RenderThread. The widget itself only
+// paces frames and blits the latest finished texture.
 class VisualizerView : public QOpenGLWidget, protected QOpenGLFunctions {
     Q_OBJECT
 public:
@@ -12,11 +19,17 @@ public:
     ~VisualizerView();
 
     void loadPreset(const QString& path);
+    // Prepares the preset expected next so switching to it does not hitch
+    void preloadPreset(const QString& path);
+    // Re-reads frame rate, mesh and render scale settings; takes effect live
+    void applySettings();
+    RenderThread* renderer() { return m_renderer.get(); }
     
     // New Text API
     TextEngine* textEngine() { return m_textEngine; }
     
     void setRecorder(VideoRecorder* rec) { m_recorder = rec; }
+    const FrameScheduler& scheduler() const { return m_scheduler; }
 
 protected:
     void initializeGL() override;
@@ -24,8 +37,20 @@ protected:
     void paintGL() override;
 
 private:
-    projectm_handle m_handle = nullptr;
-    QTimer* m_timer;
+    static constexpr int kStatsIntervalMs = 10000;
+
+    void onFrameSwapped();
+    void reportFrameStats();
+    int renderPixels() const;
+
+    std::unique_ptr<RenderThread> m_renderer;
+    QOpenGLTextureBlitter m_blitter;
+    QString m_pendingPreset;   // Requested before the GL context existed
+    QString m_pendingPreload;
+    double m_renderScale = 1.0;  // Current dynamic resolution scale
+    FrameScheduler m_scheduler;
+    QTimer* m_wakeTimer;       // Sleeps through vsyncs when the next frame is far off
+    QElapsedTimer m_statsTimer;
     TextEngine* m_textEngine;
     VideoRecorder* m_recorder = nullptr;
-};
\ No newline at end of file
+};
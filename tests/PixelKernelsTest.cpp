@@ -0,0 +1,172 @@
+// Checks every PixelKernels implementation this CPU can run against a
+// double-precision BT.709 limited-range conversion, in I420 and NV12, for
+// odd and even frame sizes. Needs nothing but PixelKernels.cpp.
+#include "core/PixelKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Rounding ties in the real-valued formula may land either way in Q20
+constexpr double kTieWindow = 1e-3;
+
+struct Frame {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> bgra;
+    const uint8_t* pixel(int x, int y) const { return bgra.data() + (size_t(y) * width + x) * 4; }
+};
+
+struct Yuv {
+    int chromaWidth = 0;
+    int chromaHeight = 0;
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> u;     // Interleaved with V for NV12
+    std::vector<uint8_t> v;     // Unused for NV12
+    bool nv12 = false;
+
+    uint8_t cb(int x, int y) const { return nv12 ? u[(size_t(y) * chromaWidth + x) * 2] : u[size_t(y) * chromaWidth + x]; }
+    uint8_t cr(int x, int y) const {
+        return nv12 ? u[(size_t(y) * chromaWidth + x) * 2 + 1] : v[size_t(y) * chromaWidth + x];
+    }
+};
+
+// As YuvConverter drives the kernel: row pairs, an odd last row pairing with itself
+Yuv convert(const PixelKernels& kernels, const Frame& frame, bool nv12) {
+    Yuv out;
+    out.nv12 = nv12;
+    out.chromaWidth = (frame.width + 1) / 2;
+    out.chromaHeight = (frame.height + 1) / 2;
+    out.y.assign(size_t(frame.width) * frame.height, 0);
+    const size_t chroma = size_t(out.chromaWidth) * out.chromaHeight;
+    out.u.assign(nv12 ? chroma * 2 : chroma, 0);
+    out.v.assign(nv12 ? 0 : chroma, 0);
+
+    for (int pair = 0; pair < out.chromaHeight; ++pair) {
+        const int row0 = pair * 2;
+        const int row1 = std::min(row0 + 1, frame.height - 1);
+        uint8_t* u = nv12 ? out.u.data() + size_t(pair) * out.chromaWidth * 2 : out.u.data() + size_t(pair) * out.chromaWidth;
+        uint8_t* v = nv12 ? u + 1 : out.v.data() + size_t(pair) * out.chromaWidth;
+        kernels.bgraToYuv420(frame.pixel(0, row0), frame.pixel(0, row1), frame.width,
+                             out.y.data() + size_t(row0) * frame.width, out.y.data() + size_t(row1) * frame.width,
+                             u, v, nv12 ? 2 : 1);
+    }
+    return out;
+}
+
+double lumaOf(double r, double g, double b) {
+    return 0.2126 * r + 0.7152 * g + 0.0722 * b;
+}
+
+bool matches(int got, double reference) {
+    const double nearest = std::floor(reference + 0.5);
+    const double error = std::abs(got - nearest);
+    if (error == 0.0) return true;
+    return error == 1.0 && std::abs(reference - std::floor(reference) - 0.5) < kTieWindow;
+}
+
+// Number of samples off from the reference
+int compare(const Frame& frame, const Yuv& yuv, const char* what) {
+    int failures = 0;
+    auto report = [&](const char* plane, int x, int y, int got, double reference) {
+        if (failures++ < 5) {
+            std::printf("  %s %dx%d: %s(%d, %d) = %d, expected %.4f\n", what, frame.width, frame.height, plane, x, y,
+                        got, reference);
+        }
+    };
+
+    for (int y = 0; y < frame.height; ++y) {
+        for (int x = 0; x < frame.width; ++x) {
+            const uint8_t* p = frame.pixel(x, y);
+            const double reference = 16.0 + 219.0 / 255.0 * lumaOf(p[2], p[1], p[0]);
+            const int got = yuv.y[size_t(y) * frame.width + x];
+            if (!matches(got, reference)) report("Y", x, y, got, reference);
+        }
+    }
+
+    for (int cy = 0; cy < yuv.chromaHeight; ++cy) {
+        for (int cx = 0; cx < yuv.chromaWidth; ++cx) {
+            // The 2x2 block, clamped at odd edges
+            const int xs[2] = {2 * cx, std::min(2 * cx + 1, frame.width - 1)};
+            const int ys[2] = {2 * cy, std::min(2 * cy + 1, frame.height - 1)};
+            double r = 0.0, g = 0.0, b = 0.0;
+            for (int y : ys) {
+                for (int x : xs) {
+                    const uint8_t* p = frame.pixel(x, y);
+                    b += p[0] / 4.0;
+                    g += p[1] / 4.0;
+                    r += p[2] / 4.0;
+                }
+            }
+            const double luma = lumaOf(r, g, b);
+            const double cb = 128.0 + 224.0 / 255.0 * (b - luma) / 1.8556;
+            const double cr = 128.0 + 224.0 / 255.0 * (r - luma) / 1.5748;
+            if (!matches(yuv.cb(cx, cy), cb)) report("Cb", cx, cy, yuv.cb(cx, cy), cb);
+            if (!matches(yuv.cr(cx, cy), cr)) report("Cr", cx, cy, yuv.cr(cx, cy), cr);
+        }
+    }
+    return failures;
+}
+
+std::vector<Frame> testFrames() {
+    const int sizes[][2] = {{1, 1}, {2, 2}, {3, 5}, {4, 3}, {7, 7}, {16, 9}, {17, 11}, {33, 2}, {64, 63}, {65, 64}};
+    std::mt19937 random(709);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    std::vector<Frame> frames;
+    for (const auto& size : sizes) {
+        Frame frame;
+        frame.width = size[0];
+        frame.height = size[1];
+        frame.bgra.resize(size_t(frame.width) * frame.height * 4);
+        for (uint8_t& value : frame.bgra) value = uint8_t(byte(random));
+        frames.push_back(frame);
+    }
+
+    // Every grey level and the extremes of each channel
+    Frame ramp;
+    ramp.width = 256;
+    ramp.height = 7;
+    ramp.bgra.resize(size_t(ramp.width) * ramp.height * 4);
+    for (int y = 0; y < ramp.height; ++y) {
+        for (int x = 0; x < ramp.width; ++x) {
+            uint8_t* p = ramp.bgra.data() + (size_t(y) * ramp.width + x) * 4;
+            const bool grey = y == 0 || y > 3;
+            p[0] = uint8_t(grey || y == 1 ? x : 255 - x);
+            p[1] = uint8_t(grey || y == 2 ? x : 255 - x);
+            p[2] = uint8_t(grey || y == 3 ? x : 255 - x);
+            p[3] = 255;
+        }
+    }
+    frames.push_back(ramp);
+    return frames;
+}
+
+} // namespace
+
+int main() {
+    const std::vector<Frame> frames = testFrames();
+    int failed = 0;
+    for (const PixelKernels* kernels : PixelKernels::available()) {
+        for (bool nv12 : {false, true}) {
+            int failures = 0;
+            for (const Frame& frame : frames) {
+                const Yuv yuv = convert(*kernels, frame, nv12);
+                failures += compare(frame, yuv, kernels->name);
+
+                // Every implementation gives the very same bytes
+                const Yuv scalar = convert(PixelKernels::scalar(), frame, nv12);
+                if (yuv.y != scalar.y || yuv.u != scalar.u || yuv.v != scalar.v) {
+                    std::printf("  %s %dx%d: differs from scalar\n", kernels->name, frame.width, frame.height);
+                    ++failures;
+                }
+            }
+            std::printf("%s %s: %s\n", kernels->name, nv12 ? "NV12" : "I420", failures ? "FAILED" : "ok");
+            if (failures) ++failed;
+        }
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,128 @@
+// Encodes two short segments the way a segmented render's workers do (video
+// plus FLAC audio), joins them with AAC audio as the default settings ask,
+// and checks the result has every frame and the whole soundtrack.
+#include "engine/LibavEncoder.h"
+#include "engine/SegmentJoiner.h"
+#include <QTemporaryDir>
+#include <cmath>
+#include <cstdio>
+#include <numbers>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+namespace {
+constexpr int kFps = 24;
+constexpr int kSampleRate = 48000;
+constexpr int kChannels = 2;
+constexpr int kSamplesPerFrame = kSampleRate / kFps;
+constexpr int kSegmentFrames = 12;
+const QSize kSize(64, 48);
+
+bool encodeSegment(const QString& path, qint64 firstFrame) {
+    LibavEncoder encoder(path, kSize, kFps, "flac");
+    if (!encoder.open()) {
+        std::printf("  could not open %s: %s\n", qPrintable(path), qPrintable(encoder.errorString()));
+        return false;
+    }
+    VideoFrame frame;
+    frame.size = kSize;
+    frame.stride = kSize.width() * 4;
+    std::vector<float> pcm(size_t(kSamplesPerFrame) * kChannels);
+    for (qint64 n = firstFrame; n < firstFrame + kSegmentFrames; ++n) {
+        frame.pixels.assign(size_t(frame.stride) * kSize.height(), uchar(n * 10));
+        frame.streamFrame = quint64(n) * kSamplesPerFrame;
+        frame.presentNs = n * 1000000000LL / kFps;
+        for (size_t i = 0; i < pcm.size(); ++i) {
+            const double t = double(frame.streamFrame + i / kChannels) / kSampleRate;
+            pcm[i] = 0.25f * float(std::sin(2.0 * std::numbers::pi * 440.0 * t));
+        }
+        if (!encoder.write(frame) || !encoder.writeAudio(pcm.data(), kSamplesPerFrame, frame.streamFrame)) {
+            std::printf("  could not encode %s: %s\n", qPrintable(path), qPrintable(encoder.errorString()));
+            return false;
+        }
+    }
+    encoder.close();
+    return encoder.errorString().isEmpty();
+}
+
+// Video packets and decoded audio samples in path
+bool inspect(const QString& path, int& videoPackets, qint64& audioSamples) {
+    const QByteArray name = path.toUtf8();
+    AVFormatContext* input = nullptr;
+    if (avformat_open_input(&input, name.constData(), nullptr, nullptr) < 0) return false;
+    avformat_find_stream_info(input, nullptr);
+    const int video = av_find_best_stream(input, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    const int audio = av_find_best_stream(input, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    bool ok = video >= 0 && audio >= 0;
+
+    AVCodecContext* decoder = nullptr;
+    if (ok) {
+        const AVCodec* codec = avcodec_find_decoder(input->streams[audio]->codecpar->codec_id);
+        decoder = avcodec_alloc_context3(codec);
+        avcodec_parameters_to_context(decoder, input->streams[audio]->codecpar);
+        ok = avcodec_open2(decoder, codec, nullptr) >= 0;
+    }
+
+    AVPacket* packet = av_packet_alloc();
+    AVFrame* frame = av_frame_alloc();
+    auto drain = [&]() {
+        while (avcodec_receive_frame(decoder, frame) == 0) {
+            audioSamples += frame->nb_samples;
+            av_frame_unref(frame);
+        }
+    };
+    while (ok && av_read_frame(input, packet) >= 0) {
+        if (packet->stream_index == video) ++videoPackets;
+        else if (packet->stream_index == audio && avcodec_send_packet(decoder, packet) >= 0) drain();
+        av_packet_unref(packet);
+    }
+    if (ok) {
+        avcodec_send_packet(decoder, nullptr);
+        drain();
+    }
+
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    avcodec_free_context(&decoder);
+    avformat_close_input(&input);
+    return ok;
+}
+} // namespace
+
+int main() {
+    QTemporaryDir dir;
+    if (!dir.isValid()) return 1;
+
+    QList<SegmentJoiner::Segment> segments;
+    for (int i = 0; i < 2; ++i) {
+        const qint64 firstFrame = qint64(i) * kSegmentFrames;
+        const QString path = dir.filePath(QString("segment_%1.mkv").arg(i));
+        if (!encodeSegment(path, firstFrame)) return 1;
+        segments.append({path, firstFrame});
+    }
+
+    const QString output = dir.filePath("joined.mp4");
+    SegmentJoiner joiner(output, kFps, "aac");
+    if (!joiner.join(segments)) {
+        std::printf("join failed: %s\n", qPrintable(joiner.errorString()));
+        return 1;
+    }
+
+    int videoPackets = 0;
+    qint64 audioSamples = 0;
+    if (!inspect(output, videoPackets, audioSamples)) {
+        std::printf("could not read %s\n", qPrintable(output));
+        return 1;
+    }
+    // AAC pads the ends by up to a frame of 1024 samples each
+    const qint64 expectedSamples = qint64(2) * kSegmentFrames * kSamplesPerFrame;
+    const bool ok = videoPackets == 2 * kSegmentFrames && std::abs(audioSamples - expectedSamples) <= 2 * 1024;
+    std::printf("joined: %d video frames, %lld audio samples (expected %d and %lld): %s\n", videoPackets,
+                static_cast<long long>(audioSamples), 2 * kSegmentFrames, static_cast<long long>(expectedSamples),
+                ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+// Frame throughput into an encoder's stdin, the three ways ProcessEncoder
+// could feed it:
+//   qprocess  QProcess::write(), copied into QProcess's buffer, then written
+//   write     a plain write() on a pipe of our own
+//   vmsplice  SplicePipe, pages handed over with vmsplice()
+//
+// The child is this tool again (--drain), which read()s the frames and
+// discards them, like ffmpeg reading pipe:0. Each buffer is overwritten as
+// soon as the write returns, as EncoderFeed's pool would, and the child
+// checks one byte per page of every frame, so a buffer recycled too early
+// shows up as corrupted.
+//
+//   PipeBench [--frames 600] [--size 3840x2160] [--format bgra|i420]
+#include "engine/SplicePipe.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QStringList>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+constexpr int kPipeBytes = 1 << 20;     // As SplicePipe asks for
+constexpr size_t kCheckStride = 4096;
+
+enum class Mode { QProcessWrite, PipeWrite, Splice };
+
+struct Result {
+    double fps = 0.0;
+    bool intact = false;
+};
+
+uint8_t patternOf(quint64 frame) {
+    return uint8_t(frame * 31 + 7);
+}
+
+// Child side. Exit code 0 when every frame arrived intact
+int drain(size_t frameBytes) {
+    std::vector<uint8_t> frame(frameBytes);
+    bool intact = true;
+    for (quint64 index = 0;; ++index) {
+        size_t filled = 0;
+        while (filled < frameBytes) {
+            const ssize_t n = ::read(STDIN_FILENO, frame.data() + filled, frameBytes - filled);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            filled += size_t(n);
+        }
+        if (filled == 0) break;
+        if (filled < frameBytes) return 2;
+
+        const uint8_t expected = patternOf(index);
+        for (size_t i = 0; i < frameBytes; i += kCheckStride) intact = intact && frame[i] == expected;
+        intact = intact && frame[frameBytes - 1] == expected;
+    }
+    return intact ? 0 : 1;
+}
+
+bool writeAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= size_t(n);
+    }
+    return true;
+}
+
+bool run(Mode mode, size_t frameBytes, int frames, Result& result) {
+    QProcess process;
+    process.setProgram(QCoreApplication::applicationFilePath());
+    process.setArguments({"--drain", QString::number(qulonglong(frameBytes))});
+    process.setProcessChannelMode(QProcess::ForwardedChannels);
+
+    // The two pipe modes replace the child's stdin, as ProcessEncoder does
+    SplicePipe splice;
+    int readFd = -1;
+    int writeFd = -1;
+    if (mode == Mode::Splice) {
+        if (!splice.create()) {
+            std::fprintf(stderr, "SplicePipe: %s\n", qPrintable(splice.errorString()));
+            return false;
+        }
+        readFd = splice.readFd();
+    } else if (mode == Mode::PipeWrite) {
+        int fds[2];
+        if (pipe2(fds, O_CLOEXEC) != 0) return false;
+        fcntl(fds[1], F_SETPIPE_SZ, kPipeBytes);
+        readFd = fds[0];
+        writeFd = fds[1];
+    }
+    if (readFd >= 0) process.setChildProcessModifier([readFd]() { ::dup2(readFd, STDIN_FILENO); });
+
+    process.start();
+    if (!process.waitForStarted()) return false;
+    if (mode == Mode::Splice) splice.closeReadEnd();
+    if (mode == Mode::PipeWrite) ::close(readFd);
+
+    std::vector<uint8_t> buffer(frameBytes);
+    QElapsedTimer timer;
+    qint64 writingNs = 0;
+    bool ok = true;
+    for (int n = 0; n < frames && ok; ++n) {
+        std::memset(buffer.data(), patternOf(quint64(n)), frameBytes);
+        timer.start();
+        switch (mode) {
+        case Mode::QProcessWrite:
+            ok = process.write(reinterpret_cast<const char*>(buffer.data()), qint64(frameBytes)) >= 0;
+            while (ok && process.bytesToWrite() > 0) ok = process.waitForBytesWritten(-1);
+            break;
+        case Mode::PipeWrite:
+            ok = writeAll(writeFd, buffer.data(), frameBytes);
+            break;
+        case Mode::Splice:
+            ok = splice.write(buffer.data(), frameBytes);
+            break;
+        }
+        writingNs += timer.nsecsElapsed();
+        // Back in the pool and reused right away
+        std::memset(buffer.data(), 0xEE, frameBytes);
+    }
+
+    if (mode == Mode::Splice) splice.close();
+    if (mode == Mode::PipeWrite) ::close(writeFd);
+    process.closeWriteChannel();
+    process.waitForFinished(-1);
+
+    result.fps = writingNs > 0 ? frames / (writingNs * 1e-9) : 0.0;
+    result.intact = ok && process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+    return ok;
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int frames = 600;
+    int width = 3840;
+    int height = 2160;
+    std::string format = "bgra";
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--drain" && i + 1 < argc) {
+            return drain(size_t(std::strtoull(argv[++i], nullptr, 10)));
+        } else if (arg == "--frames" && i + 1 < argc) {
+            frames = std::atoi(argv[++i]);
+        } else if (arg == "--size" && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2) width = height = 0;
+        } else if (arg == "--format" && i + 1 < argc) {
+            format = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: %s [--frames N] [--size WxH] [--format bgra|i420]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (frames <= 0 || width <= 0 || height <= 0 || (format != "bgra" && format != "i420")) {
+        std::fprintf(stderr, "Invalid --frames, --size or --format\n");
+        return 1;
+    }
+
+    QCoreApplication app(argc, argv);
+    // A child that exits early fails the write instead of killing us
+    std::signal(SIGPIPE, SIG_IGN);
+
+    const size_t frameBytes = format == "bgra" ? size_t(width) * height * 4
+                                               : size_t(width) * height + 2 * (size_t(width + 1) / 2) * ((height + 1) / 2);
+    std::printf("%d %dx%d %s frames (%.1f MB) into a reading child:\n", frames, width, height, format.c_str(),
+                frameBytes / 1e6);
+
+    const std::pair<Mode, const char*> modes[] = {
+        {Mode::QProcessWrite, "qprocess"}, {Mode::PipeWrite, "write"}, {Mode::Splice, "vmsplice"}};
+    int failed = 0;
+    for (const auto& [mode, name] : modes) {
+        Result result;
+        if (!run(mode, frameBytes, frames, result)) {
+            std::printf("  %-9s failed\n", name);
+            ++failed;
+            continue;
+        }
+        std::printf("  %-9s %6.0f fps%s\n", name, result.fps, result.intact ? "" : "  (frames corrupted)");
+        if (!result.intact) ++failed;
+    }
+    return failed ? 1 : 0;
+}